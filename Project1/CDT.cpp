@@ -1,6 +1,8 @@
 
 
 #include "CDT.h"
+#include "CDTResource.h"
+#include <string.h>
 
 // -------------------------------------------
 // CDT global variables
@@ -14,12 +16,13 @@ float		cdt_camzoom;
 float		cdt_camdegree;
 glm::mat4	cdt_ViewMatrix;
 glm::mat4	cdt_ProjectionMatrix;
+glm::mat4	cdt_ViewProjMatrix;			// Projection * View, updated when the camera change
 
 // Render 
 int			cdt_width;
 int			cdt_height;
-GLuint		cdt_programID;
-int			cdt_rendermode;
+CDTShaderVariant	cdt_variants[CDT_SHADER_VARIANT_MAX];
+CDTShaderVariant*	cdt_variant;				// in use
 float		cdt_tranparency;
 glm::mat4	cdt_MVP;
 CDTTex		cdt_blanktex;
@@ -42,8 +45,12 @@ void CDTInit(int width, int height)
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-	cdt_programID = LoadShaders("color_tex_transparency.vert", "color_tex_transparency.frag");
-	cdt_blanktex = TextureLoad("blank.png");
+	// shared with the game states through the resource cache
+	ResourceInit(CDT_RES_DEFAULT_BUDGET);
+	for (int v = 0; v < CDT_SHADER_VARIANT_MAX; v++)
+		cdt_variants[v].program = 0;
+	SetRenderVariant(CDT_SHADER_TEXTURED, 1.0f);
+	cdt_blanktex = ResourceLoadTexture("blank.png");
 	cdt_tranparency = 1.0f;
 
 	// set cam, model view proj matrix
@@ -54,13 +61,21 @@ void CDTInit(int width, int height)
 	cdt_camdegree = 0.0f;
 	cdt_ProjectionMatrix = glm::ortho(-(cdt_width/2)*cdt_camzoom, (cdt_width/2)*cdt_camzoom, -(cdt_height/2)*cdt_camzoom, (cdt_height/2)*cdt_camzoom, -10.0f, 10.0f);
 	cdt_ViewMatrix = glm::lookAt(cdt_campos, cdt_campos + cdt_camdir, cdt_camup);
+	cdt_ViewProjMatrix = cdt_ProjectionMatrix * cdt_ViewMatrix;
 
 }
 
 void CDTShutdown()
 {
-	glDeleteProgram(cdt_programID);
-	TextureUnload(cdt_blanktex);
+	for (int v = 0; v < CDT_SHADER_VARIANT_MAX; v++) {
+		if (cdt_variants[v].program != 0)
+			ResourceReleaseShader(cdt_variants[v].program);
+		cdt_variants[v].program = 0;
+	}
+	ResourceReleaseTexture(cdt_blanktex);
+
+	ResourcePrint();
+	ResourceShutdown();
 }
 
 int  GetWindowWidth()
@@ -123,27 +138,94 @@ void UnloadMesh(CDTMesh &mesh)
 
 CDTTex TextureLoad(const char* filename)
 {
+	CDTImage image;
 	CDTTex aTex;
 
-	GLubyte*	pData;
-	int			texWidth, texHeight, channels;
+	TextureDecode(image, filename);
+	TextureUploadBatch(&image, &aTex, 1);
 
-	pData = SOIL_load_image(filename, &texWidth, &texHeight, &channels, SOIL_LOAD_AUTO);
-
-	glGenTextures(1, &aTex);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, aTex);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	GLint format = (channels == 4) ? GL_RGBA : GL_RGB;
-
-	glTexImage2D(GL_TEXTURE_2D, 0, format, texWidth, texHeight, 0, format, GL_UNSIGNED_BYTE, pData);
+	return aTex;
+}
 
-	SOIL_free_image_data(pData);
+bool TextureDecode(CDTImage &image, const char* filename)
+{
+	// from the mounted asset pack, or the file
+	CDTAsset asset;
+	image.pixels = NULL;
+	if (AssetOpen(asset, filename)) {
+		image.pixels = SOIL_load_image_from_memory(asset.data, (int)asset.size, &image.width, &image.height, &image.channels, SOIL_LOAD_AUTO);
+		AssetClose(asset);
+	}
+	if (image.pixels == NULL) {
+		printf("TextureLoad: can't load %s\n", filename);
+		image.width = image.height = 1;
+		image.channels = 4;
+		return false;
+	}
+	return true;
+}
 
-	return aTex;
+void TextureUploadBatch(CDTImage* images, CDTTex* textures, int count)
+{
+	if (count <= 0)
+		return;
+
+	// pack the images in 1 buffer, each at a 16 byte aligned offset
+	std::vector<size_t> offsets(count);
+	size_t size = 0;
+	for (int i = 0; i < count; i++) {
+		offsets[i] = size;
+		if (images[i].pixels)
+			size += ((size_t)images[i].width * images[i].height * images[i].channels + 15) & ~(size_t)15;
+	}
+
+	GLuint pbo = 0;
+	unsigned char* mapped = NULL;
+	if (size > 0) {
+		glGenBuffers(1, &pbo);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+		mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	}
+
+	for (int i = 0; i < count; i++) {
+		if (mapped && images[i].pixels)
+			memcpy(mapped + offsets[i], images[i].pixels, (size_t)images[i].width * images[i].height * images[i].channels);
+	}
+	if (mapped)
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+	for (int i = 0; i < count; i++) {
+		CDTTex aTex;
+		glGenTextures(1, &aTex);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, aTex);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		GLint format = (images[i].channels == 4) ? GL_RGBA : GL_RGB;
+
+		// with a PBO bound the pixel pointer is an offset in it, a failed
+		// decode (or a failed map) gives an empty texture of the size
+		if (mapped && images[i].pixels) {
+			glTexImage2D(GL_TEXTURE_2D, 0, format, images[i].width, images[i].height, 0, format, GL_UNSIGNED_BYTE, BUFFER_OFFSET(offsets[i]));
+		}
+		else {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			glTexImage2D(GL_TEXTURE_2D, 0, format, images[i].width, images[i].height, 0, format, GL_UNSIGNED_BYTE, images[i].pixels);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+		}
+
+		SOIL_free_image_data(images[i].pixels);
+		images[i].pixels = NULL;
+		textures[i] = aTex;
+	}
+
+	// the driver keeps the storage until the copies are done
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	if (pbo != 0)
+		glDeleteBuffers(1, &pbo);
 }
 
 
@@ -185,6 +267,7 @@ void SetCamPosition(float xpos, float ypos)
 	cdt_campos.x = xpos;
 	cdt_campos.y = ypos;
 	cdt_ViewMatrix = glm::lookAt(cdt_campos, cdt_campos + cdt_camdir, cdt_camup);
+	cdt_ViewProjMatrix = cdt_ProjectionMatrix * cdt_ViewMatrix;
 }
 
 void SetCamZoom(float zoom)
@@ -193,6 +276,7 @@ void SetCamZoom(float zoom)
 	if (cdt_camzoom < 0.1f){ cdt_camzoom = 0.1f; }
 	cdt_ProjectionMatrix = glm::ortho(-(cdt_width / 2)*cdt_camzoom, (cdt_width / 2)*cdt_camzoom, -(cdt_height / 2)*cdt_camzoom, (cdt_height / 2)*cdt_camzoom, -10.0f, 10.0f);
 	cdt_ViewMatrix = glm::lookAt(cdt_campos, cdt_campos + cdt_camdir, cdt_camup);
+	cdt_ViewProjMatrix = cdt_ProjectionMatrix * cdt_ViewMatrix;
 }
 
 void SetCamRotation(float degree)
@@ -207,6 +291,7 @@ void SetCamRotation(float degree)
 	cdt_camup = newUp;
 
 	cdt_ViewMatrix = glm::lookAt(cdt_campos, cdt_campos + cdt_camdir, cdt_camup);
+	cdt_ViewProjMatrix = cdt_ProjectionMatrix * cdt_ViewMatrix;
 }
 
 void ResetCam()
@@ -218,6 +303,12 @@ void ResetCam()
 	cdt_camdegree = 0.0f;
 	cdt_ProjectionMatrix = glm::ortho(-(cdt_width / 2)*cdt_camzoom, (cdt_width / 2)*cdt_camzoom, -(cdt_height / 2)*cdt_camzoom, (cdt_height / 2)*cdt_camzoom, -10.0f, 10.0f);
 	cdt_ViewMatrix = glm::lookAt(cdt_campos, cdt_campos + cdt_camdir, cdt_camup);
+	cdt_ViewProjMatrix = cdt_ProjectionMatrix * cdt_ViewMatrix;
+}
+
+const glm::mat4& GetViewProjMatrix()
+{
+	return cdt_ViewProjMatrix;
 }
 
 // -------------------------------------------
@@ -227,10 +318,7 @@ void ResetCam()
 void SetRenderMode(int mode, float alpha)
 {
 	glViewport(0, 0, cdt_width, cdt_height);
-	glUseProgram(cdt_programID);
-
-	glUniform1i(glGetUniformLocation(cdt_programID, "mode"), mode);
-	glUniform1f(glGetUniformLocation(cdt_programID, "alpha"), alpha);
+	SetRenderVariant(mode == CDT_COLOR ? CDT_SHADER_COLORED : CDT_SHADER_TEXTURED, alpha);
 
 	// default setting
 	SetTexture(cdt_blanktex, 0.0f, 0.0f);
@@ -238,18 +326,85 @@ void SetRenderMode(int mode, float alpha)
 
 }
 
+//+ Compile the variant the first time, the uniform locations are looked up once
+void SetRenderVariant(int variant, float alpha)
+{
+	CDTShaderVariant* shader = &cdt_variants[variant & (CDT_SHADER_VARIANT_MAX - 1)];
+
+	if (shader->program == 0) {
+		static const char* names[] = { "TEXTURED", "COLORED", "ALPHA_TEST", "PREMULTIPLIED", "PALETTE" };
+		std::string defines;
+		for (int bit = 0; bit < 5; bit++) {
+			if (variant & (1 << bit))
+				defines += std::string("#define ") + names[bit] + "\n";
+		}
+
+		shader->program = ResourceLoadShader("color_tex_transparency.vert", "color_tex_transparency.frag", defines.c_str());
+		shader->mvp = glGetUniformLocation(shader->program, "MVP");
+		shader->alpha = glGetUniformLocation(shader->program, "alpha");
+		shader->offsetX = glGetUniformLocation(shader->program, "offsetX");
+		shader->offsetY = glGetUniformLocation(shader->program, "offsetY");
+		shader->lastAlpha = -1.0f;
+
+		// samplers never change, tex1 on unit 0, palette on unit 1
+		glUseProgram(shader->program);
+		glUniform1i(glGetUniformLocation(shader->program, "tex1"), 0);
+		glUniform1i(glGetUniformLocation(shader->program, "palette"), 1);
+		cdt_variant = NULL;
+	}
+
+	if (cdt_variant != shader) {
+		glUseProgram(shader->program);
+		cdt_variant = shader;
+	}
+	SetAlpha(alpha);
+}
+
+void SetAlpha(float alpha)
+{
+	if (cdt_variant->lastAlpha != alpha) {
+		glUniform1f(cdt_variant->alpha, alpha);
+		cdt_variant->lastAlpha = alpha;
+	}
+}
+
+void SetPalette(CDTTex palette)
+{
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, palette);
+	glActiveTexture(GL_TEXTURE0);
+}
+
 void SetTexture(CDTTex tex, float offsetX, float offsetY)
 {
-	glUniform1f(glGetUniformLocation(cdt_programID, "offsetX"), offsetX);
-	glUniform1f(glGetUniformLocation(cdt_programID, "offsetY"), offsetY);
+	glUniform1f(cdt_variant->offsetX, offsetX);
+	glUniform1f(cdt_variant->offsetY, offsetY);
 
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_2D, tex);
-	glUniform1i(glGetUniformLocation(cdt_programID, "tex1"), 0);
 }
 
 void SetTransform(const glm::mat4 &modelMat)
 {
-	cdt_MVP = cdt_ProjectionMatrix * cdt_ViewMatrix * modelMat;
-	glUniformMatrix4fv(glGetUniformLocation(cdt_programID, "MVP"), 1, GL_FALSE, &cdt_MVP[0][0]);
+	cdt_MVP = cdt_ViewProjMatrix * modelMat;
+	glUniformMatrix4fv(cdt_variant->mvp, 1, GL_FALSE, &cdt_MVP[0][0]);
+}
+
+//+ Same as SetTransform, the model only has x,y columns so only 3 columns of VP are combined
+//	- depth is the z translation of the model
+void SetTransform2D(const CDTAffine2D &model, float depth)
+{
+	const glm::mat4& vp = cdt_ViewProjMatrix;
+
+	cdt_MVP[0] = vp[0] * model.a + vp[1] * model.b;
+	cdt_MVP[1] = vp[0] * model.c + vp[1] * model.d;
+	cdt_MVP[2] = vp[2];
+	cdt_MVP[3] = vp[0] * model.tx + vp[1] * model.ty + vp[2] * depth + vp[3];
+	glUniformMatrix4fv(cdt_variant->mvp, 1, GL_FALSE, &cdt_MVP[0][0]);
+}
+
+void UseProgram(GLuint program)
+{
+	glUseProgram(program);
+	cdt_variant = NULL;
 }
@@ -22,7 +22,9 @@ extern GLFWwindow* window;
 #include <glm/gtc/random.hpp>
 
 #include "shader.hpp"
+#include "CDTTransform.h"
 #include "SOIL.h"
+#include "CDTPack.h"
 
 #define PI 3.1415926
 
@@ -47,8 +49,38 @@ struct CDTMesh
 
 typedef GLuint CDTTex;
 
+// decoded image, waiting to be uploaded
+struct CDTImage
+{
+	unsigned char*	pixels;				// NULL if the decode failed
+	int				width;
+	int				height;
+	int				channels;
+};
+
 #define CDT_COLOR 0
 #define CDT_TEXTURE 1
+
+// shader variants, 1 bit per #define of color_tex_transparency.frag
+//	- each combination is its own program, compiled the first time it's
+//	  used, so the fragment shader has no mode branch
+//	- the variant is a sort key, draws of the same variant go together
+#define CDT_SHADER_TEXTURED			1<<0
+#define CDT_SHADER_COLORED			1<<1
+#define CDT_SHADER_ALPHA_TEST		1<<2
+#define CDT_SHADER_PREMULTIPLIED	1<<3
+#define CDT_SHADER_PALETTE			1<<4
+#define CDT_SHADER_VARIANT_MAX		32
+
+struct CDTShaderVariant
+{
+	GLuint		program;				// 0 until first used
+	GLint		mvp;					// uniform locations
+	GLint		alpha;
+	GLint		offsetX;
+	GLint		offsetY;
+	float		lastAlpha;				// skip the upload when it didn't change
+};
 #define BUFFER_OFFSET(i) ((char *)NULL + (i))
 
 // -------------------------------------------
@@ -75,6 +107,14 @@ void UnloadMesh(CDTMesh &mesh);
 CDTTex TextureLoad(const char* filename);
 void TextureUnload(CDTTex &tex);
 
+// TextureLoad in 2 steps, so images can be decoded on any thread and
+// uploaded together on the GL thread
+//	- TextureDecode has no GL call, the image is freed by the upload
+//	- the upload copies every image in 1 pixel buffer (PBO) that the
+//	  textures are then created from
+bool TextureDecode(CDTImage &image, const char* filename);
+void TextureUploadBatch(CDTImage* images, CDTTex* textures, int count);
+
 // -------------------------------------------
 // CDT Camera function
 // -------------------------------------------
@@ -87,14 +127,24 @@ void SetCamPosition(float xpos, float ypos);
 void SetCamZoom(float zoom);
 void SetCamRotation(float degree);
 void ResetCam();
+const glm::mat4& GetViewProjMatrix();
 
 // -------------------------------------------
 // CDT Renderer function
 // -------------------------------------------
 
-void SetRenderMode(int mode, float alpha);
+void SetRenderMode(int mode, float alpha);		// CDT_COLOR/CDT_TEXTURE variant, blank texture, no transform
+
+// use the program of the variant (CDT_SHADER_ flags), compiled if needed
+void SetRenderVariant(int variant, float alpha);
+void SetAlpha(float alpha);
+void SetPalette(CDTTex palette);						// texture unit 1, for CDT_SHADER_PALETTE
 void SetTexture(CDTTex tex, float offsetX, float offsetY);
 void SetTransform(const glm::mat4 &modelMat);
+void SetTransform2D(const CDTAffine2D &model, float depth = 0.0f);		// depth: z toward the camera
+
+// a program outside the variants, the next SetRenderVariant binds its own again
+void UseProgram(GLuint program);
 
 
 
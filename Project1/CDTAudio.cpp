@@ -0,0 +1,894 @@
+
+#include "CDTAudio.h"
+#include "CDTPack.h"
+#include "CDTVorbis.h"
+#include <string.h>
+#include <algorithm>
+#include <math.h>
+#include <chrono>
+
+#define CDT_STREAM_DECODE_BLOCK		1024			// source frames decoded at a time
+#define CDT_STREAM_WAV				0				// sources of a stream decoder
+#define CDT_STREAM_VORBIS			1
+
+static CDTAudio		cdt_audio;
+
+struct _WavData
+{
+	int						channels;
+	int						rate;
+	int						bits;
+	const unsigned char*	samples;
+	size_t					numFrame;
+};
+
+// -------------------------------------------
+// Internal functions
+// -------------------------------------------
+
+static uint32_t _read32(const unsigned char* p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t _read16(const unsigned char* p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+//+ 8/16 bit PCM wav, the samples are a view on data
+static bool _parseWav(const unsigned char* data, size_t size, _WavData &wav)
+{
+	if (size < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0)
+		return false;
+
+	int format = 0;
+	wav.channels = 0;
+	wav.rate = 0;
+	wav.bits = 0;
+
+	// chunks are word aligned, fmt comes before data
+	size_t pos = 12;
+	while (pos + 8 <= size) {
+		uint32_t chunkSize = _read32(data + pos + 4);
+		const unsigned char* chunk = data + pos + 8;
+		size_t avail = size - (pos + 8);
+		if (chunkSize > avail)
+			chunkSize = (uint32_t)avail;
+
+		if (memcmp(data + pos, "fmt ", 4) == 0 && chunkSize >= 16) {
+			format = _read16(chunk);
+			wav.channels = _read16(chunk + 2);
+			wav.rate = (int)_read32(chunk + 4);
+			wav.bits = _read16(chunk + 14);
+		}
+		else if (memcmp(data + pos, "data", 4) == 0) {
+			// 1 = PCM, 0xFFFE = extensible (the PCM ones have the same layout)
+			if ((format != 1 && format != 0xFFFE) || wav.channels <= 0 || wav.rate <= 0 || (wav.bits != 8 && wav.bits != 16))
+				return false;
+
+			wav.samples = chunk;
+			wav.numFrame = chunkSize / (wav.bits / 8 * wav.channels);
+			return true;
+		}
+
+		pos += 8 + chunkSize + (chunkSize & 1);
+	}
+	return false;
+}
+
+static void _convertWav(const unsigned char* samples, int bits, int16_t* out, size_t numSample)
+{
+	for (size_t n = 0; n < numSample; n++)
+		out[n] = bits == 8 ? (int16_t)((samples[n] - 128) << 8) : (int16_t)_read16(samples + n * 2);
+}
+
+//+ Any channel count and rate to stereo CDT_AUDIO_RATE, linear interpolation
+static void _toMixFormat(const std::vector<int16_t> &in, int channels, int rate, CDTSound &sound)
+{
+	int numIn = channels > 0 ? (int)(in.size() / channels) : 0;
+	int numOut = rate == CDT_AUDIO_RATE ? numIn : (int)((int64_t)numIn * CDT_AUDIO_RATE / rate);
+	sound.pcm.resize((size_t)numOut * CDT_AUDIO_CHANNELS);
+	sound.numFrame = numOut;
+
+	double step = (double)rate / CDT_AUDIO_RATE;
+	for (int n = 0; n < numOut; n++) {
+		double pos = n * step;
+		int i0 = (int)pos, i1 = i0 + 1 < numIn ? i0 + 1 : i0;
+		float t = (float)(pos - i0);
+
+		for (int c = 0; c < CDT_AUDIO_CHANNELS; c++) {
+			int src = c < channels ? c : channels - 1;		// mono goes to both sides
+			float a = in[(size_t)i0 * channels + src], b = in[(size_t)i1 * channels + src];
+			sound.pcm[(size_t)n * CDT_AUDIO_CHANNELS + c] = (int16_t)(a + (b - a) * t);
+		}
+	}
+}
+
+static bool _decodeVorbis(const unsigned char* data, size_t size, std::vector<int16_t> &pcm, int &channels, int &rate)
+{
+	CDTVorbis vorbis;
+	if (!VorbisOpen(vorbis, data, size))
+		return false;
+
+	channels = vorbis.channels;
+	rate = vorbis.rate;
+
+	int16_t buffer[4096];
+	int numFrame = (int)(sizeof(buffer) / sizeof(buffer[0])) / channels;
+	int count;
+	while ((count = VorbisDecode(vorbis, buffer, numFrame)) > 0)
+		pcm.insert(pcm.end(), buffer, buffer + count * channels);
+
+	VorbisClose(vorbis);
+	return !pcm.empty();
+}
+
+//+ The bank decoders first, then the backend
+static bool _decode(const char* name, const unsigned char* data, size_t size, std::vector<int16_t> &pcm, int &channels, int &rate)
+{
+	if (AudioDecodeWav(data, size, pcm, channels, rate))
+		return true;
+
+	pcm.clear();
+	if (_decodeVorbis(data, size, pcm, channels, rate))
+		return true;
+
+	pcm.clear();
+	if (cdt_audio.open && cdt_audio.backend.decode) {
+		std::lock_guard<std::mutex> guard(cdt_audio.decodeLock);
+		return cdt_audio.backend.decode(cdt_audio.backend, name, data, size, pcm, channels, rate);
+	}
+	return false;
+}
+
+//+ Voice handle: generation above the index, a reused voice makes the old handles stale
+static int _voiceHandle(int index)
+{
+	return (int)((cdt_audio.voices[index].generation & 0x7FFFFF) << 8) | index;
+}
+
+static CDTVoice* _findVoice(int handle)
+{
+	if (handle < 0 || (handle & 0xFF) >= CDT_AUDIO_MAX_VOICE)
+		return NULL;
+
+	CDTVoice &voice = cdt_audio.voices[handle & 0xFF];
+	if (voice.sound < 0 || _voiceHandle(handle & 0xFF) != handle)
+		return NULL;
+	return &voice;
+}
+
+static float _voiceGain(const CDTVoice &voice)
+{
+	float maxDistance = cdt_audio.sounds[voice.sound].maxDistance;
+	if (!voice.positional || maxDistance <= 0.0f)
+		return voice.volume;
+
+	// linear fade to 0 at maxDistance
+	float dx = voice.x - cdt_audio.listenerX, dy = voice.y - cdt_audio.listenerY;
+	float fade = 1.0f - sqrtf(dx * dx + dy * dy) / maxDistance;
+	return fade > 0.0f ? voice.volume * fade : 0.0f;
+}
+
+static void _freeVoice(CDTVoice &voice)
+{
+	if (voice.gain < CDT_AUDIO_MIN_GAIN)
+		cdt_audio.stats.numVirtual--;
+	voice.sound = -1;
+	cdt_audio.stats.numActive--;
+}
+
+//+ True if voice a is less important than b, a is stolen first
+static bool _lessImportant(const CDTVoice &a, const CDTVoice &b)
+{
+	int priorityA = cdt_audio.sounds[a.sound].priority, priorityB = cdt_audio.sounds[b.sound].priority;
+	if (priorityA != priorityB)
+		return priorityA < priorityB;
+	if (a.gain != b.gain)
+		return a.gain < b.gain;
+	return a.start < b.start;
+}
+
+//+ Voice for a new sound, -1 if rejected
+//	- the oldest voice of the sound when it has maxInstance voices
+//	- else a free voice
+//	- else the least important voice if it is less important than the new one
+static int _claimVoice(const CDTVoice &newVoice)
+{
+	const CDTSound &data = cdt_audio.sounds[newVoice.sound];
+	int numInstance = 0, oldest = -1, free = -1, victim = -1;
+
+	for (int v = 0; v < CDT_AUDIO_MAX_VOICE; v++) {
+		const CDTVoice &voice = cdt_audio.voices[v];
+		if (voice.sound < 0) {
+			if (free < 0)
+				free = v;
+			continue;
+		}
+
+		if (voice.sound == newVoice.sound) {
+			numInstance++;
+			if (oldest < 0 || voice.start < cdt_audio.voices[oldest].start)
+				oldest = v;
+		}
+		if (victim < 0 || _lessImportant(voice, cdt_audio.voices[victim]))
+			victim = v;
+	}
+
+	if (data.maxInstance > 0 && numInstance >= data.maxInstance)
+		victim = oldest;
+	else if (free >= 0)
+		return free;
+	else if (!_lessImportant(cdt_audio.voices[victim], newVoice))
+		return -1;
+
+	_freeVoice(cdt_audio.voices[victim]);
+	cdt_audio.stats.numStolen++;
+	return victim;
+}
+
+static int _play(int sound, float volume, bool loop, bool positional, float x, float y)
+{
+	if (sound < 0 || sound >= cdt_audio.numSound || cdt_audio.sounds[sound].numFrame == 0)
+		return -1;
+	cdt_audio.stats.numPlay++;
+
+	CDTVoice voice;
+	voice.sound = sound;
+	voice.frame = 0;
+	voice.volume = volume;
+	voice.x = x;
+	voice.y = y;
+	voice.positional = positional;
+	voice.loop = loop;
+	voice.gain = _voiceGain(voice);
+	voice.start = cdt_audio.numStart;
+
+	// too far to be heard, a sound shorter than the way back isn't worth a voice
+	if (voice.gain < CDT_AUDIO_MIN_GAIN && !loop) {
+		cdt_audio.stats.numCulled++;
+		return -1;
+	}
+
+	int v = _claimVoice(voice);
+	if (v < 0) {
+		cdt_audio.stats.numRejected++;
+		return -1;
+	}
+
+	voice.generation = cdt_audio.voices[v].generation + 1;
+	cdt_audio.voices[v] = voice;
+	cdt_audio.numStart++;
+
+	CDTAudioStats &stats = cdt_audio.stats;
+	stats.numActive++;
+	if (voice.gain < CDT_AUDIO_MIN_GAIN)
+		stats.numVirtual++;
+	if (stats.peakActive < stats.numActive)
+		stats.peakActive = stats.numActive;
+	return _voiceHandle(v);
+}
+
+
+// -------------------------------------------
+// Stream thread
+// -------------------------------------------
+
+struct _StreamDecoder
+{
+	CDTAsset				asset;				// mapped, read by the wav and vorbis sources
+	int						source;				// CDT_STREAM_
+	int						channels;
+	int						rate;
+
+	_WavData				wav;
+	size_t					frame;				// next frame of wav
+	CDTVorbis				vorbis;
+
+	std::vector<int16_t>	block;				// decoded source frames
+	int						blockSize;
+	int						blockPos;
+
+	// linear resampler, the output is between the source frames prev and next
+	double					step;
+	double					frac;
+	float					prev[2];
+	float					next[2];
+	bool					end;
+};
+
+//+ Next source frames in block, 0 at the end
+static int _decodeBlock(_StreamDecoder &dec)
+{
+	int16_t* block = &dec.block[0];
+
+	if (dec.source == CDT_STREAM_WAV) {
+		int count = (int)std::min((size_t)CDT_STREAM_DECODE_BLOCK, dec.wav.numFrame - dec.frame);
+		_convertWav(dec.wav.samples + dec.frame * dec.channels * (dec.wav.bits / 8), dec.wav.bits, block, (size_t)count * dec.channels);
+		dec.frame += count;
+		return count;
+	}
+
+	return VorbisDecode(dec.vorbis, block, CDT_STREAM_DECODE_BLOCK);
+}
+
+static void _rewind(_StreamDecoder &dec)
+{
+	dec.frame = 0;
+	if (dec.source == CDT_STREAM_VORBIS)
+		VorbisRewind(dec.vorbis);
+}
+
+//+ Next source frame in stereo, a loop goes back to the start in the same call
+static bool _pullFrame(_StreamDecoder &dec, bool loop, float frame[2])
+{
+	if (dec.blockPos == dec.blockSize) {
+		dec.blockSize = _decodeBlock(dec);
+		if (dec.blockSize == 0 && loop) {
+			_rewind(dec);
+			dec.blockSize = _decodeBlock(dec);
+		}
+		dec.blockPos = 0;
+		if (dec.blockSize == 0)
+			return false;
+	}
+
+	const int16_t* src = &dec.block[(size_t)dec.blockPos * dec.channels];
+	frame[0] = src[0];
+	frame[1] = src[dec.channels > 1 ? 1 : 0];		// mono goes to both sides
+	dec.blockPos++;
+	return true;
+}
+
+//+ Up to count frames at CDT_AUDIO_RATE in out, fewer at the end
+static int _resample(_StreamDecoder &dec, bool loop, int16_t* out, int count)
+{
+	int n = 0;
+	while (n < count && !dec.end) {
+		float t = (float)dec.frac;
+		out[n * 2] = (int16_t)(dec.prev[0] + (dec.next[0] - dec.prev[0]) * t);
+		out[n * 2 + 1] = (int16_t)(dec.prev[1] + (dec.next[1] - dec.prev[1]) * t);
+		n++;
+
+		dec.frac += dec.step;
+		while (dec.frac >= 1.0) {
+			dec.frac -= 1.0;
+			dec.prev[0] = dec.next[0];
+			dec.prev[1] = dec.next[1];
+			if (!_pullFrame(dec, loop, dec.next)) {
+				dec.end = true;
+				break;
+			}
+		}
+	}
+	return n;
+}
+
+static void _closeDecoder(_StreamDecoder* dec)
+{
+	if (dec->source == CDT_STREAM_VORBIS)
+		VorbisClose(dec->vorbis);
+	AssetClose(dec->asset);
+	delete dec;
+}
+
+//+ NULL if the asset can't be read or decoded
+static _StreamDecoder* _openDecoder(const char* name, bool loop)
+{
+	_StreamDecoder* dec = new _StreamDecoder;
+	if (!AssetOpen(dec->asset, name)) {
+		delete dec;
+		return NULL;
+	}
+
+	// both are decoded from the mapped file, a block at a time
+	if (_parseWav(dec->asset.data, dec->asset.size, dec->wav)) {
+		dec->source = CDT_STREAM_WAV;
+		dec->channels = dec->wav.channels;
+		dec->rate = dec->wav.rate;
+	}
+	else if (VorbisOpen(dec->vorbis, dec->asset.data, dec->asset.size)) {
+		dec->source = CDT_STREAM_VORBIS;
+		dec->channels = dec->vorbis.channels;
+		dec->rate = dec->vorbis.rate;
+	}
+	else {
+		AssetClose(dec->asset);
+		delete dec;
+		return NULL;
+	}
+
+	dec->frame = 0;
+	dec->block.resize((size_t)CDT_STREAM_DECODE_BLOCK * dec->channels);
+	dec->blockSize = 0;
+	dec->blockPos = 0;
+	dec->step = (double)dec->rate / CDT_AUDIO_RATE;
+	dec->frac = 0.0;
+	dec->end = false;
+
+	if (!_pullFrame(*dec, loop, dec->prev)) {
+		_closeDecoder(dec);
+		return NULL;
+	}
+	if (!_pullFrame(*dec, loop, dec->next)) {
+		dec->next[0] = dec->prev[0];
+		dec->next[1] = dec->prev[1];
+	}
+	return dec;
+}
+
+//+ Decode into the free part of the ring
+static void _fillStream(CDTAudioStream &stream, _StreamDecoder &dec)
+{
+	uint32_t writePos = stream.writePos.load(std::memory_order_relaxed);
+	uint32_t space = CDT_AUDIO_STREAM_FRAMES - (writePos - stream.readPos.load(std::memory_order_acquire));
+
+	while (space > 0 && !dec.end) {
+		uint32_t index = writePos & (CDT_AUDIO_STREAM_FRAMES - 1);
+		int count = (int)std::min(space, (uint32_t)CDT_AUDIO_STREAM_FRAMES - index);
+		count = _resample(dec, stream.loop, &stream.ring[(size_t)index * CDT_AUDIO_CHANNELS], count);
+
+		writePos += count;
+		space -= count;
+		stream.writePos.store(writePos, std::memory_order_release);
+	}
+
+	if (dec.end)
+		stream.ended.store(true, std::memory_order_release);
+}
+
+//+ Back to FREE, AudioMix doesn't read the ring anymore
+static void _freeStream(CDTAudioStream &stream)
+{
+	if (stream.decoder != NULL)
+		_closeDecoder((_StreamDecoder*)stream.decoder);
+	stream.decoder = NULL;
+	stream.writePos.store(0, std::memory_order_relaxed);
+	stream.readPos.store(0, std::memory_order_relaxed);
+	stream.ended.store(false, std::memory_order_relaxed);
+	stream.state.store(CDT_STREAM_FREE, std::memory_order_release);
+}
+
+static void _updateStream(CDTAudioStream &stream)
+{
+	int state = stream.state.load(std::memory_order_acquire);
+
+	if (state == CDT_STREAM_OPENING) {
+		// the ring is full before AudioMix sees it
+		_StreamDecoder* dec = _openDecoder(stream.name.c_str(), stream.loop);
+		if (dec == NULL)
+			printf("Audio: can't stream %s\n", stream.name.c_str());
+		else
+			_fillStream(stream, *dec);
+
+		if (dec != NULL && stream.state.compare_exchange_strong(state, CDT_STREAM_PLAYING, std::memory_order_acq_rel)) {
+			stream.decoder = dec;
+			return;
+		}
+
+		// can't be opened, or stopped meanwhile
+		if (dec != NULL)
+			_closeDecoder(dec);
+		_freeStream(stream);
+	}
+	else if (state == CDT_STREAM_PLAYING) {
+		_fillStream(stream, *(_StreamDecoder*)stream.decoder);
+	}
+	else if (state == CDT_STREAM_STOPPED) {
+		_freeStream(stream);
+	}
+}
+
+static void _streamLoop()
+{
+	std::unique_lock<std::mutex> lock(cdt_audio.streamLock);
+	while (!cdt_audio.streamQuit) {
+		lock.unlock();
+		for (int s = 0; s < CDT_AUDIO_MAX_STREAM; s++)
+			_updateStream(cdt_audio.streams[s]);
+		lock.lock();
+
+		// woken early by AudioStreamPlay & AudioStreamStop
+		if (!cdt_audio.streamQuit)
+			cdt_audio.streamWake.wait_for(lock, std::chrono::milliseconds(CDT_AUDIO_STREAM_SLEEP));
+	}
+}
+
+static void _wakeStreamThread()
+{
+	std::lock_guard<std::mutex> guard(cdt_audio.streamLock);
+	cdt_audio.streamWake.notify_one();
+}
+
+static CDTAudioStream* _findStream(int handle)
+{
+	if (handle < 0 || (handle & 0xFF) >= CDT_AUDIO_MAX_STREAM)
+		return NULL;
+
+	CDTAudioStream &stream = cdt_audio.streams[handle & 0xFF];
+	if ((int)((stream.generation & 0x7FFFFF) << 8) != (handle & ~0xFF))
+		return NULL;
+	return &stream;
+}
+
+
+// -------------------------------------------
+// Init & Shutdown
+// -------------------------------------------
+
+bool AudioInit(int backend, const char* param)
+{
+	cdt_audio.open = false;
+	cdt_audio.masterVolume = 1.0f;
+	cdt_audio.numSound = 0;
+	for (int v = 0; v < CDT_AUDIO_MAX_VOICE; v++) {
+		cdt_audio.voices[v].sound = -1;
+		cdt_audio.voices[v].generation = 0;
+	}
+	cdt_audio.numStart = 0;
+	cdt_audio.listenerX = 0.0f;
+	cdt_audio.listenerY = 0.0f;
+	memset(&cdt_audio.stats, 0, sizeof(cdt_audio.stats));
+	cdt_audio.numUnderrun = 0;
+	cdt_audio.numUnderrunFrame = 0;
+
+	for (int s = 0; s < CDT_AUDIO_MAX_STREAM; s++) {
+		CDTAudioStream &stream = cdt_audio.streams[s];
+		stream.ring.assign((size_t)CDT_AUDIO_STREAM_FRAMES * CDT_AUDIO_CHANNELS, 0);
+		stream.generation = 0;
+		stream.decoder = NULL;
+		_freeStream(stream);
+	}
+
+	bool found = false;
+	if (backend == CDT_AUDIO_IRRKLANG)
+		found = AudioBackendIrrKlang(cdt_audio.backend);
+
+	if (found && cdt_audio.backend.open(cdt_audio.backend, param)) {
+		cdt_audio.open = true;
+	}
+	else {
+		if (backend != CDT_AUDIO_NULL)
+			printf("Audio: can't open the device, no sound\n");
+		AudioBackendNull(cdt_audio.backend);
+		cdt_audio.open = cdt_audio.backend.open(cdt_audio.backend, param);
+	}
+
+	cdt_audio.streamQuit = false;
+	cdt_audio.streamThread = std::thread(_streamLoop);
+
+	printf("Audio: %s backend\n", cdt_audio.backend.name);
+	return cdt_audio.open;
+}
+
+void AudioShutdown()
+{
+	AudioPrintStats();
+
+	{
+		std::lock_guard<std::mutex> guard(cdt_audio.streamLock);
+		cdt_audio.streamQuit = true;
+		cdt_audio.streamWake.notify_one();
+	}
+	if (cdt_audio.streamThread.joinable())
+		cdt_audio.streamThread.join();
+
+	if (cdt_audio.open)
+		cdt_audio.backend.close(cdt_audio.backend);
+	cdt_audio.open = false;
+
+	// nothing reads the rings anymore
+	for (int s = 0; s < CDT_AUDIO_MAX_STREAM; s++) {
+		_freeStream(cdt_audio.streams[s]);
+		cdt_audio.streams[s].ring.clear();
+		cdt_audio.streams[s].ring.shrink_to_fit();
+	}
+
+	for (int s = 0; s < cdt_audio.numSound; s++) {
+		cdt_audio.sounds[s].name.clear();
+		cdt_audio.sounds[s].pcm.clear();
+		cdt_audio.sounds[s].pcm.shrink_to_fit();
+	}
+	cdt_audio.numSound = 0;
+}
+
+const char* AudioBackendName()
+{
+	return cdt_audio.open ? cdt_audio.backend.name : "none";
+}
+
+// -------------------------------------------
+// Sound bank
+// -------------------------------------------
+
+int AudioLoadSound(const char* name)
+{
+	int sound = AudioFindSound(name);
+	if (sound >= 0)
+		return sound;
+
+	CDTAsset asset;
+	if (!AssetOpen(asset, name))
+		return -1;
+
+	std::vector<int16_t> pcm;
+	int channels = 0, rate = 0;
+	bool decoded = _decode(name, asset.data, asset.size, pcm, channels, rate) && channels > 0 && rate > 0;
+	AssetClose(asset);
+	if (!decoded) {
+		printf("Audio: can't decode %s\n", name);
+		return -1;
+	}
+
+	CDTSound decodedSound;
+	_toMixFormat(pcm, channels, rate, decodedSound);
+
+	// decoded by another thread meanwhile, or the bank is full
+	std::lock_guard<std::mutex> guard(cdt_audio.lock);
+	for (int s = 0; s < cdt_audio.numSound; s++) {
+		if (cdt_audio.sounds[s].name == name)
+			return s;
+	}
+	if (cdt_audio.numSound == CDT_AUDIO_MAX_SOUND) {
+		printf("Audio: the bank is full, %s not loaded\n", name);
+		return -1;
+	}
+
+	CDTSound &slot = cdt_audio.sounds[cdt_audio.numSound];
+	slot.name = name;
+	slot.pcm.swap(decodedSound.pcm);
+	slot.numFrame = decodedSound.numFrame;
+	slot.priority = 0;
+	slot.maxInstance = 0;
+	slot.maxDistance = 0.0f;
+	return cdt_audio.numSound++;
+}
+
+int AudioFindSound(const char* name)
+{
+	std::lock_guard<std::mutex> guard(cdt_audio.lock);
+	for (int s = 0; s < cdt_audio.numSound; s++) {
+		if (cdt_audio.sounds[s].name == name)
+			return s;
+	}
+	return -1;
+}
+
+int AudioSoundFrames(int sound)
+{
+	std::lock_guard<std::mutex> guard(cdt_audio.lock);
+	return sound >= 0 && sound < cdt_audio.numSound ? cdt_audio.sounds[sound].numFrame : 0;
+}
+
+void AudioSetSoundLimit(int sound, int priority, int maxInstance, float maxDistance)
+{
+	std::lock_guard<std::mutex> guard(cdt_audio.lock);
+	if (sound < 0 || sound >= cdt_audio.numSound)
+		return;
+
+	CDTSound &data = cdt_audio.sounds[sound];
+	data.priority = priority;
+	data.maxInstance = maxInstance;
+	data.maxDistance = maxDistance;
+}
+
+bool AudioDecodeWav(const unsigned char* data, size_t size, std::vector<int16_t> &pcm, int &channels, int &rate)
+{
+	_WavData wav;
+	if (!_parseWav(data, size, wav))
+		return false;
+
+	channels = wav.channels;
+	rate = wav.rate;
+	pcm.resize(wav.numFrame * wav.channels);
+	if (!pcm.empty())
+		_convertWav(wav.samples, wav.bits, &pcm[0], pcm.size());
+	return true;
+}
+
+// -------------------------------------------
+// Voices
+// -------------------------------------------
+
+int AudioPlay(int sound, float volume, bool loop)
+{
+	std::lock_guard<std::mutex> guard(cdt_audio.lock);
+	return _play(sound, volume, loop, false, 0.0f, 0.0f);
+}
+
+int AudioPlayAt(int sound, float volume, float x, float y)
+{
+	std::lock_guard<std::mutex> guard(cdt_audio.lock);
+	return _play(sound, volume, false, true, x, y);
+}
+
+void AudioStop(int voice)
+{
+	std::lock_guard<std::mutex> guard(cdt_audio.lock);
+	CDTVoice* pVoice = _findVoice(voice);
+	if (pVoice != NULL)
+		_freeVoice(*pVoice);
+}
+
+void AudioStopAll()
+{
+	std::lock_guard<std::mutex> guard(cdt_audio.lock);
+	for (int v = 0; v < CDT_AUDIO_MAX_VOICE; v++) {
+		if (cdt_audio.voices[v].sound >= 0)
+			_freeVoice(cdt_audio.voices[v]);
+	}
+}
+
+void AudioSetMasterVolume(float volume)
+{
+	std::lock_guard<std::mutex> guard(cdt_audio.lock);
+	cdt_audio.masterVolume = volume;
+}
+
+void AudioSetListener(float x, float y)
+{
+	std::lock_guard<std::mutex> guard(cdt_audio.lock);
+	cdt_audio.listenerX = x;
+	cdt_audio.listenerY = y;
+
+	int numVirtual = 0;
+	for (int v = 0; v < CDT_AUDIO_MAX_VOICE; v++) {
+		CDTVoice &voice = cdt_audio.voices[v];
+		if (voice.sound < 0)
+			continue;
+		voice.gain = _voiceGain(voice);
+		if (voice.gain < CDT_AUDIO_MIN_GAIN)
+			numVirtual++;
+	}
+	cdt_audio.stats.numVirtual = numVirtual;
+}
+
+void AudioGetStats(CDTAudioStats &stats)
+{
+	std::lock_guard<std::mutex> guard(cdt_audio.lock);
+	stats = cdt_audio.stats;
+	stats.numUnderrun = cdt_audio.numUnderrun.load(std::memory_order_relaxed);
+	stats.numUnderrunFrame = cdt_audio.numUnderrunFrame.load(std::memory_order_relaxed);
+}
+
+void AudioPrintStats()
+{
+	CDTAudioStats stats;
+	AudioGetStats(stats);
+	printf("Audio: %d voices (%d virtual), peak %d of %d\n", stats.numActive, stats.numVirtual, stats.peakActive, CDT_AUDIO_MAX_VOICE);
+	printf("Audio: %d plays, %d stolen, %d rejected, %d culled\n", stats.numPlay, stats.numStolen, stats.numRejected, stats.numCulled);
+	printf("Audio: %d stream underruns, %d silent frames\n", stats.numUnderrun, stats.numUnderrunFrame);
+}
+
+// -------------------------------------------
+// Streams
+// -------------------------------------------
+
+int AudioStreamPlay(const char* name, float volume, bool loop)
+{
+	for (int s = 0; s < CDT_AUDIO_MAX_STREAM; s++) {
+		CDTAudioStream &stream = cdt_audio.streams[s];
+		if (stream.state.load(std::memory_order_acquire) != CDT_STREAM_FREE)
+			continue;
+
+		// the stream thread reads them once it sees OPENING
+		stream.name = name;
+		stream.loop = loop;
+		stream.volume.store(volume, std::memory_order_relaxed);
+		stream.generation++;
+		stream.state.store(CDT_STREAM_OPENING, std::memory_order_release);
+		_wakeStreamThread();
+		return (int)((stream.generation & 0x7FFFFF) << 8) | s;
+	}
+
+	printf("Audio: every stream is used, %s not played\n", name);
+	return -1;
+}
+
+void AudioStreamStop(int stream)
+{
+	CDTAudioStream* pStream = _findStream(stream);
+	if (pStream == NULL)
+		return;
+
+	int state = CDT_STREAM_PLAYING;
+	if (!pStream->state.compare_exchange_strong(state, CDT_STREAM_STOPPING, std::memory_order_acq_rel)) {
+		state = CDT_STREAM_OPENING;
+		pStream->state.compare_exchange_strong(state, CDT_STREAM_STOPPING, std::memory_order_acq_rel);
+	}
+	_wakeStreamThread();
+}
+
+void AudioStreamSetVolume(int stream, float volume)
+{
+	CDTAudioStream* pStream = _findStream(stream);
+	if (pStream != NULL)
+		pStream->volume.store(volume, std::memory_order_relaxed);
+}
+
+void AudioMix(int16_t* out, int numFrame)
+{
+	std::vector<float> &mix = cdt_audio.mixBuffer;
+	mix.assign((size_t)numFrame * CDT_AUDIO_CHANNELS, 0.0f);
+	float masterVolume;
+
+	// the voices and the bank are shared with the main thread
+	{
+		std::lock_guard<std::mutex> guard(cdt_audio.lock);
+		masterVolume = cdt_audio.masterVolume;
+
+		for (int v = 0; v < CDT_AUDIO_MAX_VOICE; v++) {
+			CDTVoice &voice = cdt_audio.voices[v];
+			if (voice.sound < 0)
+				continue;
+
+			const CDTSound &sound = cdt_audio.sounds[voice.sound];
+			float volume = voice.gain * masterVolume;
+			bool audible = voice.gain >= CDT_AUDIO_MIN_GAIN;
+			int n = 0;
+
+			while (n < numFrame) {
+				int count = std::min(numFrame - n, sound.numFrame - voice.frame);
+				if (audible) {
+					const int16_t* src = &sound.pcm[(size_t)voice.frame * CDT_AUDIO_CHANNELS];
+					float* dst = &mix[(size_t)n * CDT_AUDIO_CHANNELS];
+					for (int i = 0; i < count * CDT_AUDIO_CHANNELS; i++)
+						dst[i] += src[i] * volume;
+				}
+
+				n += count;
+				voice.frame += count;
+				if (voice.frame < sound.numFrame)
+					continue;
+
+				// end of the sound, back to the start or the voice is free
+				voice.frame = 0;
+				if (!voice.loop) {
+					_freeVoice(voice);
+					break;
+				}
+			}
+		}
+	}
+
+	// streams, only what the stream thread has written, outside of the lock
+	for (int s = 0; s < CDT_AUDIO_MAX_STREAM; s++) {
+		CDTAudioStream &stream = cdt_audio.streams[s];
+		int state = stream.state.load(std::memory_order_acquire);
+		if (state == CDT_STREAM_STOPPING) {
+			stream.state.compare_exchange_strong(state, CDT_STREAM_STOPPED, std::memory_order_acq_rel);
+			continue;
+		}
+		if (state != CDT_STREAM_PLAYING)
+			continue;
+
+		bool ended = stream.ended.load(std::memory_order_acquire);
+		uint32_t readPos = stream.readPos.load(std::memory_order_relaxed);
+		uint32_t avail = stream.writePos.load(std::memory_order_acquire) - readPos;
+		int count = (int)std::min(avail, (uint32_t)numFrame);
+		float volume = stream.volume.load(std::memory_order_relaxed) * masterVolume;
+
+		for (int n = 0; n < count; n++) {
+			const int16_t* src = &stream.ring[(size_t)((readPos + n) & (CDT_AUDIO_STREAM_FRAMES - 1)) * CDT_AUDIO_CHANNELS];
+			mix[n * 2] += src[0] * volume;
+			mix[n * 2 + 1] += src[1] * volume;
+		}
+		stream.readPos.store(readPos + count, std::memory_order_release);
+
+		if (count == numFrame)
+			continue;
+		if (ended) {
+			stream.state.compare_exchange_strong(state, CDT_STREAM_STOPPED, std::memory_order_acq_rel);
+		}
+		else {
+			cdt_audio.numUnderrun.fetch_add(1, std::memory_order_relaxed);
+			cdt_audio.numUnderrunFrame.fetch_add(numFrame - count, std::memory_order_relaxed);
+		}
+	}
+
+	for (int i = 0; i < numFrame * CDT_AUDIO_CHANNELS; i++) {
+		float s = mix[i];
+		out[i] = (int16_t)(s > 32767.0f ? 32767.0f : s < -32768.0f ? -32768.0f : s);
+	}
+}
@@ -0,0 +1,244 @@
+
+#ifndef CDT_AUDIO
+#define CDT_AUDIO
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+
+// -------------------------------------------
+// CDT audio
+//	- 1 device for the whole process, opened by AudioInit
+//	- sounds are decoded once into the bank, 16 bit stereo PCM at
+//	  CDT_AUDIO_RATE, and stay resident, playing a sound is only a voice
+//	  pointing at its PCM
+//	- the voices are mixed by the engine, a backend is only the output:
+//	  it calls AudioMix from its own thread for the next frames
+//		null		no device, the mix is paced in real time and written to
+//					a wav file if one is given (headless runs, tests)
+//		irrKlang	1 endless irrKlang stream reading AudioMix (Windows)
+//	  the other platforms only have the null backend
+//	- the bank decodes wav and ogg (CDTVorbis), the irrKlang backend
+//	  decodes what the bank can't (mp3, flac)
+//	- AudioLoadSound can be called from any thread (the load graph)
+//	- the voice pool is fixed, CDT_AUDIO_MAX_VOICE voices at most are mixed
+//	  whatever the number of AudioPlay, when a sound can't get a voice:
+//		- its sound has maxInstance voices: the oldest one is restarted
+//		- the pool is full: the least important voice is stolen (lower
+//		  priority, then quieter, then older), if it is not more
+//		  important than the new one, else the new one is rejected
+//	- positional voices fade with the distance to the listener, under
+//	  CDT_AUDIO_MIN_GAIN they are virtual: they keep their position in the
+//	  sound but are not mixed, a sound starting inaudible is culled
+//	- music and long ambience are streamed, not in the bank: the stream
+//	  thread decodes them ahead into a ring of CDT_AUDIO_STREAM_FRAMES per
+//	  stream, AudioMix reads the rings, without locks (1 writer, 1 reader)
+//	  after it mixed the voices under the bank lock
+//		- wav and ogg are decoded from the mapped file a block at a time,
+//		  the memory is the rings and the decoders, whatever the length
+//		- other formats can't be streamed, load them into the bank
+//		- a loop goes back to the start while filling: no gap
+//		- a ring empty before the end is an underrun, counted in the stats
+//		- the main thread only posts AudioStreamPlay & AudioStreamStop
+// -------------------------------------------
+
+#define CDT_AUDIO_RATE				44100
+#define CDT_AUDIO_CHANNELS			2
+#define CDT_AUDIO_BLOCK				512				// frames mixed at a time, ~12 ms
+#define CDT_AUDIO_MAX_SOUND			64
+#define CDT_AUDIO_MAX_VOICE			32
+#define CDT_AUDIO_MIN_GAIN			0.01f			// inaudible under
+#define CDT_AUDIO_MAX_STREAM		2
+#define CDT_AUDIO_STREAM_FRAMES		16384			// ring of a stream, ~370 ms, power of 2
+#define CDT_AUDIO_STREAM_SLEEP		5				// ms between 2 refills of the stream thread
+
+// CDTAudioStream state, the arrows are the only changes:
+//	FREE -> OPENING						main, AudioStreamPlay
+//	OPENING -> PLAYING | FREE			stream thread, once the ring is full | can't open
+//	OPENING | PLAYING -> STOPPING		main, AudioStreamStop
+//	STOPPING | PLAYING -> STOPPED		AudioMix, stopped | at the end of the ring
+//	STOPPING -> FREE					stream thread, stopped while opening
+//	STOPPED -> FREE						stream thread
+#define CDT_STREAM_FREE				0
+#define CDT_STREAM_OPENING			1
+#define CDT_STREAM_PLAYING			2
+#define CDT_STREAM_STOPPING			3
+#define CDT_STREAM_STOPPED			4
+
+#define CDT_AUDIO_NULL				0
+#define CDT_AUDIO_IRRKLANG			1
+
+#if defined(_WIN32)
+#define CDT_HAVE_IRRKLANG
+#define CDT_AUDIO_DEFAULT			CDT_AUDIO_IRRKLANG
+#else
+#define CDT_AUDIO_DEFAULT			CDT_AUDIO_NULL
+#endif
+
+struct CDTSound
+{
+	std::string				name;
+	std::vector<int16_t>	pcm;				// interleaved stereo
+	int						numFrame;
+
+	// set by AudioSetSoundLimit
+	int						priority;			// 0 is the least important
+	int						maxInstance;		// voices of this sound at most
+	float					maxDistance;		// silent from, 0 if not attenuated
+};
+
+struct CDTVoice
+{
+	int				sound;						// -1 if the voice is free
+	int				frame;						// next frame to mix
+	float			volume;
+	float			gain;						// volume with the distance to the listener
+	float			x;
+	float			y;
+	bool			positional;
+	bool			loop;
+	uint32_t		generation;					// bumped when the voice is (re)used
+	uint64_t		start;						// play order, for the oldest voice
+};
+
+// AudioGetStats, the counts are since AudioInit
+struct CDTAudioStats
+{
+	int				numActive;					// voices playing
+	int				numVirtual;					// of them not mixed, too far
+	int				peakActive;
+	int				numPlay;
+	int				numStolen;					// voices taken by a new sound
+	int				numRejected;				// AudioPlay without a voice
+	int				numCulled;					// AudioPlay inaudible at start
+	int				numUnderrun;				// AudioMix with a stream ring short
+	int				numUnderrunFrame;			// silent frames of them
+};
+
+struct CDTAudioStream
+{
+	std::atomic<int>		state;				// CDT_STREAM_
+	std::string				name;				// set before OPENING
+	bool					loop;
+	std::atomic<float>		volume;
+	uint32_t				generation;			// main thread only
+
+	// the stream thread writes the frames then writePos, AudioMix reads them then readPos
+	std::vector<int16_t>	ring;				// CDT_AUDIO_STREAM_FRAMES stereo frames
+	std::atomic<uint32_t>	writePos;			// frames, wraps
+	std::atomic<uint32_t>	readPos;
+	std::atomic<bool>		ended;				// nothing after writePos
+
+	void*					decoder;			// stream thread only
+};
+
+// the output, state is owned by the backend
+struct CDTAudioBackend
+{
+	const char*		name;
+	void*			state;
+
+	bool (*open)(CDTAudioBackend &backend, const char* param);
+	void (*close)(CDTAudioBackend &backend);
+
+	// optional, decode to interleaved 16 bit PCM what the bank can't
+	bool (*decode)(CDTAudioBackend &backend, const char* name, const unsigned char* data, size_t size,
+		std::vector<int16_t> &pcm, int &channels, int &rate);
+};
+
+struct CDTAudio
+{
+	CDTAudioBackend		backend;
+	bool				open;
+	float				masterVolume;
+
+	CDTSound			sounds[CDT_AUDIO_MAX_SOUND];
+	int					numSound;
+	CDTVoice			voices[CDT_AUDIO_MAX_VOICE];
+	uint64_t			numStart;
+	float				listenerX;
+	float				listenerY;
+	CDTAudioStats		stats;
+
+	CDTAudioStream		streams[CDT_AUDIO_MAX_STREAM];
+	std::thread			streamThread;
+	std::mutex			streamLock;				// wake and quit
+	std::condition_variable	streamWake;
+	bool				streamQuit;
+
+	std::mutex			lock;					// bank and voices, held by AudioMix for the voices
+	std::atomic<int>	numUnderrun;			// AudioMix, outside of the lock, in AudioGetStats
+	std::atomic<int>	numUnderrunFrame;
+	std::mutex			decodeLock;				// backend decode
+	std::vector<float>	mixBuffer;
+};
+
+// -------------------------------------------
+// Init & Shutdown
+// -------------------------------------------
+
+// param: wav file written by the null backend, NULL for none
+//	- falls back to the null backend if the device can't be opened
+bool AudioInit(int backend, const char* param);
+void AudioShutdown();
+const char* AudioBackendName();
+
+// -------------------------------------------
+// Sound bank
+// -------------------------------------------
+
+// decode the asset once, -1 if it can't be read or decoded
+int  AudioLoadSound(const char* name);
+int  AudioFindSound(const char* name);
+int  AudioSoundFrames(int sound);
+
+// maxInstance 0 is the whole pool, maxDistance 0 is no attenuation
+void AudioSetSoundLimit(int sound, int priority, int maxInstance, float maxDistance);
+
+// 8/16 bit PCM wav, false if not supported
+bool AudioDecodeWav(const unsigned char* data, size_t size, std::vector<int16_t> &pcm, int &channels, int &rate);
+
+// -------------------------------------------
+// Voices
+// -------------------------------------------
+
+// voice handle, -1 if culled or rejected, a stolen voice handle is
+// only stale (AudioStop does nothing)
+int  AudioPlay(int sound, float volume, bool loop);
+int  AudioPlayAt(int sound, float volume, float x, float y);
+void AudioStop(int voice);
+void AudioStopAll();
+void AudioSetMasterVolume(float volume);
+void AudioSetListener(float x, float y);
+
+void AudioGetStats(CDTAudioStats &stats);
+void AudioPrintStats();
+
+// -------------------------------------------
+// Streams
+// -------------------------------------------
+
+// stream handle, -1 if every stream is used, the asset is opened and
+// decoded by the stream thread, it plays once the ring is full
+int  AudioStreamPlay(const char* name, float volume, bool loop);
+void AudioStreamStop(int stream);
+void AudioStreamSetVolume(int stream, float volume);
+
+// backend thread, mix the next numFrame frames of every voice in out (stereo)
+void AudioMix(int16_t* out, int numFrame);
+
+// -------------------------------------------
+// Backends
+// -------------------------------------------
+
+void AudioBackendNull(CDTAudioBackend &backend);
+bool AudioBackendIrrKlang(CDTAudioBackend &backend);		// false if not built in
+
+
+#endif
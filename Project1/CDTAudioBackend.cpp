@@ -0,0 +1,259 @@
+
+#include "CDTAudio.h"
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+#if defined(CDT_HAVE_IRRKLANG)
+#include <irrKlang.h>
+#endif
+
+// -------------------------------------------
+// Null backend
+//	- a thread mixes CDT_AUDIO_BLOCK frames at the pace of a device
+//	- the frames are written to the wav file given to open, if any
+// -------------------------------------------
+
+struct _NullState
+{
+	std::thread				thread;
+	std::atomic<bool>		quit;
+	std::ofstream			file;
+	uint32_t				numByte;		// of the data chunk
+};
+
+static void _writeWavHeader(std::ofstream &file, uint32_t numByte)
+{
+	unsigned char header[44];
+	uint32_t rate = CDT_AUDIO_RATE, byteRate = CDT_AUDIO_RATE * CDT_AUDIO_CHANNELS * 2;
+	uint32_t riffSize = 36 + numByte, fmtSize = 16;
+	uint16_t format = 1, channels = CDT_AUDIO_CHANNELS, align = CDT_AUDIO_CHANNELS * 2, bits = 16;
+
+	// the fields are little endian, like every target
+	memcpy(header, "RIFF", 4);
+	memcpy(header + 4, &riffSize, 4);
+	memcpy(header + 8, "WAVEfmt ", 8);
+	memcpy(header + 16, &fmtSize, 4);
+	memcpy(header + 20, &format, 2);
+	memcpy(header + 22, &channels, 2);
+	memcpy(header + 24, &rate, 4);
+	memcpy(header + 28, &byteRate, 4);
+	memcpy(header + 32, &align, 2);
+	memcpy(header + 34, &bits, 2);
+	memcpy(header + 36, "data", 4);
+	memcpy(header + 40, &numByte, 4);
+	file.write((const char*)header, sizeof(header));
+}
+
+static void _nullLoop(_NullState* state)
+{
+	int16_t block[CDT_AUDIO_BLOCK * CDT_AUDIO_CHANNELS];
+	std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+	int64_t numFrame = 0;
+
+	while (!state->quit) {
+		AudioMix(block, CDT_AUDIO_BLOCK);
+		numFrame += CDT_AUDIO_BLOCK;
+
+		if (state->file.is_open()) {
+			state->file.write((const char*)block, sizeof(block));
+			state->numByte += sizeof(block);
+		}
+
+		std::this_thread::sleep_until(origin + std::chrono::microseconds(numFrame * 1000000 / CDT_AUDIO_RATE));
+	}
+}
+
+static bool _nullOpen(CDTAudioBackend &backend, const char* param)
+{
+	_NullState* state = new _NullState;
+	state->quit = false;
+	state->numByte = 0;
+
+	if (param != NULL) {
+		state->file.open(param, std::ios::binary | std::ios::trunc);
+		if (state->file.is_open())
+			_writeWavHeader(state->file, 0);
+		else
+			printf("Audio: can't write %s\n", param);
+	}
+
+	state->thread = std::thread(_nullLoop, state);
+	backend.state = state;
+	return true;
+}
+
+static void _nullClose(CDTAudioBackend &backend)
+{
+	_NullState* state = (_NullState*)backend.state;
+	state->quit = true;
+	state->thread.join();
+
+	// the sizes are known now
+	if (state->file.is_open()) {
+		state->file.seekp(0);
+		_writeWavHeader(state->file, state->numByte);
+		state->file.close();
+	}
+
+	delete state;
+	backend.state = NULL;
+}
+
+void AudioBackendNull(CDTAudioBackend &backend)
+{
+	backend.name = "null";
+	backend.state = NULL;
+	backend.open = _nullOpen;
+	backend.close = _nullClose;
+	backend.decode = NULL;
+}
+
+// -------------------------------------------
+// irrKlang backend
+//	- irrKlang plays 1 endless stream, its frames are read from AudioMix
+//	  by the irrKlang thread
+//	- the stream is created by a loader registered for the .cdtmix
+//	  extension, for the dummy source "cdt_mixer.cdtmix"
+//	- decode goes through a temporary irrKlang sound source
+// -------------------------------------------
+
+#if defined(CDT_HAVE_IRRKLANG)
+
+#define CDT_MIXER_SOURCE			"cdt_mixer.cdtmix"
+
+class _MixerStream : public irrklang::IAudioStream
+{
+public:
+	irrklang::SAudioStreamFormat getFormat()
+	{
+		irrklang::SAudioStreamFormat format;
+		format.ChannelCount = CDT_AUDIO_CHANNELS;
+		format.FrameCount = -1;
+		format.SampleRate = CDT_AUDIO_RATE;
+		format.SampleFormat = irrklang::ESF_S16;
+		return format;
+	}
+
+	bool setPosition(irrklang::ik_s32 pos) { return pos == 0; }
+	bool getIsSeekingSupported() { return false; }
+
+	irrklang::ik_s32 readFrames(void* target, irrklang::ik_s32 frameCountToRead)
+	{
+		AudioMix((int16_t*)target, frameCountToRead);
+		return frameCountToRead;
+	}
+};
+
+class _MixerLoader : public irrklang::IAudioStreamLoader
+{
+public:
+	bool isALoadableFileExtension(const irrklang::ik_c8* fileName)
+	{
+		return strstr(fileName, ".cdtmix") != NULL;
+	}
+
+	irrklang::IAudioStream* createAudioStream(irrklang::IFileReader* file)
+	{
+		return new _MixerStream;
+	}
+};
+
+struct _IrrKlangState
+{
+	irrklang::ISoundEngine*		engine;
+	irrklang::ISound*			mixer;
+};
+
+static bool _irrKlangOpen(CDTAudioBackend &backend, const char* param)
+{
+	irrklang::ISoundEngine* engine = irrklang::createIrrKlangDevice();
+	if (engine == NULL)
+		return false;
+
+	_MixerLoader* loader = new _MixerLoader;
+	engine->registerAudioStreamLoader(loader);
+	loader->drop();
+
+	// the source only carries the extension, the loader ignores its bytes
+	static char dummy[16];
+	irrklang::ISoundSource* source = engine->addSoundSourceFromMemory(dummy, sizeof(dummy), CDT_MIXER_SOURCE, false);
+	if (source != NULL)
+		source->setStreamMode(irrklang::ESM_STREAMING);
+
+	irrklang::ISound* mixer = source != NULL ? engine->play2D(source, false, false, true) : NULL;
+	if (mixer == NULL) {
+		engine->drop();
+		return false;
+	}
+
+	_IrrKlangState* state = new _IrrKlangState;
+	state->engine = engine;
+	state->mixer = mixer;
+	backend.state = state;
+	return true;
+}
+
+static void _irrKlangClose(CDTAudioBackend &backend)
+{
+	_IrrKlangState* state = (_IrrKlangState*)backend.state;
+	state->mixer->stop();
+	state->mixer->drop();
+	state->engine->drop();
+	delete state;
+	backend.state = NULL;
+}
+
+static bool _irrKlangDecode(CDTAudioBackend &backend, const char* name, const unsigned char* data, size_t size,
+	std::vector<int16_t> &pcm, int &channels, int &rate)
+{
+	_IrrKlangState* state = (_IrrKlangState*)backend.state;
+
+	// the name keeps the extension, irrKlang picks the decoder from it
+	irrklang::ISoundSource* source = state->engine->addSoundSourceFromMemory((void*)data, (irrklang::ik_s32)size, name, false);
+	if (source == NULL)
+		return false;
+	source->setStreamMode(irrklang::ESM_NO_STREAMING);
+
+	irrklang::SAudioStreamFormat format = source->getAudioFormat();
+	const unsigned char* samples = (const unsigned char*)source->getSampleData();
+	bool decoded = samples != NULL && format.FrameCount > 0;
+
+	if (decoded) {
+		size_t numSample = (size_t)format.FrameCount * format.ChannelCount;
+		pcm.resize(numSample);
+		if (format.SampleFormat == irrklang::ESF_U8) {
+			for (size_t n = 0; n < numSample; n++)
+				pcm[n] = (int16_t)((samples[n] - 128) << 8);
+		}
+		else {
+			memcpy(&pcm[0], samples, numSample * 2);
+		}
+		channels = format.ChannelCount;
+		rate = format.SampleRate;
+	}
+
+	state->engine->removeSoundSource(source);
+	return decoded;
+}
+
+bool AudioBackendIrrKlang(CDTAudioBackend &backend)
+{
+	backend.name = "irrKlang";
+	backend.state = NULL;
+	backend.open = _irrKlangOpen;
+	backend.close = _irrKlangClose;
+	backend.decode = _irrKlangDecode;
+	return true;
+}
+
+#else
+
+bool AudioBackendIrrKlang(CDTAudioBackend &backend)
+{
+	return false;
+}
+
+#endif
@@ -0,0 +1,134 @@
+
+#include "CDTBitGrid.h"
+
+// -------------------------------------------
+// Internal functions
+// -------------------------------------------
+
+//+ Return the count (<= 32) bits of row y starting at x, bit 0 = tile x
+static unsigned int _rowBits(const CDTBitGrid &grid, int x, int y, int count)
+{
+	if (y < 0 || y >= grid.height)
+		return 0;
+
+	unsigned int result = 0;
+	for (int n = 0; n < count; n++) {
+		int bx = x + n;
+		if (bx < 0 || bx >= grid.width)
+			continue;
+
+		// read the rest of the span from the same word at once
+		const uint64_t word = grid.words[y * grid.wordsPerRow + (bx >> 6)];
+		int shift = bx & 63;
+		int take = 64 - shift;
+		if (take > count - n) take = count - n;
+		if (take > grid.width - bx) take = grid.width - bx;
+
+		uint64_t mask = take < 64 ? (((uint64_t)1 << take) - 1) : ~(uint64_t)0;
+		result |= (unsigned int)((word >> shift) & mask) << n;
+		n += take - 1;
+	}
+	return result;
+}
+
+
+// -------------------------------------------
+// Bit grid functions
+// -------------------------------------------
+
+void BitGridInit(CDTBitGrid &grid, int width, int height)
+{
+	grid.width = width;
+	grid.height = height;
+	grid.wordsPerRow = (width + 63) >> 6;
+	grid.storage.assign((size_t)grid.wordsPerRow * height, 0);
+	grid.words = grid.storage.empty() ? NULL : &grid.storage[0];
+}
+
+void BitGridView(CDTBitGrid &grid, int width, int height, uint64_t* words)
+{
+	grid.width = width;
+	grid.height = height;
+	grid.wordsPerRow = (width + 63) >> 6;
+	grid.storage.clear();
+	grid.words = words;
+}
+
+void BitGridFree(CDTBitGrid &grid)
+{
+	grid.storage.clear();
+	grid.words = NULL;
+	grid.width = 0;
+	grid.height = 0;
+	grid.wordsPerRow = 0;
+}
+
+bool BitGridGet(const CDTBitGrid &grid, int x, int y)
+{
+	if (x < 0 || x >= grid.width || y < 0 || y >= grid.height)
+		return false;
+
+	return (grid.words[y * grid.wordsPerRow + (x >> 6)] >> (x & 63)) & 1;
+}
+
+void BitGridSet(CDTBitGrid &grid, int x, int y, bool value)
+{
+	if (x < 0 || x >= grid.width || y < 0 || y >= grid.height)
+		return;
+
+	uint64_t bit = (uint64_t)1 << (x & 63);
+	uint64_t &word = grid.words[y * grid.wordsPerRow + (x >> 6)];
+	if (value)
+		word |= bit;
+	else
+		word &= ~bit;
+}
+
+//+ Mask the first and last words of the span, the ones in between are tested whole
+bool BitGridAnyInSpan(const CDTBitGrid &grid, int y, int x0, int x1)
+{
+	if (y < 0 || y >= grid.height)
+		return false;
+	if (x0 < 0) x0 = 0;
+	if (x1 >= grid.width) x1 = grid.width - 1;
+	if (x0 > x1)
+		return false;
+
+	const uint64_t* row = &grid.words[y * grid.wordsPerRow];
+	int w0 = x0 >> 6, w1 = x1 >> 6;
+	uint64_t firstMask = ~(uint64_t)0 << (x0 & 63);
+	uint64_t lastMask = ~(uint64_t)0 >> (63 - (x1 & 63));
+
+	if (w0 == w1)
+		return (row[w0] & firstMask & lastMask) != 0;
+
+	if (row[w0] & firstMask)
+		return true;
+	for (int w = w0 + 1; w < w1; w++) {
+		if (row[w])
+			return true;
+	}
+	return (row[w1] & lastMask) != 0;
+}
+
+int BitGridFirstSetBelow(const CDTBitGrid &grid, int x, int y)
+{
+	if (x < 0 || x >= grid.width)
+		return -1;
+	if (y >= grid.height)
+		y = grid.height - 1;
+
+	int word = x >> 6, shift = x & 63;
+	for (; y >= 0; y--) {
+		if ((grid.words[y * grid.wordsPerRow + word] >> shift) & 1)
+			return y;
+	}
+	return -1;
+}
+
+unsigned int BitGridMask3x3(const CDTBitGrid &grid, int x, int y)
+{
+	return _rowBits(grid, x - 1, y - 1, 3) |
+		(_rowBits(grid, x - 1, y, 3) << 3) |
+		(_rowBits(grid, x - 1, y + 1, 3) << 6);
+}
@@ -0,0 +1,49 @@
+
+#ifndef CDT_BIT_GRID
+#define CDT_BIT_GRID
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+
+// -------------------------------------------
+// CDT bit grid
+//	- 1 bit per tile, each row is stored as contiguous 64 bit words
+//	  so a row of 64 tiles is 1 word and the whole map is 1 buffer
+//	- bit x of a row is bit (x & 63) of word (x >> 6)
+//	- outside of the grid always reads as 0
+//	- the words are owned by the grid (BitGridInit) or are a view on
+//	  memory owned by someone else, ex. a mapped level file (BitGridView)
+// -------------------------------------------
+
+struct CDTBitGrid
+{
+	int				width;
+	int				height;
+	int				wordsPerRow;
+	uint64_t*		words;					// words[y * wordsPerRow + (x >> 6)]
+	std::vector<uint64_t>	storage;		// words of an owning grid, empty for a view
+};
+
+// -------------------------------------------
+// Bit grid functions
+// -------------------------------------------
+
+void BitGridInit(CDTBitGrid &grid, int width, int height);
+void BitGridView(CDTBitGrid &grid, int width, int height, uint64_t* words);
+void BitGridFree(CDTBitGrid &grid);
+bool BitGridGet(const CDTBitGrid &grid, int x, int y);
+void BitGridSet(CDTBitGrid &grid, int x, int y, bool value);
+
+// true if any bit of row y is set in [x0,x1]
+bool BitGridAnyInSpan(const CDTBitGrid &grid, int y, int x0, int x1);
+
+// the biggest y' <= y with bit (x,y') set, -1 if none
+int  BitGridFirstSetBelow(const CDTBitGrid &grid, int x, int y);
+
+// bits of the 3x3 block around (x,y), bit (dy+1)*3 + (dx+1) for dx,dy in [-1,1]
+unsigned int BitGridMask3x3(const CDTBitGrid &grid, int x, int y);
+
+
+#endif
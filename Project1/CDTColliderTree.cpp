@@ -0,0 +1,216 @@
+
+#include "CDTColliderTree.h"
+#include <algorithm>
+
+// -------------------------------------------
+// Internal functions
+// -------------------------------------------
+
+static bool _rectOverlap(const CDTRect &a, const CDTRect &b)
+{
+	return a.minX < b.maxX && b.minX < a.maxX && a.minY < b.maxY && b.minY < a.maxY;
+}
+
+static void _rectUnion(CDTRect &a, const CDTRect &b)
+{
+	if (b.minX < a.minX) a.minX = b.minX;
+	if (b.minY < a.minY) a.minY = b.minY;
+	if (b.maxX > a.maxX) a.maxX = b.maxX;
+	if (b.maxY > a.maxY) a.maxY = b.maxY;
+}
+
+//+ Slab test of the ray against the rect, tEnter is the entry parameter
+static bool _rayRect(const CDTRect &r, float x, float y, float invX, float invY, float maxT, float &tEnter)
+{
+	float tx0 = (r.minX - x) * invX, tx1 = (r.maxX - x) * invX;
+	float ty0 = (r.minY - y) * invY, ty1 = (r.maxY - y) * invY;
+	float tMin = std::max(std::min(tx0, tx1), std::min(ty0, ty1));
+	float tMax = std::min(std::max(tx0, tx1), std::max(ty0, ty1));
+
+	if (tMax < 0.0f || tMin > tMax || tMin > maxT)
+		return false;
+
+	tEnter = tMin < 0.0f ? 0.0f : tMin;
+	return true;
+}
+
+struct _CompareCenter
+{
+	int axis;
+	bool operator()(const CDTRect &a, const CDTRect &b) const
+	{
+		if (axis == 0)
+			return a.minX + a.maxX < b.minX + b.maxX;
+		return a.minY + a.maxY < b.minY + b.maxY;
+	}
+};
+
+//+ Build the node of rects [first, first+count), split at the median of the longest axis
+static int _buildNode(CDTColliderTree &tree, int first, int count)
+{
+	int index = (int)tree.nodes.size();
+	tree.nodes.push_back(CDTTreeNode());
+
+	CDTRect box = tree.rects[first];
+	for (int i = first + 1; i < first + count; i++)
+		_rectUnion(box, tree.rects[i]);
+
+	if (count <= CDT_TREE_LEAF_SIZE) {
+		CDTTreeNode &leaf = tree.nodes[index];
+		leaf.box = box;
+		leaf.left = leaf.right = -1;
+		leaf.firstRect = first;
+		leaf.numRect = count;
+		return index;
+	}
+
+	_CompareCenter compare;
+	compare.axis = (box.maxX - box.minX >= box.maxY - box.minY) ? 0 : 1;
+	int half = count / 2;
+	std::nth_element(tree.rects.begin() + first, tree.rects.begin() + first + half, tree.rects.begin() + first + count, compare);
+
+	int left = _buildNode(tree, first, half);
+	int right = _buildNode(tree, first + half, count - half);
+
+	// nodes may have moved while building the children
+	CDTTreeNode &node = tree.nodes[index];
+	node.box = box;
+	node.left = left;
+	node.right = right;
+	node.firstRect = first;
+	node.numRect = 0;
+	return index;
+}
+
+
+// -------------------------------------------
+// Collider tree functions
+// -------------------------------------------
+
+void MergeSolidRects(const CDTBitGrid &grid, std::vector<CDTRect> &out)
+{
+	CDTBitGrid used;
+	BitGridInit(used, grid.width, grid.height);
+
+	for (int y = 0; y < grid.height; y++) {
+		for (int x = 0; x < grid.width; x++) {
+			if (!BitGridGet(grid, x, y) || BitGridGet(used, x, y))
+				continue;
+
+			// grow the run to the right
+			int w = 1;
+			while (x + w < grid.width && BitGridGet(grid, x + w, y) && !BitGridGet(used, x + w, y))
+				w++;
+
+			// grow it up while the whole run is free and solid
+			int h = 1;
+			for (; y + h < grid.height; h++) {
+				bool full = true;
+				for (int n = 0; n < w && full; n++)
+					full = BitGridGet(grid, x + n, y + h) && !BitGridGet(used, x + n, y + h);
+				if (!full)
+					break;
+			}
+
+			for (int ry = y; ry < y + h; ry++) {
+				for (int rx = x; rx < x + w; rx++)
+					BitGridSet(used, rx, ry, true);
+			}
+
+			CDTRect rect = { (float)x, (float)y, (float)(x + w), (float)(y + h) };
+			out.push_back(rect);
+			x += w - 1;
+		}
+	}
+}
+
+void ColliderTreeBuild(CDTColliderTree &tree, const CDTRect* rects, int numRect)
+{
+	tree.rects.assign(rects, rects + numRect);
+	tree.nodes.clear();
+
+	if (!tree.rects.empty())
+		_buildNode(tree, 0, (int)tree.rects.size());
+}
+
+void ColliderTreeBuild(CDTColliderTree &tree, const CDTBitGrid &grid)
+{
+	std::vector<CDTRect> rects;
+	MergeSolidRects(grid, rects);
+	ColliderTreeBuild(tree, rects.empty() ? NULL : &rects[0], (int)rects.size());
+}
+
+void ColliderTreeFree(CDTColliderTree &tree)
+{
+	tree.rects.clear();
+	tree.nodes.clear();
+}
+
+void ColliderTreeQuery(const CDTColliderTree &tree, const CDTRect &box, std::vector<int> &out)
+{
+	if (tree.nodes.empty())
+		return;
+
+	int stack[CDT_TREE_MAX_DEPTH];
+	int top = 0;
+	stack[top++] = 0;
+
+	while (top > 0) {
+		const CDTTreeNode &node = tree.nodes[stack[--top]];
+		if (!_rectOverlap(node.box, box))
+			continue;
+
+		if (node.left < 0) {
+			for (int i = node.firstRect; i < node.firstRect + node.numRect; i++) {
+				if (_rectOverlap(tree.rects[i], box))
+					out.push_back(i);
+			}
+			continue;
+		}
+
+		stack[top++] = node.left;
+		stack[top++] = node.right;
+	}
+}
+
+//+ Visit the nodes the ray goes through, skip the ones that start after the best hit so far
+bool ColliderTreeRaycast(const CDTColliderTree &tree, float x, float y, float dirX, float dirY, float maxT, float &t, int &rect)
+{
+	if (tree.nodes.empty())
+		return false;
+
+	float invX = dirX != 0.0f ? 1.0f / dirX : 1e30f;
+	float invY = dirY != 0.0f ? 1.0f / dirY : 1e30f;
+	float best = maxT;
+	bool found = false;
+
+	int stack[CDT_TREE_MAX_DEPTH];
+	int top = 0;
+	stack[top++] = 0;
+
+	while (top > 0) {
+		const CDTTreeNode &node = tree.nodes[stack[--top]];
+		float tNode;
+		if (!_rayRect(node.box, x, y, invX, invY, best, tNode))
+			continue;
+
+		if (node.left < 0) {
+			for (int i = node.firstRect; i < node.firstRect + node.numRect; i++) {
+				float tRect;
+				if (_rayRect(tree.rects[i], x, y, invX, invY, best, tRect) && (!found || tRect < best)) {
+					best = tRect;
+					rect = i;
+					found = true;
+				}
+			}
+			continue;
+		}
+
+		stack[top++] = node.left;
+		stack[top++] = node.right;
+	}
+
+	if (found)
+		t = best;
+	return found;
+}
@@ -0,0 +1,62 @@
+
+#ifndef CDT_COLLIDER_TREE
+#define CDT_COLLIDER_TREE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "CDTBitGrid.h"
+
+// -------------------------------------------
+// CDT collider tree
+//	- the solid tiles of a CDTBitGrid are merged into maximal
+//	  rectangles at load time (greedy: grow a run to the right, then
+//	  grow it up while the rows above are solid on the whole run)
+//	- the rectangles are put in a static AABB tree, built once and
+//	  only read after, so queries can run from many threads
+//	- same space as CDTCollision: 1 tile = 1 unit, y up
+// -------------------------------------------
+
+#define CDT_TREE_LEAF_SIZE			4				// max #rect in a leaf
+#define CDT_TREE_MAX_DEPTH			64				// size of the traversal stack
+
+struct CDTRect
+{
+	float			minX, minY;
+	float			maxX, maxY;
+};
+
+struct CDTTreeNode
+{
+	CDTRect			box;					// bound of everything below the node
+	int				left;					// children, -1 for a leaf
+	int				right;
+	int				firstRect;				// leaf only, rects [firstRect, firstRect+numRect)
+	int				numRect;
+};
+
+struct CDTColliderTree
+{
+	std::vector<CDTRect>		rects;		// sorted so the rects of a leaf are contiguous
+	std::vector<CDTTreeNode>	nodes;		// nodes[0] is the root
+};
+
+// -------------------------------------------
+// Collider tree functions
+// -------------------------------------------
+
+// merge the set bits of the grid into rectangles, appended to out
+void MergeSolidRects(const CDTBitGrid &grid, std::vector<CDTRect> &out);
+
+void ColliderTreeBuild(CDTColliderTree &tree, const CDTRect* rects, int numRect);
+void ColliderTreeBuild(CDTColliderTree &tree, const CDTBitGrid &grid);
+void ColliderTreeFree(CDTColliderTree &tree);
+
+// index of the rects overlapping the box (touching does not count), appended to out
+void ColliderTreeQuery(const CDTColliderTree &tree, const CDTRect &box, std::vector<int> &out);
+
+// first rect hit by the ray (x,y) + t*(dirX,dirY), t in [0,maxT]
+bool ColliderTreeRaycast(const CDTColliderTree &tree, float x, float y, float dirX, float dirY, float maxT, float &t, int &rect);
+
+
+#endif
@@ -0,0 +1,192 @@
+
+#include "CDTCollision.h"
+#include <math.h>
+
+// a box that ends a move exactly on a rect edge must not count as overlapping it
+#define CDT_CONTACT_EPSILON			1e-4f
+
+// -------------------------------------------
+// Internal functions
+// -------------------------------------------
+
+//+ Swept test of the box against a solid rect (slab test of the center against the rect expanded by the box)
+//	- only faces the box is moving into count, a box that is touching
+//	  or already inside the rect is let go
+static bool _sweepRect(const CDTRect &r, float x, float y, float halfW, float halfH, float dx, float dy, CDTSweepHit &hit)
+{
+	float minX = r.minX - halfW, maxX = r.maxX + halfW;
+	float minY = r.minY - halfH, maxY = r.maxY + halfH;
+	float entryX, exitX, entryY, exitY;
+
+	if (dx == 0.0f) {
+		if (x <= minX || x >= maxX)
+			return false;
+		entryX = -1e30f;
+		exitX = 1e30f;
+	}
+	else {
+		float t0 = (minX - x) / dx, t1 = (maxX - x) / dx;
+		entryX = t0 < t1 ? t0 : t1;
+		exitX = t0 < t1 ? t1 : t0;
+	}
+
+	if (dy == 0.0f) {
+		if (y <= minY || y >= maxY)
+			return false;
+		entryY = -1e30f;
+		exitY = 1e30f;
+	}
+	else {
+		float t0 = (minY - y) / dy, t1 = (maxY - y) / dy;
+		entryY = t0 < t1 ? t0 : t1;
+		exitY = t0 < t1 ? t1 : t0;
+	}
+
+	float entry = entryX > entryY ? entryX : entryY;
+	float exit = exitX < exitY ? exitX : exitY;
+
+	// the boxes never overlap, or they start overlapping, or not in this move
+	if (entry >= exit || entry < -CDT_CONTACT_EPSILON || entry > 1.0f)
+		return false;
+
+	// landing exactly on a corner counts as landing on the floor
+	hit.time = entry < 0.0f ? 0.0f : entry;
+	hit.rect = -1;
+	if (entryX > entryY) {
+		hit.normalX = dx > 0.0f ? -1.0f : 1.0f;
+		hit.normalY = 0.0f;
+		hit.face = dx > 0.0f ? r.minX : r.maxX;
+	}
+	else {
+		hit.normalX = 0.0f;
+		hit.normalY = dy > 0.0f ? -1.0f : 1.0f;
+		hit.face = dy > 0.0f ? r.minY : r.maxY;
+	}
+	return true;
+}
+
+//+ Sweep, stop at the hit, then sweep what is left of the move along the wall
+//	- at most 1 hit per axis, so 2 sweeps and a last free move
+static int _moveBox(const CDTColliderTree &tree, float &x, float &y, float halfW, float halfH, float &velX, float &velY, float dx, float dy)
+{
+	int flags = 0;
+
+	for (int n = 0; n < 3; n++) {
+		if (dx == 0.0f && dy == 0.0f)
+			break;
+
+		CDTSweepHit hit;
+		if (n == 2 || !SweepBoxRects(tree, x, y, halfW, halfH, dx, dy, hit)) {
+			x += dx;
+			y += dy;
+			break;
+		}
+
+		x += dx * hit.time;
+		y += dy * hit.time;
+		dx *= 1.0f - hit.time;
+		dy *= 1.0f - hit.time;
+
+		// snap on the face so the box rest exactly on the edge
+		if (hit.normalX != 0.0f) {
+			x = hit.face + hit.normalX * halfW;
+			flags |= hit.normalX > 0.0f ? CDT_COLLISION_LEFT : CDT_COLLISION_RIGHT;
+			velX = 0.0f;
+			dx = 0.0f;
+		}
+		else {
+			y = hit.face + hit.normalY * halfH;
+			flags |= hit.normalY > 0.0f ? CDT_COLLISION_BOTTOM : CDT_COLLISION_TOP;
+			velY = 0.0f;
+			dy = 0.0f;
+		}
+	}
+
+	return flags;
+}
+
+
+// -------------------------------------------
+// Collision functions
+// -------------------------------------------
+
+//+ Walk the tree with the box swept over the whole move, only the rects under
+//	it are tested (no allocation, the sweeps run in parallel)
+bool SweepBoxRects(const CDTColliderTree &tree, float x, float y, float halfW, float halfH, float dx, float dy, CDTSweepHit &hit)
+{
+	if (tree.nodes.empty())
+		return false;
+
+	CDTRect swept;
+	swept.minX = (dx < 0.0f ? x + dx : x) - halfW;
+	swept.maxX = (dx > 0.0f ? x + dx : x) + halfW;
+	swept.minY = (dy < 0.0f ? y + dy : y) - halfH;
+	swept.maxY = (dy > 0.0f ? y + dy : y) + halfH;
+
+	bool found = false;
+	int stack[CDT_TREE_MAX_DEPTH];
+	int top = 0;
+	stack[top++] = 0;
+
+	while (top > 0) {
+		const CDTTreeNode &node = tree.nodes[stack[--top]];
+		const CDTRect &b = node.box;
+		if (b.minX > swept.maxX || swept.minX > b.maxX || b.minY > swept.maxY || swept.minY > b.maxY)
+			continue;
+
+		if (node.left >= 0) {
+			stack[top++] = node.left;
+			stack[top++] = node.right;
+			continue;
+		}
+
+		for (int i = node.firstRect; i < node.firstRect + node.numRect; i++) {
+			CDTSweepHit rectHit;
+			if (_sweepRect(tree.rects[i], x, y, halfW, halfH, dx, dy, rectHit) && (!found || rectHit.time < hit.time)) {
+				hit = rectHit;
+				hit.rect = i;
+				found = true;
+			}
+		}
+	}
+	return found;
+}
+
+int MoveBoxRects(const CDTColliderTree &tree, float &x, float &y, float halfW, float halfH, float &velX, float &velY, float dx, float dy)
+{
+	return _moveBox(tree, x, y, halfW, halfH, velX, velY, dx, dy);
+}
+
+//+ The bottom of the box must be on the top face of a rect under it
+bool BoxOnGroundRects(const CDTColliderTree &tree, float x, float y, float halfW, float halfH)
+{
+	if (tree.nodes.empty())
+		return false;
+
+	float bottom = y - halfH;
+	float minX = x - halfW + CDT_CONTACT_EPSILON, maxX = x + halfW - CDT_CONTACT_EPSILON;
+
+	int stack[CDT_TREE_MAX_DEPTH];
+	int top = 0;
+	stack[top++] = 0;
+
+	while (top > 0) {
+		const CDTTreeNode &node = tree.nodes[stack[--top]];
+		const CDTRect &b = node.box;
+		if (b.minX >= maxX || minX >= b.maxX || b.minY > bottom || bottom > b.maxY + CDT_CONTACT_EPSILON)
+			continue;
+
+		if (node.left >= 0) {
+			stack[top++] = node.left;
+			stack[top++] = node.right;
+			continue;
+		}
+
+		for (int i = node.firstRect; i < node.firstRect + node.numRect; i++) {
+			const CDTRect &r = tree.rects[i];
+			if (r.minX < maxX && minX < r.maxX && fabsf(r.maxY - bottom) <= CDT_CONTACT_EPSILON)
+				return true;
+		}
+	}
+	return false;
+}
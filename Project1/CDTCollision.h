@@ -0,0 +1,51 @@
+
+#ifndef CDT_COLLISION
+#define CDT_COLLISION
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "CDTColliderTree.h"
+
+// -------------------------------------------
+// CDT tile collision
+//	- boxes are given by center and half size in map space,
+//	  x to the right, y up, 1 tile = 1 unit
+//	- tile (x,y) cover [x,x+1] x [y,y+1], so tile y = 0 is the
+//	  bottom row of the map (the last line of the map file)
+//	- the map is the solid tiles merged into the rects of a CDTColliderTree
+//	- moves are swept: the box is traced from its start to its end
+//	  position, so fast bodies and long frames can't tunnel
+// -------------------------------------------
+
+// same bits as the collision flags of the game states
+#define CDT_COLLISION_LEFT			1<<0
+#define CDT_COLLISION_RIGHT			1<<1
+#define CDT_COLLISION_TOP			1<<2
+#define CDT_COLLISION_BOTTOM		1<<3
+
+struct CDTSweepHit
+{
+	float			time;					// [0,1] fraction of the move done before the hit
+	float			normalX;				// normal of the face that was hit
+	float			normalY;
+	float			face;					// x (normalX != 0) or y of the face that was hit
+	int				rect;					// rect that was hit
+};
+
+// -------------------------------------------
+// Collision functions
+// -------------------------------------------
+
+// trace the box along (dx,dy), return true and the first hit if it touch a solid rect
+bool SweepBoxRects(const CDTColliderTree &tree, float x, float y, float halfW, float halfH, float dx, float dy, CDTSweepHit &hit);
+
+// move the box by (dx,dy), stop at walls and slide along them
+//	- the velocity along the normal of each hit face is set to 0
+//	- return the CDT_COLLISION_ flags of the faces that were hit
+int  MoveBoxRects(const CDTColliderTree &tree, float &x, float &y, float halfW, float halfH, float &velX, float &velY, float dx, float dy);
+
+// true if the bottom of the box rest on a solid rect
+bool BoxOnGroundRects(const CDTColliderTree &tree, float x, float y, float halfW, float halfH);
+
+
+#endif
@@ -0,0 +1,122 @@
+
+#include "CDTFile.h"
+#include <fstream>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <direct.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// -------------------------------------------
+// File functions
+// -------------------------------------------
+
+bool FileMap(CDTMappedFile &file, const char* path)
+{
+	file.data = NULL;
+	file.size = 0;
+	file.fileHandle = NULL;
+	file.mapHandle = NULL;
+
+#if defined(_WIN32)
+	HANDLE fh = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (fh == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(fh, &size) || size.QuadPart == 0) {
+		CloseHandle(fh);
+		return false;
+	}
+
+	HANDLE mh = CreateFileMappingA(fh, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	if (mh == NULL) {
+		CloseHandle(fh);
+		return false;
+	}
+
+	void* view = MapViewOfFile(mh, FILE_MAP_COPY, 0, 0, 0);
+	if (view == NULL) {
+		CloseHandle(mh);
+		CloseHandle(fh);
+		return false;
+	}
+
+	file.data = (unsigned char*)view;
+	file.size = (size_t)size.QuadPart;
+	file.fileHandle = fh;
+	file.mapHandle = mh;
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		return false;
+	}
+
+	void* view = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (view == MAP_FAILED)
+		return false;
+
+	file.data = (unsigned char*)view;
+	file.size = (size_t)st.st_size;
+#endif
+
+	return true;
+}
+
+void FileUnmap(CDTMappedFile &file)
+{
+	if (file.data == NULL)
+		return;
+
+#if defined(_WIN32)
+	UnmapViewOfFile(file.data);
+	CloseHandle((HANDLE)file.mapHandle);
+	CloseHandle((HANDLE)file.fileHandle);
+#else
+	munmap(file.data, file.size);
+#endif
+
+	file.data = NULL;
+	file.size = 0;
+	file.fileHandle = NULL;
+	file.mapHandle = NULL;
+}
+
+bool FileWrite(const char* path, const void* data, size_t size)
+{
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+		return false;
+
+	out.write((const char*)data, (std::streamsize)size);
+	out.close();
+	return !out.fail();
+}
+
+bool FileMakeDir(const char* path)
+{
+#if defined(_WIN32)
+	if (_mkdir(path) == 0)
+		return true;
+	DWORD attributes = GetFileAttributesA(path);
+	return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+	if (mkdir(path, 0755) == 0)
+		return true;
+	struct stat st;
+	return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+#endif
+}
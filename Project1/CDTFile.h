@@ -0,0 +1,39 @@
+
+#ifndef CDT_FILE
+#define CDT_FILE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+
+// -------------------------------------------
+// CDT mapped file
+//	- the whole file is mapped in memory, pages are read by the OS
+//	  when they are first touched, so opening is O(1) in the file size
+//	- the mapping is copy on write: the data can be changed in place,
+//	  the changes are private to the process and never reach the file
+// -------------------------------------------
+
+struct CDTMappedFile
+{
+	unsigned char*	data;					// NULL if not mapped
+	size_t			size;
+	void*			fileHandle;				// platform handles
+	void*			mapHandle;
+};
+
+// -------------------------------------------
+// File functions
+// -------------------------------------------
+
+bool FileMap(CDTMappedFile &file, const char* path);
+void FileUnmap(CDTMappedFile &file);
+
+// write size bytes to path, return false on error
+bool FileWrite(const char* path, const void* data, size_t size);
+
+// create the directory if it doesn't exist, return false on error
+bool FileMakeDir(const char* path);
+
+
+#endif
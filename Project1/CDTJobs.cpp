@@ -0,0 +1,277 @@
+
+#include "CDTJobs.h"
+#include <deque>
+#include <thread>
+#include <condition_variable>
+
+// -------------------------------------------
+// CDT job global variables
+// -------------------------------------------
+
+struct CDTWorkerQueue
+{
+	std::mutex			lock;
+	std::deque<CDTJob>	jobs;
+	char				pad[64];			// keep queues of different workers on different cache lines
+};
+
+static CDTWorkerQueue			cdt_queues[CDT_JOB_MAX_WORKER];
+static std::thread				cdt_threads[CDT_JOB_MAX_WORKER];
+static int						cdt_numworker = 1;
+static std::atomic<bool>		cdt_jobrunning(false);
+static std::atomic<int>			cdt_jobpending(0);
+static std::mutex				cdt_sleeplock;
+static std::condition_variable	cdt_sleepcv;
+static thread_local int			cdt_workerindex = 0;
+
+struct CDTRangeJob
+{
+	CDTRangeFunc		func;
+	void*				ctx;
+	int					begin;
+	int					end;
+};
+
+
+// -------------------------------------------
+// Internal functions
+// -------------------------------------------
+
+static void _pushJob(const CDTJob& job)
+{
+	CDTWorkerQueue& queue = cdt_queues[cdt_workerindex];
+	{
+		std::lock_guard<std::mutex> guard(queue.lock);
+		queue.jobs.push_back(job);
+	}
+
+	// under the sleep lock, a worker between its check and its wait can't miss the notify
+	{
+		std::lock_guard<std::mutex> guard(cdt_sleeplock);
+		cdt_jobpending++;
+	}
+	cdt_sleepcv.notify_one();
+}
+
+//+ Get a job, own queue first (newest job), then steal the oldest job of other workers
+static bool _popJob(CDTJob& job)
+{
+	{
+		CDTWorkerQueue& queue = cdt_queues[cdt_workerindex];
+		std::lock_guard<std::mutex> guard(queue.lock);
+		if (!queue.jobs.empty()) {
+			job = queue.jobs.back();
+			queue.jobs.pop_back();
+			cdt_jobpending--;
+			return true;
+		}
+	}
+
+	for (int i = 1; i < cdt_numworker; i++) {
+		CDTWorkerQueue& victim = cdt_queues[(cdt_workerindex + i) % cdt_numworker];
+		std::lock_guard<std::mutex> guard(victim.lock);
+		if (!victim.jobs.empty()) {
+			job = victim.jobs.front();
+			victim.jobs.pop_front();
+			cdt_jobpending--;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void _finishJob(CDTJobCounter* counter)
+{
+	if (counter == NULL)
+		return;
+
+	// when the counter reach 0, release the jobs that were waiting for it
+	std::vector<CDTJob> ready;
+	{
+		std::lock_guard<std::mutex> guard(counter->lock);
+		if (--counter->value == 0)
+			ready.swap(counter->continuations);
+	}
+	for (size_t i = 0; i < ready.size(); i++) {
+		_pushJob(ready[i]);
+	}
+}
+
+static void _executeJob(const CDTJob& job)
+{
+	job.func(job.data);
+	_finishJob(job.counter);
+}
+
+static void _workerLoop(int index)
+{
+	cdt_workerindex = index;
+
+	while (cdt_jobrunning) {
+		CDTJob job;
+		if (_popJob(job)) {
+			_executeJob(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> guard(cdt_sleeplock);
+		cdt_sleepcv.wait(guard, [] { return cdt_jobpending > 0 || !cdt_jobrunning; });
+	}
+}
+
+static void _rangeJob(void* data)
+{
+	CDTRangeJob* range = (CDTRangeJob*)data;
+	range->func(range->begin, range->end, range->ctx);
+}
+
+
+// -------------------------------------------
+// Init & Shutdown
+// -------------------------------------------
+
+void JobSystemInit(int numWorker)
+{
+	if (numWorker <= 0)
+		numWorker = (int)std::thread::hardware_concurrency();
+	if (numWorker <= 0)
+		numWorker = 1;
+	if (numWorker > CDT_JOB_MAX_WORKER)
+		numWorker = CDT_JOB_MAX_WORKER;
+
+	cdt_numworker = numWorker;
+	cdt_workerindex = 0;
+	cdt_jobrunning = true;
+
+	for (int i = 1; i < cdt_numworker; i++) {
+		cdt_threads[i] = std::thread(_workerLoop, i);
+	}
+
+	printf("Job system: %d workers\n", cdt_numworker);
+}
+
+void JobSystemShutdown()
+{
+	{
+		std::lock_guard<std::mutex> guard(cdt_sleeplock);
+		cdt_jobrunning = false;
+	}
+	cdt_sleepcv.notify_all();
+
+	for (int i = 1; i < cdt_numworker; i++) {
+		if (cdt_threads[i].joinable())
+			cdt_threads[i].join();
+	}
+	cdt_numworker = 1;
+}
+
+int JobWorkerCount()
+{
+	return cdt_numworker;
+}
+
+int JobWorkerIndex()
+{
+	return cdt_workerindex;
+}
+
+// -------------------------------------------
+// Job functions
+// -------------------------------------------
+
+void JobRun(CDTJobFunc func, void* data, CDTJobCounter* counter)
+{
+	CDTJob job;
+	job.func = func;
+	job.data = data;
+	job.counter = counter;
+
+	if (counter)
+		counter->value++;
+
+	// no worker thread, just run it
+	if (cdt_numworker <= 1) {
+		_executeJob(job);
+		return;
+	}
+
+	_pushJob(job);
+}
+
+void JobRunAfter(CDTJobCounter* dependency, CDTJobFunc func, void* data, CDTJobCounter* counter)
+{
+	if (dependency != NULL) {
+		std::lock_guard<std::mutex> guard(dependency->lock);
+		if (dependency->value > 0) {
+			CDTJob job;
+			job.func = func;
+			job.data = data;
+			job.counter = counter;
+
+			if (counter)
+				counter->value++;
+			dependency->continuations.push_back(job);
+			return;
+		}
+	}
+
+	JobRun(func, data, counter);
+}
+
+//+ Wait until every job of the counter is done, the waiting thread help running jobs
+void JobWait(CDTJobCounter* counter)
+{
+	while (counter->value > 0) {
+		CDTJob job;
+		if (_popJob(job)) {
+			_executeJob(job);
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+
+	// the last job may still hold the lock, the counter can be freed only after it let go
+	std::lock_guard<std::mutex> guard(counter->lock);
+}
+
+bool JobTryRun()
+{
+	CDTJob job;
+	if (!_popJob(job))
+		return false;
+
+	_executeJob(job);
+	return true;
+}
+
+void ParallelFor(int count, int grain, CDTRangeFunc func, void* ctx)
+{
+	if (count <= 0)
+		return;
+	if (grain < 1)
+		grain = 1;
+
+	if (cdt_numworker <= 1 || count <= grain) {
+		func(0, count, ctx);
+		return;
+	}
+
+	std::vector<CDTRangeJob> ranges;
+	ranges.reserve((count + grain - 1) / grain);
+	for (int begin = 0; begin < count; begin += grain) {
+		CDTRangeJob range;
+		range.func = func;
+		range.ctx = ctx;
+		range.begin = begin;
+		range.end = begin + grain < count ? begin + grain : count;
+		ranges.push_back(range);
+	}
+
+	CDTJobCounter counter;
+	for (size_t i = 0; i < ranges.size(); i++) {
+		JobRun(_rangeJob, &ranges[i], &counter);
+	}
+	JobWait(&counter);
+}
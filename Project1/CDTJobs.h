@@ -0,0 +1,65 @@
+
+#ifndef CDT_JOBS
+#define CDT_JOBS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <atomic>
+#include <mutex>
+
+// -------------------------------------------
+// CDT job system
+//	- 1 worker thread per core, the main thread is worker 0
+//	- each worker has its own deque, the owner push/pop at the back,
+//	  idle workers steal from the front of the others
+//	- a counter is decremented when each of its jobs is done,
+//	  JobWait and JobRunAfter use it as the dependency between jobs
+// -------------------------------------------
+
+#define CDT_JOB_MAX_WORKER			32
+
+typedef void(*CDTJobFunc)(void* data);
+typedef void(*CDTRangeFunc)(int begin, int end, void* ctx);
+
+struct CDTJob
+{
+	CDTJobFunc			func;
+	void*				data;
+	struct CDTJobCounter* counter;			// decremented when the job is done, can be NULL
+};
+
+struct CDTJobCounter
+{
+	std::atomic<int>	value;
+	std::mutex			lock;
+	std::vector<CDTJob>	continuations;		// jobs waiting for value to reach 0
+
+	CDTJobCounter() : value(0) {}
+};
+
+// -------------------------------------------
+// Init & Shutdown
+// -------------------------------------------
+
+void JobSystemInit(int numWorker);			// 0 = use every core
+void JobSystemShutdown();
+int  JobWorkerCount();
+int  JobWorkerIndex();						// [0, JobWorkerCount()), 0 is the main thread
+
+// -------------------------------------------
+// Job functions
+// -------------------------------------------
+
+void JobRun(CDTJobFunc func, void* data, CDTJobCounter* counter);
+void JobRunAfter(CDTJobCounter* dependency, CDTJobFunc func, void* data, CDTJobCounter* counter);
+void JobWait(CDTJobCounter* counter);
+
+// run 1 pending job on the calling thread, false if there was none
+bool JobTryRun();
+
+// split [0,count) in ranges of about grain items and run them on every worker
+void ParallelFor(int count, int grain, CDTRangeFunc func, void* ctx);
+
+
+#endif
@@ -0,0 +1,274 @@
+
+#include "CDTJson.h"
+#include <string.h>
+#include <fstream>
+#include <sstream>
+
+// nested arrays/objects deeper than this are refused, the parser is recursive
+#define CDT_JSON_MAX_DEPTH			128
+
+struct CDTJsonReader
+{
+	const char*		text;
+	size_t			size;
+	size_t			pos;
+};
+
+// -------------------------------------------
+// Internal functions
+// -------------------------------------------
+
+static void _skipSpace(CDTJsonReader &r)
+{
+	while (r.pos < r.size && (r.text[r.pos] == ' ' || r.text[r.pos] == '\t' || r.text[r.pos] == '\n' || r.text[r.pos] == '\r'))
+		r.pos++;
+}
+
+static bool _match(CDTJsonReader &r, const char* word)
+{
+	size_t len = strlen(word);
+	if (r.size - r.pos < len || strncmp(r.text + r.pos, word, len) != 0)
+		return false;
+	r.pos += len;
+	return true;
+}
+
+static void _appendUtf8(std::string &out, unsigned int c)
+{
+	if (c < 0x80) {
+		out += (char)c;
+	}
+	else if (c < 0x800) {
+		out += (char)(0xC0 | (c >> 6));
+		out += (char)(0x80 | (c & 0x3F));
+	}
+	else if (c < 0x10000) {
+		out += (char)(0xE0 | (c >> 12));
+		out += (char)(0x80 | ((c >> 6) & 0x3F));
+		out += (char)(0x80 | (c & 0x3F));
+	}
+	else {
+		out += (char)(0xF0 | (c >> 18));
+		out += (char)(0x80 | ((c >> 12) & 0x3F));
+		out += (char)(0x80 | ((c >> 6) & 0x3F));
+		out += (char)(0x80 | (c & 0x3F));
+	}
+}
+
+static bool _parseHex4(CDTJsonReader &r, unsigned int &c)
+{
+	if (r.size - r.pos < 4)
+		return false;
+
+	c = 0;
+	for (int n = 0; n < 4; n++) {
+		char h = r.text[r.pos++];
+		c <<= 4;
+		if (h >= '0' && h <= '9') c |= h - '0';
+		else if (h >= 'a' && h <= 'f') c |= h - 'a' + 10;
+		else if (h >= 'A' && h <= 'F') c |= h - 'A' + 10;
+		else return false;
+	}
+	return true;
+}
+
+static bool _parseString(CDTJsonReader &r, std::string &out)
+{
+	// opening quote already checked by the caller
+	r.pos++;
+	out.clear();
+
+	while (r.pos < r.size) {
+		char c = r.text[r.pos++];
+		if (c == '"')
+			return true;
+		if ((unsigned char)c < 0x20)
+			return false;
+		if (c != '\\') {
+			out += c;
+			continue;
+		}
+
+		if (r.pos >= r.size)
+			return false;
+		c = r.text[r.pos++];
+		switch (c) {
+		case '"':	out += '"'; break;
+		case '\\':	out += '\\'; break;
+		case '/':	out += '/'; break;
+		case 'b':	out += '\b'; break;
+		case 'f':	out += '\f'; break;
+		case 'n':	out += '\n'; break;
+		case 'r':	out += '\r'; break;
+		case 't':	out += '\t'; break;
+		case 'u': {
+			unsigned int code;
+			if (!_parseHex4(r, code))
+				return false;
+
+			// surrogate pair
+			if (code >= 0xD800 && code < 0xDC00) {
+				unsigned int low;
+				if (!_match(r, "\\u") || !_parseHex4(r, low) || low < 0xDC00 || low >= 0xE000)
+					return false;
+				code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+			}
+			_appendUtf8(out, code);
+			break;
+		}
+		default:
+			return false;
+		}
+	}
+	return false;
+}
+
+static bool _parseNumber(CDTJsonReader &r, double &out)
+{
+	size_t start = r.pos;
+	if (r.pos < r.size && r.text[r.pos] == '-')
+		r.pos++;
+	while (r.pos < r.size && strchr("0123456789.eE+-", r.text[r.pos]) != NULL && r.text[r.pos] != '\0')
+		r.pos++;
+	if (r.pos == start)
+		return false;
+
+	// strtod is locale dependent, a stringstream imbued with the classic locale is not
+	std::istringstream in(std::string(r.text + start, r.pos - start));
+	in.imbue(std::locale::classic());
+	in >> out;
+	return !in.fail() && in.peek() == EOF;
+}
+
+static bool _parseValue(CDTJsonReader &r, CDTJsonValue &value, int depth)
+{
+	value.type = CDT_JSON_NULL;
+	value.number = 0.0;
+	value.string.clear();
+	value.items.clear();
+	value.keys.clear();
+
+	_skipSpace(r);
+	if (r.pos >= r.size || depth > CDT_JSON_MAX_DEPTH)
+		return false;
+
+	char c = r.text[r.pos];
+	if (c == '{' || c == '[') {
+		char close = c == '{' ? '}' : ']';
+		value.type = c == '{' ? CDT_JSON_OBJECT : CDT_JSON_ARRAY;
+		r.pos++;
+
+		_skipSpace(r);
+		if (r.pos < r.size && r.text[r.pos] == close) {
+			r.pos++;
+			return true;
+		}
+
+		for (;;) {
+			if (value.type == CDT_JSON_OBJECT) {
+				_skipSpace(r);
+				value.keys.push_back(std::string());
+				if (r.pos >= r.size || r.text[r.pos] != '"' || !_parseString(r, value.keys.back()))
+					return false;
+				_skipSpace(r);
+				if (!_match(r, ":"))
+					return false;
+			}
+
+			value.items.push_back(CDTJsonValue());
+			if (!_parseValue(r, value.items.back(), depth + 1))
+				return false;
+
+			_skipSpace(r);
+			if (r.pos >= r.size)
+				return false;
+			if (r.text[r.pos] == close) {
+				r.pos++;
+				return true;
+			}
+			if (r.text[r.pos] != ',')
+				return false;
+			r.pos++;
+		}
+	}
+
+	if (c == '"') {
+		value.type = CDT_JSON_STRING;
+		return _parseString(r, value.string);
+	}
+	if (_match(r, "true")) {
+		value.type = CDT_JSON_BOOL;
+		value.number = 1.0;
+		return true;
+	}
+	if (_match(r, "false")) {
+		value.type = CDT_JSON_BOOL;
+		return true;
+	}
+	if (_match(r, "null"))
+		return true;
+
+	value.type = CDT_JSON_NUMBER;
+	return _parseNumber(r, value.number);
+}
+
+
+// -------------------------------------------
+// Json functions
+// -------------------------------------------
+
+bool JsonParse(const std::string &text, CDTJsonValue &value)
+{
+	CDTJsonReader r = { text.c_str(), text.size(), 0 };
+
+	bool ok = _parseValue(r, value, 0);
+	_skipSpace(r);
+	if (!ok || r.pos != r.size) {
+		printf("Json: syntax error at offset %d\n", (int)r.pos);
+		return false;
+	}
+	return true;
+}
+
+bool JsonLoad(const char* path, CDTJsonValue &value)
+{
+	std::ifstream in(path, std::ios::binary);
+	if (!in.is_open()) {
+		printf("Json: can't open %s\n", path);
+		return false;
+	}
+
+	std::ostringstream text;
+	text << in.rdbuf();
+	return JsonParse(text.str(), value);
+}
+
+const CDTJsonValue* JsonGet(const CDTJsonValue &value, const char* key)
+{
+	if (value.type != CDT_JSON_OBJECT)
+		return NULL;
+
+	for (size_t n = 0; n < value.keys.size(); n++) {
+		if (value.keys[n] == key)
+			return &value.items[n];
+	}
+	return NULL;
+}
+
+double JsonNumber(const CDTJsonValue &value, const char* key, double def)
+{
+	const CDTJsonValue* member = JsonGet(value, key);
+	return member && member->type == CDT_JSON_NUMBER ? member->number : def;
+}
+
+bool JsonBool(const CDTJsonValue &value, const char* key, bool def)
+{
+	const CDTJsonValue* member = JsonGet(value, key);
+	return member && member->type == CDT_JSON_BOOL ? member->number != 0.0 : def;
+}
+
+std::string JsonString(const CDTJsonValue &value, const char* key, const char* def)
+{
+	const CDTJsonValue* member = JsonGet(value, key);
+	return member && member->type == CDT_JSON_STRING ? member->string : std::string(def);
+}
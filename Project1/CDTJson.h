@@ -0,0 +1,50 @@
+
+#ifndef CDT_JSON
+#define CDT_JSON
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+// -------------------------------------------
+// CDT json reader
+//	- small DOM parser for tool/import data (ex. Tiled maps), not for
+//	  per-frame use: every value owns its children
+//	- numbers are doubles, object keys keep their file order
+// -------------------------------------------
+
+#define CDT_JSON_NULL				0
+#define CDT_JSON_BOOL				1
+#define CDT_JSON_NUMBER				2
+#define CDT_JSON_STRING				3
+#define CDT_JSON_ARRAY				4
+#define CDT_JSON_OBJECT				5
+
+struct CDTJsonValue
+{
+	int							type;
+	double						number;			// also 0/1 for bool
+	std::string					string;
+	std::vector<CDTJsonValue>	items;			// array items or object values
+	std::vector<std::string>	keys;			// object keys, keys[n] is the key of items[n]
+};
+
+// -------------------------------------------
+// Json functions
+// -------------------------------------------
+
+// parse text, on error return false and print the offset of the error
+bool JsonParse(const std::string &text, CDTJsonValue &value);
+bool JsonLoad(const char* path, CDTJsonValue &value);
+
+// member of an object, NULL if value is not an object or has no such key
+const CDTJsonValue* JsonGet(const CDTJsonValue &value, const char* key);
+
+// value of a member, or def when missing or of an other type
+double		JsonNumber(const CDTJsonValue &value, const char* key, double def);
+bool		JsonBool(const CDTJsonValue &value, const char* key, bool def);
+std::string	JsonString(const CDTJsonValue &value, const char* key, const char* def);
+
+
+#endif
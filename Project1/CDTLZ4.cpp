@@ -0,0 +1,184 @@
+
+#include "CDTLZ4.h"
+#include <string.h>
+#include <stdint.h>
+#include <vector>
+
+#define LZ4_MIN_MATCH				4
+#define LZ4_LAST_LITERALS			5				// the block always ends with 5 literals
+#define LZ4_MF_LIMIT				12				// no match starts in the last 12 bytes
+#define LZ4_MAX_OFFSET				65535
+#define LZ4_HASH_BITS				16
+
+// -------------------------------------------
+// Internal functions
+// -------------------------------------------
+
+static uint32_t _read32(const uint8_t* p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static uint32_t _hash(uint32_t v)
+{
+	return (v * 2654435761u) >> (32 - LZ4_HASH_BITS);
+}
+
+//+ Length over 15 (literals) or 19 (match) is continued by bytes of 255
+static bool _writeLength(uint8_t* &op, const uint8_t* end, size_t length)
+{
+	while (length >= 255) {
+		if (op >= end) return false;
+		*op++ = 255;
+		length -= 255;
+	}
+	if (op >= end) return false;
+	*op++ = (uint8_t)length;
+	return true;
+}
+
+static bool _readLength(const uint8_t* &ip, const uint8_t* end, size_t &length)
+{
+	uint8_t b;
+	do {
+		if (ip >= end) return false;
+		b = *ip++;
+		length += b;
+	} while (b == 255);
+	return true;
+}
+
+static bool _writeSequence(uint8_t* &op, const uint8_t* opEnd, const uint8_t* literal, size_t numLiteral, size_t offset, size_t matchLength)
+{
+	if (op >= opEnd)
+		return false;
+
+	uint8_t* token = op++;
+	*token = (uint8_t)((numLiteral >= 15 ? 15 : numLiteral) << 4);
+	if (numLiteral >= 15 && !_writeLength(op, opEnd, numLiteral - 15))
+		return false;
+
+	if ((size_t)(opEnd - op) < numLiteral)
+		return false;
+	if (numLiteral > 0)
+		memcpy(op, literal, numLiteral);
+	op += numLiteral;
+
+	// the last sequence has literals only
+	if (matchLength == 0)
+		return true;
+
+	if (opEnd - op < 2)
+		return false;
+	*op++ = (uint8_t)(offset & 0xFF);
+	*op++ = (uint8_t)(offset >> 8);
+
+	size_t code = matchLength - LZ4_MIN_MATCH;
+	*token |= (uint8_t)(code >= 15 ? 15 : code);
+	return code < 15 || _writeLength(op, opEnd, code - 15);
+}
+
+
+// -------------------------------------------
+// LZ4 functions
+// -------------------------------------------
+
+size_t LZ4Bound(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+size_t LZ4Compress(const void* src, size_t srcSize, void* dst, size_t dstCapacity)
+{
+	const uint8_t* in = (const uint8_t*)src;
+	uint8_t* op = (uint8_t*)dst;
+	const uint8_t* opEnd = op + dstCapacity;
+	size_t anchor = 0;
+
+	if (srcSize >= LZ4_MF_LIMIT + 1) {
+		// positions + 1 of the last 4 bytes with this hash, 0 = none
+		std::vector<uint32_t> table((size_t)1 << LZ4_HASH_BITS, 0);
+		size_t matchLimit = srcSize - LZ4_LAST_LITERALS;
+		size_t pos = 0;
+
+		while (pos + LZ4_MF_LIMIT <= srcSize) {
+			uint32_t h = _hash(_read32(in + pos));
+			size_t candidate = table[h];
+			table[h] = (uint32_t)(pos + 1);
+
+			if (candidate == 0 || pos - (candidate - 1) > LZ4_MAX_OFFSET || _read32(in + candidate - 1) != _read32(in + pos)) {
+				pos++;
+				continue;
+			}
+
+			size_t ref = candidate - 1;
+			size_t length = LZ4_MIN_MATCH;
+			while (pos + length < matchLimit && in[ref + length] == in[pos + length])
+				length++;
+
+			if (!_writeSequence(op, opEnd, in + anchor, pos - anchor, pos - ref, length))
+				return 0;
+
+			pos += length;
+			anchor = pos;
+		}
+	}
+
+	if (!_writeSequence(op, opEnd, in + anchor, srcSize - anchor, 0, 0))
+		return 0;
+	return (size_t)(op - (uint8_t*)dst);
+}
+
+bool LZ4Decompress(const void* src, size_t srcSize, void* dst, size_t dstSize)
+{
+	const uint8_t* ip = (const uint8_t*)src;
+	const uint8_t* ipEnd = ip + srcSize;
+	uint8_t* out = (uint8_t*)dst;
+	size_t pos = 0;
+
+	while (ip < ipEnd) {
+		uint8_t token = *ip++;
+
+		size_t numLiteral = token >> 4;
+		if (numLiteral == 15 && !_readLength(ip, ipEnd, numLiteral))
+			return false;
+		if ((size_t)(ipEnd - ip) < numLiteral || dstSize - pos < numLiteral)
+			return false;
+		memcpy(out + pos, ip, numLiteral);
+		ip += numLiteral;
+		pos += numLiteral;
+
+		// end of block after the last literals
+		if (ip == ipEnd)
+			break;
+
+		if (ipEnd - ip < 2)
+			return false;
+		size_t offset = ip[0] | ((size_t)ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > pos)
+			return false;
+
+		size_t length = token & 15;
+		if (length == 15 && !_readLength(ip, ipEnd, length))
+			return false;
+		length += LZ4_MIN_MATCH;
+		if (dstSize - pos < length)
+			return false;
+
+		// the match can overlap what it writes (offset < length), copy forward
+		const uint8_t* ref = out + pos - offset;
+		if (offset >= length) {
+			memcpy(out + pos, ref, length);
+		}
+		else {
+			for (size_t n = 0; n < length; n++)
+				out[pos + n] = ref[n];
+		}
+		pos += length;
+	}
+
+	return pos == dstSize;
+}
@@ -0,0 +1,30 @@
+
+#ifndef CDT_LZ4
+#define CDT_LZ4
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+
+// -------------------------------------------
+// CDT LZ4 block codec
+//	- raw LZ4 blocks (no frame header, no checksum), the sizes are
+//	  kept by the caller, ex. in the asset pack directory
+//	- the compressor is the fast greedy one (hash of 4 bytes, 64KB
+//	  window), good enough for offline packing and decompression speed
+//	  doesn't depend on it
+//	- the decompressor checks every length against both buffers, a
+//	  corrupted block fails instead of reading or writing out of bounds
+// -------------------------------------------
+
+// worst case size of the compressed block of size bytes
+size_t LZ4Bound(size_t size);
+
+// return the compressed size, 0 if it doesn't fit in dstCapacity
+size_t LZ4Compress(const void* src, size_t srcSize, void* dst, size_t dstCapacity);
+
+// return false unless the block decodes to exactly dstSize bytes
+bool   LZ4Decompress(const void* src, size_t srcSize, void* dst, size_t dstSize);
+
+
+#endif
@@ -0,0 +1,257 @@
+
+#include "CDTLevel.h"
+#include <string.h>
+#include <fstream>
+#include <vector>
+
+// -------------------------------------------
+// Internal functions
+// -------------------------------------------
+
+static uint32_t _align8(size_t offset)
+{
+	return (uint32_t)((offset + 7) & ~(size_t)7);
+}
+
+//+ A section is valid if it is aligned and fully inside the file
+static bool _sectionValid(const CDTLevelHeader* header, uint32_t offset, size_t size)
+{
+	return (offset & 7) == 0 && offset >= sizeof(CDTLevelHeader) &&
+		(size_t)offset + size <= header->fileSize;
+}
+
+//+ Check the sections of the asset and point the level in it
+static bool _openLevel(CDTLevel &level, const char* path, bool fromPack)
+{
+	level.header = NULL;
+	level.tiles = NULL;
+	level.collision = NULL;
+	level.rects = NULL;
+	level.spawns = NULL;
+	level.chunks = NULL;
+	level.quads = NULL;
+
+	if (!(fromPack ? AssetOpen(level.asset, path) : AssetOpenFile(level.asset, path)))
+		return false;
+
+	const CDTLevelHeader* header = (const CDTLevelHeader*)level.asset.data;
+	bool valid = level.asset.size >= sizeof(CDTLevelHeader) &&
+		header->magic == CDT_LEVEL_MAGIC &&
+		header->version == CDT_LEVEL_VERSION &&
+		header->fileSize == level.asset.size &&
+		header->width > 0 && header->height > 0 &&
+		header->wordsPerRow == (uint32_t)((header->width + 63) >> 6);
+
+	valid = valid &&
+		_sectionValid(header, header->tileOffset, (size_t)header->width * header->height) &&
+		_sectionValid(header, header->collisionOffset, (size_t)header->height * header->wordsPerRow * sizeof(uint64_t)) &&
+		_sectionValid(header, header->rectOffset, (size_t)header->numRect * sizeof(CDTRect)) &&
+		_sectionValid(header, header->spawnOffset, (size_t)header->numSpawn * sizeof(CDTLevelSpawn));
+
+	valid = valid &&
+		header->chunkSize > 0 && header->chunkSize <= 256 &&
+		header->numChunkX == (header->width + header->chunkSize - 1) / header->chunkSize &&
+		header->numChunkY == (header->height + header->chunkSize - 1) / header->chunkSize &&
+		_sectionValid(header, header->chunkOffset, (size_t)header->numChunkX * header->numChunkY * sizeof(CDTLevelChunk)) &&
+		_sectionValid(header, header->quadOffset, (size_t)header->numQuad * sizeof(CDTLevelQuad));
+
+	// the quads of every chunk must be in the quad section
+	if (valid) {
+		const CDTLevelChunk* chunks = (const CDTLevelChunk*)(level.asset.data + header->chunkOffset);
+		for (int c = 0; c < header->numChunkX * header->numChunkY && valid; c++)
+			valid = chunks[c].firstQuad <= header->numQuad && chunks[c].numQuad <= header->numQuad - chunks[c].firstQuad;
+	}
+
+	if (!valid) {
+		printf("Level: %s is not a version %d level\n", path, CDT_LEVEL_VERSION);
+		LevelClose(level);
+		return false;
+	}
+
+	level.header = header;
+	level.tiles = level.asset.data + header->tileOffset;
+	level.collision = (uint64_t*)(level.asset.data + header->collisionOffset);
+	level.rects = (const CDTRect*)(level.asset.data + header->rectOffset);
+	level.spawns = (const CDTLevelSpawn*)(level.asset.data + header->spawnOffset);
+	level.chunks = (const CDTLevelChunk*)(level.asset.data + header->chunkOffset);
+	level.quads = (const CDTLevelQuad*)(level.asset.data + header->quadOffset);
+	return true;
+}
+
+
+// -------------------------------------------
+// Level functions
+// -------------------------------------------
+
+bool LevelOpen(CDTLevel &level, const char* path)
+{
+	return _openLevel(level, path, true);
+}
+
+bool LevelOpenFile(CDTLevel &level, const char* path)
+{
+	return _openLevel(level, path, false);
+}
+
+uint64_t LevelSourceHash(const char* sourcePath)
+{
+	CDTMappedFile file;
+	if (!FileMap(file, sourcePath))
+		return 0;
+
+	uint64_t h = 14695981039346656037ull;
+	for (size_t n = 0; n < file.size; n++) {
+		h ^= file.data[n];
+		h *= 1099511628211ull;
+	}
+	FileUnmap(file);
+	return h;
+}
+
+bool LevelIsCurrent(const CDTLevel &level, const char* sourcePath)
+{
+	uint64_t hash = LevelSourceHash(sourcePath);
+	return level.header != NULL && (hash == 0 || level.header->sourceHash == hash);
+}
+
+void LevelClose(CDTLevel &level)
+{
+	AssetClose(level.asset);
+	level.header = NULL;
+	level.tiles = NULL;
+	level.collision = NULL;
+	level.rects = NULL;
+	level.spawns = NULL;
+	level.chunks = NULL;
+	level.quads = NULL;
+}
+
+bool LevelWrite(const CDTLevelBuild &build, const char* levelPath)
+{
+	int width = build.width, height = build.height;
+	const CDTBitGrid &collision = build.collision;
+
+	std::vector<CDTRect> rects;
+	MergeSolidRects(collision, rects);
+
+	// bake the draw list of each chunk, cells bottom up, then layer by layer
+	int size = CDT_LEVEL_CHUNK_SIZE;
+	int numChunkX = (width + size - 1) / size, numChunkY = (height + size - 1) / size;
+	std::vector<CDTLevelChunk> chunks((size_t)numChunkX * numChunkY);
+	std::vector<CDTLevelQuad> quads;
+
+	for (int cy = 0; cy < numChunkY; cy++) {
+		for (int cx = 0; cx < numChunkX; cx++) {
+			CDTLevelChunk &chunk = chunks[(size_t)cy * numChunkX + cx];
+			chunk.firstQuad = (uint32_t)quads.size();
+
+			for (size_t layer = 0; layer < build.layers.size(); layer++) {
+				for (int y = cy * size; y < (cy + 1) * size && y < height; y++) {
+					const uint8_t* row = &build.layers[layer][(size_t)(height - 1 - y) * width];
+					for (int x = cx * size; x < (cx + 1) * size && x < width; x++) {
+						if (row[x] == 0)
+							continue;
+
+						CDTLevelQuad quad = { (uint8_t)(x - cx * size), (uint8_t)(y - cy * size), row[x], (uint8_t)layer };
+						quads.push_back(quad);
+					}
+				}
+			}
+			chunk.numQuad = (uint32_t)quads.size() - chunk.firstQuad;
+		}
+	}
+
+	// lay the sections out after the header
+	CDTLevelHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = CDT_LEVEL_MAGIC;
+	header.version = CDT_LEVEL_VERSION;
+	header.width = width;
+	header.height = height;
+	header.wordsPerRow = (uint32_t)collision.wordsPerRow;
+	header.numRect = (uint32_t)rects.size();
+	header.numSpawn = (uint32_t)build.spawns.size();
+	header.chunkSize = size;
+	header.numChunkX = numChunkX;
+	header.numChunkY = numChunkY;
+	header.numQuad = (uint32_t)quads.size();
+	header.sourceHash = build.sourceHash;
+	header.tileOffset = _align8(sizeof(CDTLevelHeader));
+	header.collisionOffset = _align8(header.tileOffset + build.tiles.size());
+	header.rectOffset = _align8(header.collisionOffset + collision.storage.size() * sizeof(uint64_t));
+	header.spawnOffset = _align8(header.rectOffset + rects.size() * sizeof(CDTRect));
+	header.chunkOffset = _align8(header.spawnOffset + build.spawns.size() * sizeof(CDTLevelSpawn));
+	header.quadOffset = _align8(header.chunkOffset + chunks.size() * sizeof(CDTLevelChunk));
+	header.fileSize = _align8(header.quadOffset + quads.size() * sizeof(CDTLevelQuad));
+
+	std::vector<uint8_t> data(header.fileSize, 0);
+	memcpy(&data[0], &header, sizeof(header));
+	memcpy(&data[header.tileOffset], &build.tiles[0], build.tiles.size());
+	memcpy(&data[header.collisionOffset], &collision.storage[0], collision.storage.size() * sizeof(uint64_t));
+	if (!rects.empty())
+		memcpy(&data[header.rectOffset], &rects[0], rects.size() * sizeof(CDTRect));
+	if (!build.spawns.empty())
+		memcpy(&data[header.spawnOffset], &build.spawns[0], build.spawns.size() * sizeof(CDTLevelSpawn));
+	memcpy(&data[header.chunkOffset], &chunks[0], chunks.size() * sizeof(CDTLevelChunk));
+	if (!quads.empty())
+		memcpy(&data[header.quadOffset], &quads[0], quads.size() * sizeof(CDTLevelQuad));
+
+	if (!FileWrite(levelPath, &data[0], data.size())) {
+		printf("Level: can't write %s\n", levelPath);
+		return false;
+	}
+
+	printf("Level: %s (%dx%d, %d rects, %d spawns, %d quads, %u bytes)\n", levelPath,
+		width, height, (int)rects.size(), (int)build.spawns.size(), (int)quads.size(), header.fileSize);
+	return true;
+}
+
+bool LevelConvertText(const char* textPath, const char* levelPath)
+{
+	std::ifstream in(textPath);
+	if (!in.is_open()) {
+		printf("Level: can't open %s\n", textPath);
+		return false;
+	}
+
+	int width = 0, height = 0;
+	in >> height >> width;
+	if (!in || width <= 0 || height <= 0) {
+		printf("Level: %s has no valid size\n", textPath);
+		return false;
+	}
+
+	CDTLevelBuild build;
+	build.width = width;
+	build.height = height;
+	build.sourceHash = LevelSourceHash(textPath);
+	build.tiles.assign((size_t)width * height, 0);
+	build.layers.assign(1, std::vector<uint8_t>((size_t)width * height, 0));
+	BitGridInit(build.collision, width, height);
+
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			int tile = 0;
+			if (!(in >> tile)) {
+				printf("Level: %s ends before tile (%d,%d)\n", textPath, x, y);
+				return false;
+			}
+
+			build.tiles[(size_t)y * width + x] = (uint8_t)tile;
+			if (tile >= CDT_LEVEL_SOLID_MIN && tile <= CDT_LEVEL_SOLID_MAX)
+				BitGridSet(build.collision, x, height - 1 - y, true);
+
+			// spawn points are not drawn
+			if (tile >= CDT_LEVEL_SPAWN_MIN) {
+				CDTLevelSpawn spawn = { x, y, tile, 0 };
+				build.spawns.push_back(spawn);
+			}
+			else {
+				build.layers[0][(size_t)y * width + x] = (uint8_t)tile;
+			}
+		}
+	}
+
+	printf("Level: convert %s\n", textPath);
+	return LevelWrite(build, levelPath);
+}
@@ -0,0 +1,149 @@
+
+#ifndef CDT_LEVEL
+#define CDT_LEVEL
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include "CDTFile.h"
+#include "CDTPack.h"
+#include "CDTBitGrid.h"
+#include "CDTColliderTree.h"
+
+// -------------------------------------------
+// CDT binary level
+//	- the level file is mapped (or read from the asset pack) and used in place, nothing is parsed:
+//	  the tile layer, collision bits, collider rects and spawn list
+//	  are read straight from the mapped memory
+//	- layout (little endian, every section 8 byte aligned):
+//		CDTLevelHeader
+//		tiles			width * height uint8_t, row 0 is the top row (CDTTileMap8 row major)
+//		collision		height * wordsPerRow uint64_t, row 0 is the bottom row (CDTBitGrid)
+//		rects			numRect CDTRect, the solid tiles merged (MergeSolidRects)
+//		spawns			numSpawn CDTLevelSpawn, in row major order
+//		chunks			numChunkX * numChunkY CDTLevelChunk, row 0 is the bottom row
+//		quads			numQuad CDTLevelQuad, the tiles to draw grouped by chunk
+//	- the quads are the prebaked draw list of each chunk: only the tiles
+//	  that are drawn, of every visible layer, bottom layer first
+//	- text maps (height width, then the tile ids) are converted with
+//	  LevelConvertText, tiles CDT_LEVEL_SOLID_MIN..MAX are solid and
+//	  tiles >= CDT_LEVEL_SPAWN_MIN are spawn points
+//	- Tiled maps (json export) are converted with LevelConvertTiled
+//	- the header keeps the hash of the map the level was converted from,
+//	  LevelIsCurrent tells if the map was edited since
+// -------------------------------------------
+
+#define CDT_LEVEL_MAGIC				0x4C564C52		// "RLVL"
+#define CDT_LEVEL_VERSION			3
+#define CDT_LEVEL_CHUNK_SIZE		16				// chunk of 16x16 tiles, a quad coordinate fits in a byte
+
+#define CDT_LEVEL_SOLID_MIN			1
+#define CDT_LEVEL_SOLID_MAX			4
+#define CDT_LEVEL_SPAWN_MIN			5
+
+struct CDTLevelHeader
+{
+	uint32_t		magic;
+	uint32_t		version;
+	uint32_t		fileSize;
+	int32_t			width;
+	int32_t			height;
+	uint32_t		tileOffset;				// offsets from the start of the file
+	uint32_t		collisionOffset;
+	uint32_t		wordsPerRow;
+	uint32_t		rectOffset;
+	uint32_t		numRect;
+	uint32_t		spawnOffset;
+	uint32_t		numSpawn;
+	int32_t			chunkSize;
+	int32_t			numChunkX;
+	int32_t			numChunkY;
+	uint32_t		chunkOffset;
+	uint32_t		quadOffset;
+	uint32_t		numQuad;
+	uint64_t		sourceHash;				// LevelSourceHash of the map, 0 if unknown
+};
+
+struct CDTLevelSpawn
+{
+	int32_t			x;						// tile coordinate, y = 0 is the top row
+	int32_t			y;
+	int32_t			tile;					// tile id of the spawn point
+	int32_t			pad;
+};
+
+struct CDTLevelChunk
+{
+	uint32_t		firstQuad;
+	uint32_t		numQuad;
+};
+
+struct CDTLevelQuad
+{
+	uint8_t			x;						// in the chunk, y = 0 is the bottom row of the chunk
+	uint8_t			y;
+	uint8_t			tile;					// tile id, 1 is the first tile of the tileset
+	uint8_t			layer;
+};
+
+// a level before it is written, filled by the converters
+struct CDTLevelBuild
+{
+	int							width;
+	int							height;
+	std::vector<uint8_t>		tiles;			// width * height tile id, row 0 is the top row
+	std::vector< std::vector<uint8_t> >	layers;	// drawn layers, same layout as tiles, bottom first
+	CDTBitGrid					collision;
+	std::vector<CDTLevelSpawn>	spawns;
+	uint64_t					sourceHash;		// of the converted map
+};
+
+struct CDTLevel
+{
+	CDTAsset				asset;
+	const CDTLevelHeader*	header;
+	uint8_t*				tiles;
+	uint64_t*				collision;
+	const CDTRect*			rects;
+	const CDTLevelSpawn*	spawns;
+	const CDTLevelChunk*	chunks;			// chunks[cy * numChunkX + cx]
+	const CDTLevelQuad*		quads;
+};
+
+// -------------------------------------------
+// Level functions
+// -------------------------------------------
+
+// open the level (AssetOpen), return false if missing or not a valid level of this version
+bool LevelOpen(CDTLevel &level, const char* path);
+
+// open the level file on disk, even if the mounted pack has an older one
+bool LevelOpenFile(CDTLevel &level, const char* path);
+void LevelClose(CDTLevel &level);
+
+// FNV-1a 64 of the map file on disk, 0 if it can't be read
+uint64_t LevelSourceHash(const char* sourcePath);
+
+// false if the map on disk is not the one the level was converted from,
+// true if there is no such map (a level shipped without its map)
+bool LevelIsCurrent(const CDTLevel &level, const char* sourcePath);
+
+// merge the solid tiles, bake the chunk quads and write the level
+bool LevelWrite(const CDTLevelBuild &build, const char* levelPath);
+
+// convert a text map to a binary level
+bool LevelConvertText(const char* textPath, const char* levelPath);
+
+// convert a Tiled map exported as json to a binary level
+//	- tile layers are drawn bottom first, a layer with the bool property
+//	  "collision" gives the solid tiles (every non empty cell), without one
+//	  the tiles CDT_LEVEL_SOLID_MIN..MAX of the visible layers are solid
+//	- objects of the object layers are spawn points, the spawn tile id is
+//	  the int property "spawn", or comes from the type/class of the object:
+//	  player 5, enemy 6, item 7, patrol 8, sniper 9
+//	- the map has 1 tileset, tile ids are its local ids + 1, flip bits are ignored
+bool LevelConvertTiled(const char* jsonPath, const char* levelPath);
+
+
+#endif
@@ -0,0 +1,261 @@
+
+#include "CDTLevel.h"
+#include "CDTJson.h"
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+// gid bits of the flipped/rotated tiles
+#define TILED_GID_MASK				0x0FFFFFFFu
+
+struct CDTTiledImport
+{
+	const char*			path;
+	int					width;
+	int					height;
+	float				tileWidth;
+	float				tileHeight;
+	int					firstGid;			// of the tileset
+	bool				hasCollisionLayer;
+	std::vector< std::vector<uint8_t> >	collisionLayers;
+};
+
+// -------------------------------------------
+// Internal functions
+// -------------------------------------------
+
+//+ Value of a custom property, Tiled stores them as [{name, type, value}]
+static const CDTJsonValue* _property(const CDTJsonValue &owner, const char* name)
+{
+	const CDTJsonValue* properties = JsonGet(owner, "properties");
+	if (!properties || properties->type != CDT_JSON_ARRAY)
+		return NULL;
+
+	for (size_t n = 0; n < properties->items.size(); n++) {
+		if (JsonString(properties->items[n], "name", "") == name)
+			return JsonGet(properties->items[n], "value");
+	}
+	return NULL;
+}
+
+static bool _propertyBool(const CDTJsonValue &owner, const char* name, bool def)
+{
+	const CDTJsonValue* value = _property(owner, name);
+	return value && value->type == CDT_JSON_BOOL ? value->number != 0.0 : def;
+}
+
+//+ Local tile id + 1 of a gid, 0 for an empty cell, -1 if it doesn't fit in a byte
+static int _tileOfGid(const CDTTiledImport &import, double gidValue)
+{
+	uint32_t gid = (uint32_t)gidValue & TILED_GID_MASK;
+	if (gid == 0)
+		return 0;
+
+	int tile = (int)gid - import.firstGid + 1;
+	return tile >= 1 && tile <= 255 ? tile : -1;
+}
+
+static int _spawnOfType(const std::string &type)
+{
+	if (type == "player")	return 5;
+	if (type == "enemy")	return 6;
+	if (type == "item")		return 7;
+	if (type == "patrol")	return 8;
+	if (type == "sniper")	return 9;
+	return 0;
+}
+
+static bool _importTileLayer(CDTTiledImport &import, const CDTJsonValue &layer, CDTLevelBuild &build)
+{
+	std::string name = JsonString(layer, "name", "");
+	const CDTJsonValue* data = JsonGet(layer, "data");
+	if (!data || data->type != CDT_JSON_ARRAY) {
+		printf("Level: %s layer '%s' is not in csv format (base64/compressed data is not supported)\n", import.path, name.c_str());
+		return false;
+	}
+
+	size_t numCell = (size_t)import.width * import.height;
+	if (data->items.size() != numCell || (int)JsonNumber(layer, "width", import.width) != import.width) {
+		printf("Level: %s layer '%s' is not the size of the map\n", import.path, name.c_str());
+		return false;
+	}
+
+	std::vector<uint8_t> tiles(numCell, 0);
+	for (size_t n = 0; n < numCell; n++) {
+		int tile = _tileOfGid(import, data->items[n].number);
+		if (tile < 0) {
+			printf("Level: %s layer '%s' uses a tile id over 255 or out of the tileset\n", import.path, name.c_str());
+			return false;
+		}
+		tiles[n] = (uint8_t)tile;
+	}
+
+	if (_propertyBool(layer, "collision", false)) {
+		import.hasCollisionLayer = true;
+		import.collisionLayers.push_back(tiles);
+	}
+
+	if (!JsonBool(layer, "visible", true))
+		return true;
+
+	// the game tiles are the top most tile of the visible layers
+	for (size_t n = 0; n < numCell; n++) {
+		if (tiles[n] != 0)
+			build.tiles[n] = tiles[n];
+	}
+	build.layers.push_back(tiles);
+	return true;
+}
+
+static bool _importObjectLayer(CDTTiledImport &import, const CDTJsonValue &layer, CDTLevelBuild &build)
+{
+	const CDTJsonValue* objects = JsonGet(layer, "objects");
+	if (!objects || objects->type != CDT_JSON_ARRAY)
+		return true;
+
+	for (size_t n = 0; n < objects->items.size(); n++) {
+		const CDTJsonValue &object = objects->items[n];
+
+		// spawn property first, then the type (Tiled < 1.9) or the class
+		int tile = 0;
+		const CDTJsonValue* spawnProperty = _property(object, "spawn");
+		if (spawnProperty && spawnProperty->type == CDT_JSON_NUMBER)
+			tile = (int)spawnProperty->number;
+		if (tile == 0)
+			tile = _spawnOfType(JsonString(object, "type", ""));
+		if (tile == 0)
+			tile = _spawnOfType(JsonString(object, "class", ""));
+
+		if (tile == 0) {
+			printf("Level: %s object '%s' is not a spawn point, skipped\n", import.path, JsonString(object, "name", "").c_str());
+			continue;
+		}
+
+		// the spawn is the cell under the center of the object, the
+		// position of a tile object is its bottom left corner
+		float x = (float)JsonNumber(object, "x", 0.0), y = (float)JsonNumber(object, "y", 0.0);
+		float w = (float)JsonNumber(object, "width", 0.0), h = (float)JsonNumber(object, "height", 0.0);
+		if (JsonGet(object, "gid"))
+			y -= h;
+
+		int cellX = (int)floorf((x + w * 0.5f) / import.tileWidth);
+		int cellY = (int)floorf((y + h * 0.5f) / import.tileHeight);
+		if (cellX < 0 || cellX >= import.width || cellY < 0 || cellY >= import.height) {
+			printf("Level: %s object '%s' is outside of the map, skipped\n", import.path, JsonString(object, "name", "").c_str());
+			continue;
+		}
+
+		CDTLevelSpawn spawn = { cellX, cellY, tile, 0 };
+		build.spawns.push_back(spawn);
+	}
+	return true;
+}
+
+static bool _importLayers(CDTTiledImport &import, const CDTJsonValue &layers, CDTLevelBuild &build)
+{
+	for (size_t n = 0; n < layers.items.size(); n++) {
+		const CDTJsonValue &layer = layers.items[n];
+		std::string type = JsonString(layer, "type", "");
+		bool ok = true;
+
+		if (type == "tilelayer") {
+			ok = _importTileLayer(import, layer, build);
+		}
+		else if (type == "objectgroup") {
+			ok = _importObjectLayer(import, layer, build);
+		}
+		else if (type == "group") {
+			const CDTJsonValue* children = JsonGet(layer, "layers");
+			if (children && children->type == CDT_JSON_ARRAY)
+				ok = _importLayers(import, *children, build);
+		}
+
+		if (!ok)
+			return false;
+	}
+	return true;
+}
+
+static bool _compareSpawn(const CDTLevelSpawn &a, const CDTLevelSpawn &b)
+{
+	return a.y != b.y ? a.y < b.y : a.x < b.x;
+}
+
+
+// -------------------------------------------
+// Level functions
+// -------------------------------------------
+
+bool LevelConvertTiled(const char* jsonPath, const char* levelPath)
+{
+	CDTJsonValue map;
+	if (!JsonLoad(jsonPath, map))
+		return false;
+
+	CDTTiledImport import;
+	import.path = jsonPath;
+	import.width = (int)JsonNumber(map, "width", 0.0);
+	import.height = (int)JsonNumber(map, "height", 0.0);
+	import.tileWidth = (float)JsonNumber(map, "tilewidth", 1.0);
+	import.tileHeight = (float)JsonNumber(map, "tileheight", 1.0);
+	import.hasCollisionLayer = false;
+
+	if (JsonBool(map, "infinite", false) || JsonString(map, "orientation", "orthogonal") != "orthogonal") {
+		printf("Level: %s must be a fixed size orthogonal map\n", jsonPath);
+		return false;
+	}
+	if (import.width <= 0 || import.height <= 0 || import.tileWidth <= 0.0f || import.tileHeight <= 0.0f) {
+		printf("Level: %s has no valid size\n", jsonPath);
+		return false;
+	}
+
+	// the level is drawn with 1 sheet, the tiles of a 2nd tileset would alias the ones of the 1st
+	const CDTJsonValue* tilesets = JsonGet(map, "tilesets");
+	int numTileset = tilesets && tilesets->type == CDT_JSON_ARRAY ? (int)tilesets->items.size() : 0;
+	if (numTileset > 1) {
+		printf("Level: %s has %d tilesets, only 1 is supported\n", jsonPath, numTileset);
+		return false;
+	}
+	import.firstGid = numTileset == 1 ? (int)JsonNumber(tilesets->items[0], "firstgid", 1.0) : 1;
+
+	CDTLevelBuild build;
+	build.width = import.width;
+	build.height = import.height;
+	build.sourceHash = LevelSourceHash(jsonPath);
+	build.tiles.assign((size_t)import.width * import.height, 0);
+	BitGridInit(build.collision, import.width, import.height);
+
+	const CDTJsonValue* layers = JsonGet(map, "layers");
+	if (!layers || layers->type != CDT_JSON_ARRAY || !_importLayers(import, *layers, build))
+		return false;
+
+	// solid cells, rows of the bit grid go up from the bottom of the map
+	for (int y = 0; y < import.height; y++) {
+		for (int x = 0; x < import.width; x++) {
+			size_t cell = (size_t)y * import.width + x;
+			bool solid = false;
+
+			if (import.hasCollisionLayer) {
+				for (size_t n = 0; n < import.collisionLayers.size() && !solid; n++)
+					solid = import.collisionLayers[n][cell] != 0;
+			}
+			else {
+				for (size_t n = 0; n < build.layers.size() && !solid; n++)
+					solid = build.layers[n][cell] >= CDT_LEVEL_SOLID_MIN && build.layers[n][cell] <= CDT_LEVEL_SOLID_MAX;
+			}
+
+			if (solid)
+				BitGridSet(build.collision, x, import.height - 1 - y, true);
+		}
+	}
+
+	// same order as the text maps, the layers don't change the spawn order
+	std::stable_sort(build.spawns.begin(), build.spawns.end(), _compareSpawn);
+
+	// like the text maps, the tiles hold the spawn ids too
+	for (size_t n = 0; n < build.spawns.size(); n++)
+		build.tiles[(size_t)build.spawns[n].y * import.width + build.spawns[n].x] = (uint8_t)build.spawns[n].tile;
+
+	printf("Level: convert %s (%d layers)\n", jsonPath, (int)build.layers.size());
+	return LevelWrite(build, levelPath);
+}
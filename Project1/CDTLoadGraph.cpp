@@ -0,0 +1,261 @@
+#include "CDTLoadGraph.h"
+#include "CDTJobs.h"
+
+// -------------------------------------------
+// Internal functions
+// -------------------------------------------
+
+static double _elapsed(const CDTLoadGraph &graph)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - graph.origin).count();
+}
+
+static void _workerTask(void* data);
+
+static void _startTask(CDTLoadGraph &graph, int index)
+{
+	if (graph.tasks[index].thread == CDT_LOAD_CONTEXT) {
+		std::lock_guard<std::mutex> guard(graph.lock);
+		graph.contextQueue.push_back(index);
+		return;
+	}
+
+	if (graph.background) {
+		{
+			std::lock_guard<std::mutex> guard(graph.lock);
+			graph.workerQueue.push_back(index);
+		}
+		graph.wake.notify_one();
+		return;
+	}
+
+	JobRun(_workerTask, &graph.tasks[index], NULL);
+}
+
+//+ Run the task, then start the tasks that were only waiting for it
+static void _runTask(CDTLoadGraph &graph, int index, int worker)
+{
+	CDTLoadTask &task = graph.tasks[index];
+	task.worker = worker;
+	task.start = _elapsed(graph);
+	task.func(task.data);
+	task.end = _elapsed(graph);
+
+	// the graph can be reused as soon as the last task is counted, nothing is read after it
+	std::vector<int> ready;
+	{
+		std::lock_guard<std::mutex> guard(graph.lock);
+		for (size_t n = 0; n < task.next.size(); n++) {
+			if (--graph.tasks[task.next[n]].waiting == 0)
+				ready.push_back(task.next[n]);
+		}
+		graph.numDone++;
+		if (graph.numDone == (int)graph.tasks.size())
+			graph.time = task.end;
+		if (graph.background)
+			graph.wake.notify_all();
+	}
+
+	for (size_t n = 0; n < ready.size(); n++)
+		_startTask(graph, ready[n]);
+}
+
+static void _workerTask(void* data)
+{
+	CDTLoadTask* task = (CDTLoadTask*)data;
+	_runTask(*task->graph, (int)(task - &task->graph->tasks[0]), JobWorkerIndex());
+}
+
+//+ Background graph, run the worker tasks 1 at a time until the graph is done
+static void _loaderLoop(CDTLoadGraph* graph)
+{
+	std::unique_lock<std::mutex> guard(graph->lock);
+
+	for (;;) {
+		graph->wake.wait(guard, [graph] { return !graph->workerQueue.empty() || graph->numDone == (int)graph->tasks.size(); });
+		if (graph->workerQueue.empty())
+			return;
+
+		int index = graph->workerQueue.front();
+		graph->workerQueue.pop_front();
+
+		guard.unlock();
+		_runTask(*graph, index, -1);
+		guard.lock();
+	}
+}
+
+static bool _popContext(CDTLoadGraph &graph, int &index, bool &done)
+{
+	std::lock_guard<std::mutex> guard(graph.lock);
+	done = graph.numDone == (int)graph.tasks.size();
+	if (done || graph.contextQueue.empty())
+		return false;
+
+	index = graph.contextQueue.front();
+	graph.contextQueue.pop_front();
+	return true;
+}
+
+
+// -------------------------------------------
+// Load graph functions
+// -------------------------------------------
+
+void LoadGraphInit(CDTLoadGraph &graph)
+{
+	graph.tasks.clear();
+	graph.contextQueue.clear();
+	graph.workerQueue.clear();
+	graph.numDone = 0;
+	graph.time = 0.0;
+	graph.background = false;
+}
+
+int LoadGraphAdd(CDTLoadGraph &graph, const char* name, int thread, CDTLoadFunc func, void* data)
+{
+	CDTLoadTask task;
+	task.name = name;
+	task.thread = thread;
+	task.func = func;
+	task.data = data;
+	task.numDep = 0;
+	task.waiting = 0;
+	task.start = 0.0;
+	task.end = 0.0;
+	task.worker = 0;
+	task.graph = &graph;
+
+	graph.tasks.push_back(task);
+	return (int)graph.tasks.size() - 1;
+}
+
+void LoadGraphDepend(CDTLoadGraph &graph, int task, int dependency)
+{
+	if (dependency < 0 || dependency >= task) {
+		printf("LoadGraph: '%s' can only depend on a task added before it\n", graph.tasks[task].name);
+		return;
+	}
+
+	graph.tasks[dependency].next.push_back(task);
+	graph.tasks[task].numDep++;
+}
+
+void LoadGraphStart(CDTLoadGraph &graph, bool background)
+{
+	int numTask = (int)graph.tasks.size();
+	graph.numDone = 0;
+	graph.time = 0.0;
+	graph.background = background;
+	graph.contextQueue.clear();
+	graph.workerQueue.clear();
+	for (int n = 0; n < numTask; n++)
+		graph.tasks[n].waiting = graph.tasks[n].numDep;
+
+	graph.origin = std::chrono::steady_clock::now();
+	if (background)
+		graph.loader = std::thread(_loaderLoop, &graph);
+
+	// the roots, a task starts the tasks depending on it when it's done
+	for (int n = 0; n < numTask; n++) {
+		if (graph.tasks[n].numDep == 0)
+			_startTask(graph, n);
+	}
+}
+
+bool LoadGraphPoll(CDTLoadGraph &graph, double budget)
+{
+	double stop = _elapsed(graph) + budget;
+	bool done = false;
+	int index;
+
+	do {
+		if (!_popContext(graph, index, done))
+			break;
+		_runTask(graph, index, JobWorkerIndex());
+	} while (_elapsed(graph) < stop);
+
+	if (!done) {
+		std::lock_guard<std::mutex> guard(graph.lock);
+		done = graph.numDone == (int)graph.tasks.size();
+	}
+	if (done && graph.loader.joinable())
+		graph.loader.join();
+	return done;
+}
+
+void LoadGraphFinish(CDTLoadGraph &graph)
+{
+	bool done = false;
+	int index;
+
+	// context tasks first, they are usually the GL uploads the rest waits for
+	while (!done) {
+		if (_popContext(graph, index, done))
+			_runTask(graph, index, JobWorkerIndex());
+		else if (!done && (graph.background || !JobTryRun()))
+			std::this_thread::yield();
+	}
+
+	if (graph.loader.joinable())
+		graph.loader.join();
+}
+
+void LoadGraphRun(CDTLoadGraph &graph)
+{
+	LoadGraphStart(graph, false);
+	LoadGraphFinish(graph);
+}
+
+void LoadGraphReport(const CDTLoadGraph &graph)
+{
+	int numTask = (int)graph.tasks.size();
+	if (numTask == 0)
+		return;
+
+	// longest chain of dependent tasks, tasks are in dependency order
+	std::vector<double> chain(numTask);
+	std::vector<int> prev(numTask, -1);
+	std::vector<double> busy(CDT_JOB_MAX_WORKER + 1, 0.0);	// [0] is the loader thread
+	double serial = 0.0;
+	int last = 0;
+
+	for (int n = 0; n < numTask; n++) {
+		const CDTLoadTask &task = graph.tasks[n];
+		double duration = task.end - task.start;
+		chain[n] += duration;
+		serial += duration;
+		busy[task.worker + 1] += duration;
+
+		for (size_t k = 0; k < task.next.size(); k++) {
+			if (chain[n] > chain[task.next[k]]) {
+				chain[task.next[k]] = chain[n];
+				prev[task.next[k]] = n;
+			}
+		}
+		if (chain[n] > chain[last])
+			last = n;
+	}
+
+	printf("LoadGraph: %d tasks, %.2f ms (%.2f ms if serial, critical path %.2f ms)\n", numTask, graph.time, serial, chain[last]);
+	for (int n = 0; n < numTask; n++) {
+		const CDTLoadTask &task = graph.tasks[n];
+		printf("  %-24s %s %d  %8.2f -> %8.2f ms  (%.2f ms)\n", task.name,
+			task.thread == CDT_LOAD_CONTEXT ? "context" : "worker ", task.worker, task.start, task.end, task.end - task.start);
+	}
+	if (busy[0] > 0.0)
+		printf("  loader busy %.2f ms\n", busy[0]);
+	for (int w = 0; w < JobWorkerCount(); w++) {
+		if (busy[w + 1] > 0.0)
+			printf("  worker %d busy %.2f ms\n", w, busy[w + 1]);
+	}
+
+	// walk the critical path back from its last task
+	std::vector<int> path;
+	for (int n = last; n >= 0; n = prev[n])
+		path.push_back(n);
+
+	printf("  critical path:");
+	for (size_t n = path.size(); n-- > 0;)
+		printf(" %s (%.2f)%s", graph.tasks[path[n]].name, graph.tasks[path[n]].end - graph.tasks[path[n]].start, n > 0 ? " ->" : "\n");
+}
@@ -0,0 +1,88 @@
+#ifndef CDT_LOAD_GRAPH
+#define CDT_LOAD_GRAPH
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+
+// -------------------------------------------
+// CDT load graph
+//	- a game state declares its loading as tasks with dependencies,
+//	  every task starts as soon as its dependencies are done
+//	- worker tasks (decode, parse, ...) run on the job system, context
+//	  tasks (GL calls) run on the thread that owns the GL context, which
+//	  also helps running worker tasks while it waits for the graph
+//	- a background graph runs its worker tasks on its own loader thread
+//	  instead, so the jobs of the running game never wait behind them,
+//	  and its context tasks are run a few at a time by LoadGraphPoll
+//	- every task is timed, LoadGraphReport prints the critical path:
+//	  the chain of dependent tasks the load can't be shorter than
+//	- a task can only depend on tasks added before it
+// -------------------------------------------
+
+#define CDT_LOAD_WORKER				0				// any worker of the job system
+#define CDT_LOAD_CONTEXT			1				// the GL context thread
+
+typedef void(*CDTLoadFunc)(void* data);
+
+struct CDTLoadTask
+{
+	const char*			name;
+	int					thread;				// CDT_LOAD_WORKER or CDT_LOAD_CONTEXT
+	CDTLoadFunc			func;
+	void*				data;
+	std::vector<int>	next;				// tasks that depend on this one
+	int					numDep;
+	int					waiting;			// dependencies not done yet, while running
+	double				start;				// ms from LoadGraphStart
+	double				end;
+	int					worker;				// job worker that ran it, -1 for the loader thread
+	struct CDTLoadGraph* graph;
+};
+
+struct CDTLoadGraph
+{
+	std::vector<CDTLoadTask>	tasks;
+	double						time;		// ms from LoadGraphStart to the last task done
+
+	// while running
+	bool						background;
+	std::chrono::steady_clock::time_point	origin;
+	std::thread					loader;		// background graph only
+	std::mutex					lock;
+	std::condition_variable		wake;		// a worker task is ready for the loader
+	std::deque<int>				contextQueue;	// ready context tasks
+	std::deque<int>				workerQueue;	// ready worker tasks, background graph only
+	int							numDone;
+};
+
+// -------------------------------------------
+// Load graph functions
+// -------------------------------------------
+
+void LoadGraphInit(CDTLoadGraph &graph);
+int  LoadGraphAdd(CDTLoadGraph &graph, const char* name, int thread, CDTLoadFunc func, void* data);
+void LoadGraphDepend(CDTLoadGraph &graph, int task, int dependency);
+
+// start the tasks that have no dependency, the rest follow by themselves
+void LoadGraphStart(CDTLoadGraph &graph, bool background);
+
+// GL thread, run the ready context tasks for about budget ms, true when every task is done
+bool LoadGraphPoll(CDTLoadGraph &graph, double budget);
+
+// GL thread, block until every task is done
+void LoadGraphFinish(CDTLoadGraph &graph);
+
+// start and finish
+void LoadGraphRun(CDTLoadGraph &graph);
+
+// print the tasks, the time per thread and the critical path
+void LoadGraphReport(const CDTLoadGraph &graph);
+
+
+#endif
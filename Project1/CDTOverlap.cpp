@@ -0,0 +1,152 @@
+
+#include "CDTOverlap.h"
+#include "CDTCollision.h"
+#include "CDTPhysics.h"
+#include "CDTSimd.h"
+#include <string.h>
+#include <math.h>
+
+// -------------------------------------------
+// Overlap kernels
+//	- each kernel tests the candidates [begin,count), the SIMD ones
+//	  stop at their width and let the scalar one do the tail
+//	- the hit bits of a step always fall in the same mask word
+//	  since begin is a multiple of the width
+// -------------------------------------------
+
+static int _overlapScalar(float x, float y, float halfW, float halfH, const CDTBoxSoA &b, int begin, uint32_t* hitMask, uint8_t* sideFlags)
+{
+	int numHit = 0;
+
+	for (int i = begin; i < b.count; i++) {
+		int flags = OverlapBox(x, y, halfW, halfH, b.x[i], b.y[i], b.halfW[i], b.halfH[i]);
+		if (flags) {
+			hitMask[i >> 5] |= 1u << (i & 31);
+			numHit++;
+		}
+		if (sideFlags)
+			sideFlags[i] = (uint8_t)flags;
+	}
+	return numHit;
+}
+
+#if defined(CDT_SIMD_X86)
+
+static int _bitCount(int mask)
+{
+	int n = 0;
+	for (; mask; mask &= mask - 1)
+		n++;
+	return n;
+}
+
+static int _overlapSSE2(float x, float y, float halfW, float halfH, const CDTBoxSoA &b, int begin, uint32_t* hitMask, uint8_t* sideFlags)
+{
+	const __m128 qx = _mm_set1_ps(x), qy = _mm_set1_ps(y);
+	const __m128 qhw = _mm_set1_ps(halfW), qhh = _mm_set1_ps(halfH);
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	const __m128 zero = _mm_setzero_ps();
+	const __m128i left = _mm_set1_epi32(CDT_COLLISION_LEFT), right = _mm_set1_epi32(CDT_COLLISION_RIGHT);
+	const __m128i bottom = _mm_set1_epi32(CDT_COLLISION_BOTTOM), top = _mm_set1_epi32(CDT_COLLISION_TOP);
+	int numHit = 0;
+
+	int i = begin;
+	for (; i + 4 <= b.count; i += 4) {
+		__m128 dx = _mm_sub_ps(qx, _mm_loadu_ps(b.x + i));
+		__m128 dy = _mm_sub_ps(qy, _mm_loadu_ps(b.y + i));
+		__m128 inX = _mm_cmplt_ps(_mm_and_ps(dx, absMask), _mm_add_ps(qhw, _mm_loadu_ps(b.halfW + i)));
+		__m128 inY = _mm_cmplt_ps(_mm_and_ps(dy, absMask), _mm_add_ps(qhh, _mm_loadu_ps(b.halfH + i)));
+		__m128 hit = _mm_and_ps(inX, inY);
+
+		int mask = _mm_movemask_ps(hit);
+		hitMask[i >> 5] |= (uint32_t)mask << (i & 31);
+		numHit += _bitCount(mask);
+
+		if (sideFlags) {
+			// pick the side by the sign of the distance, keep it only for hits
+			__m128i posX = _mm_castps_si128(_mm_cmpgt_ps(dx, zero));
+			__m128i posY = _mm_castps_si128(_mm_cmpgt_ps(dy, zero));
+			__m128i flags = _mm_or_si128(
+				_mm_or_si128(_mm_and_si128(posX, left), _mm_andnot_si128(posX, right)),
+				_mm_or_si128(_mm_and_si128(posY, bottom), _mm_andnot_si128(posY, top)));
+			flags = _mm_and_si128(flags, _mm_castps_si128(hit));
+
+			__m128i bytes = _mm_packus_epi16(_mm_packs_epi32(flags, flags), _mm_setzero_si128());
+			int packed = _mm_cvtsi128_si32(bytes);
+			memcpy(sideFlags + i, &packed, 4);
+		}
+	}
+
+	return numHit + _overlapScalar(x, y, halfW, halfH, b, i, hitMask, sideFlags);
+}
+
+CDT_TARGET_AVX2 static int _overlapAVX2(float x, float y, float halfW, float halfH, const CDTBoxSoA &b, int begin, uint32_t* hitMask, uint8_t* sideFlags)
+{
+	const __m256 qx = _mm256_set1_ps(x), qy = _mm256_set1_ps(y);
+	const __m256 qhw = _mm256_set1_ps(halfW), qhh = _mm256_set1_ps(halfH);
+	const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256i left = _mm256_set1_epi32(CDT_COLLISION_LEFT), right = _mm256_set1_epi32(CDT_COLLISION_RIGHT);
+	const __m256i bottom = _mm256_set1_epi32(CDT_COLLISION_BOTTOM), top = _mm256_set1_epi32(CDT_COLLISION_TOP);
+	int numHit = 0;
+
+	int i = begin;
+	for (; i + 8 <= b.count; i += 8) {
+		__m256 dx = _mm256_sub_ps(qx, _mm256_loadu_ps(b.x + i));
+		__m256 dy = _mm256_sub_ps(qy, _mm256_loadu_ps(b.y + i));
+		__m256 inX = _mm256_cmp_ps(_mm256_and_ps(dx, absMask), _mm256_add_ps(qhw, _mm256_loadu_ps(b.halfW + i)), _CMP_LT_OQ);
+		__m256 inY = _mm256_cmp_ps(_mm256_and_ps(dy, absMask), _mm256_add_ps(qhh, _mm256_loadu_ps(b.halfH + i)), _CMP_LT_OQ);
+		__m256 hit = _mm256_and_ps(inX, inY);
+
+		int mask = _mm256_movemask_ps(hit);
+		hitMask[i >> 5] |= (uint32_t)mask << (i & 31);
+		numHit += _bitCount(mask);
+
+		if (sideFlags) {
+			__m256i posX = _mm256_castps_si256(_mm256_cmp_ps(dx, zero, _CMP_GT_OQ));
+			__m256i posY = _mm256_castps_si256(_mm256_cmp_ps(dy, zero, _CMP_GT_OQ));
+			__m256i flags = _mm256_or_si256(
+				_mm256_or_si256(_mm256_and_si256(posX, left), _mm256_andnot_si256(posX, right)),
+				_mm256_or_si256(_mm256_and_si256(posY, bottom), _mm256_andnot_si256(posY, top)));
+			flags = _mm256_and_si256(flags, _mm256_castps_si256(hit));
+
+			__m128i words = _mm_packs_epi32(_mm256_castsi256_si128(flags), _mm256_extracti128_si256(flags, 1));
+			__m128i bytes = _mm_packus_epi16(words, _mm_setzero_si128());
+			_mm_storel_epi64((__m128i*)(sideFlags + i), bytes);
+		}
+	}
+
+	return numHit + _overlapSSE2(x, y, halfW, halfH, b, i, hitMask, sideFlags);
+}
+
+#endif
+
+
+// -------------------------------------------
+// Overlap functions
+// -------------------------------------------
+
+int OverlapBox(float ax, float ay, float aHalfW, float aHalfH, float bx, float by, float bHalfW, float bHalfH)
+{
+	float dx = ax - bx, dy = ay - by;
+
+	if (fabsf(dx) >= aHalfW + bHalfW || fabsf(dy) >= aHalfH + bHalfH)
+		return 0;
+
+	return (dx > 0.0f ? CDT_COLLISION_LEFT : CDT_COLLISION_RIGHT) |
+		(dy > 0.0f ? CDT_COLLISION_BOTTOM : CDT_COLLISION_TOP);
+}
+
+int OverlapBoxBatch(float x, float y, float halfW, float halfH, const CDTBoxSoA &boxes, uint32_t* hitMask, uint8_t* sideFlags)
+{
+	memset(hitMask, 0, sizeof(uint32_t) * ((boxes.count + 31) >> 5));
+
+#if defined(CDT_SIMD_X86)
+	int kernel = PhysicsGetKernel();
+	if (kernel == CDT_KERNEL_AVX2)
+		return _overlapAVX2(x, y, halfW, halfH, boxes, 0, hitMask, sideFlags);
+	if (kernel == CDT_KERNEL_SSE2)
+		return _overlapSSE2(x, y, halfW, halfH, boxes, 0, hitMask, sideFlags);
+#endif
+	return _overlapScalar(x, y, halfW, halfH, boxes, 0, hitMask, sideFlags);
+}
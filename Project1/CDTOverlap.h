@@ -0,0 +1,42 @@
+
+#ifndef CDT_OVERLAP
+#define CDT_OVERLAP
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+// -------------------------------------------
+// CDT batch box overlap
+//	- 1 query box against a SoA array of candidate boxes, 4 (SSE2)
+//	  or 8 (AVX2) candidates per step, no branch per pair
+//	- boxes are given by center and half size, touching does not count
+//	- side flags are the CDT_COLLISION_ bits of the query side:
+//	  LEFT/RIGHT and BOTTOM/TOP from the sign of the center distance
+//	  (query - candidate), 0 when the boxes don't overlap
+//	- uses the kernel picked by PhysicsInit (CDT_KERNEL_)
+// -------------------------------------------
+
+struct CDTBoxSoA
+{
+	float*			x;
+	float*			y;
+	float*			halfW;
+	float*			halfH;
+	int				count;
+};
+
+// -------------------------------------------
+// Overlap functions
+// -------------------------------------------
+
+// side flags of 1 pair, same result as 1 lane of the batch
+int  OverlapBox(float ax, float ay, float aHalfW, float aHalfH, float bx, float by, float bHalfW, float bHalfH);
+
+// hitMask: bit (i & 31) of word (i >> 5) is set if candidate i overlaps, (count+31)/32 words
+// sideFlags: count bytes, may be NULL
+// return the number of overlapping candidates
+int  OverlapBoxBatch(float x, float y, float halfW, float halfH, const CDTBoxSoA &boxes, uint32_t* hitMask, uint8_t* sideFlags);
+
+
+#endif
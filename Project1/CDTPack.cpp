@@ -0,0 +1,330 @@
+
+#include "CDTPack.h"
+#include "CDTLZ4.h"
+#include <string.h>
+#include <fstream>
+#include <sstream>
+
+// compressed entries must save at least 1/8 of their size, or they are stored
+#define CDT_PACK_MIN_GAIN			8
+
+static CDTPack		cdt_pack;						// mounted pack, header NULL if none
+
+// -------------------------------------------
+// Internal functions
+// -------------------------------------------
+
+//+ Lower case, '/' separators, no leading "./"
+static std::string _normalizeName(const char* name)
+{
+	std::string out;
+	while (name[0] == '.' && (name[1] == '/' || name[1] == '\\'))
+		name += 2;
+
+	for (; *name; name++) {
+		char c = *name;
+		if (c == '\\') c = '/';
+		if (c >= 'A' && c <= 'Z') c = c - 'A' + 'a';
+		out += c;
+	}
+	return out;
+}
+
+//+ FNV-1a 64
+static uint64_t _hashName(const std::string &name)
+{
+	uint64_t h = 14695981039346656037ull;
+	for (size_t n = 0; n < name.size(); n++) {
+		h ^= (unsigned char)name[n];
+		h *= 1099511628211ull;
+	}
+	return h;
+}
+
+static uint64_t _align(uint64_t offset)
+{
+	return (offset + CDT_PACK_ALIGN - 1) & ~(uint64_t)(CDT_PACK_ALIGN - 1);
+}
+
+static bool _sectionValid(const CDTPackHeader* header, uint64_t offset, uint64_t size)
+{
+	return offset >= sizeof(CDTPackHeader) && offset <= header->fileSize && size <= header->fileSize - offset;
+}
+
+
+// -------------------------------------------
+// Pack functions
+// -------------------------------------------
+
+bool PackOpen(CDTPack &pack, const char* path)
+{
+	memset(&pack, 0, sizeof(CDTPack));
+
+	if (!FileMap(pack.file, path))
+		return false;
+
+	const CDTPackHeader* header = (const CDTPackHeader*)pack.file.data;
+	bool valid = pack.file.size >= sizeof(CDTPackHeader) &&
+		header->magic == CDT_PACK_MAGIC &&
+		header->version == CDT_PACK_VERSION &&
+		header->fileSize == pack.file.size &&
+		header->tableSize > 0 && (header->tableSize & (header->tableSize - 1)) == 0 &&
+		header->tableSize >= header->numEntry;
+
+	valid = valid &&
+		(header->entryOffset & 7) == 0 && (header->tableOffset & 3) == 0 &&
+		_sectionValid(header, header->entryOffset, (uint64_t)header->numEntry * sizeof(CDTPackEntry)) &&
+		_sectionValid(header, header->tableOffset, (uint64_t)header->tableSize * sizeof(uint32_t)) &&
+		_sectionValid(header, header->nameOffset, 0);
+
+	// every entry must be in the file, its name too
+	if (valid) {
+		const CDTPackEntry* entries = (const CDTPackEntry*)(pack.file.data + header->entryOffset);
+		for (uint32_t n = 0; n < header->numEntry && valid; n++) {
+			valid = _sectionValid(header, entries[n].offset, entries[n].size) &&
+				header->nameOffset + entries[n].nameOffset < header->fileSize &&
+				memchr(pack.file.data + header->nameOffset + entries[n].nameOffset, '\0',
+					(size_t)(header->fileSize - header->nameOffset - entries[n].nameOffset)) != NULL;
+		}
+	}
+
+	if (!valid) {
+		printf("Pack: %s is not a version %d pack\n", path, CDT_PACK_VERSION);
+		PackClose(pack);
+		return false;
+	}
+
+	pack.header = header;
+	pack.entries = (const CDTPackEntry*)(pack.file.data + header->entryOffset);
+	pack.table = (const uint32_t*)(pack.file.data + header->tableOffset);
+	pack.names = (const char*)(pack.file.data + header->nameOffset);
+	return true;
+}
+
+void PackClose(CDTPack &pack)
+{
+	FileUnmap(pack.file);
+	pack.header = NULL;
+	pack.entries = NULL;
+	pack.table = NULL;
+	pack.names = NULL;
+}
+
+const CDTPackEntry* PackFind(const CDTPack &pack, const char* name)
+{
+	if (pack.header == NULL)
+		return NULL;
+
+	std::string key = _normalizeName(name);
+	uint64_t hash = _hashName(key);
+	uint32_t mask = pack.header->tableSize - 1;
+
+	for (uint32_t probe = 0; probe <= mask; probe++) {
+		uint32_t slot = pack.table[(hash + probe) & mask];
+		if (slot == 0 || slot > pack.header->numEntry)
+			return NULL;
+
+		const CDTPackEntry* entry = pack.entries + (slot - 1);
+		if (entry->hash == hash && key == pack.names + entry->nameOffset)
+			return entry;
+	}
+	return NULL;
+}
+
+bool PackBuild(const char* listPath, const char* packPath)
+{
+	std::ifstream list(listPath);
+	if (!list.is_open()) {
+		printf("Pack: can't open %s\n", listPath);
+		return false;
+	}
+
+	std::vector<CDTPackEntry> entries;
+	std::vector<std::string> names;
+	std::vector< std::vector<unsigned char> > blobs;
+	std::string line;
+
+	while (std::getline(list, line)) {
+		std::istringstream words(line);
+		std::string path, option;
+		if (!(words >> path) || path[0] == '#')
+			continue;
+		words >> option;
+
+		CDTMappedFile file;
+		if (!FileMap(file, path.c_str())) {
+			printf("Pack: can't read %s, skipped\n", path.c_str());
+			continue;
+		}
+
+		std::string name = _normalizeName(path.c_str());
+		bool duplicate = false;
+		for (size_t n = 0; n < names.size() && !duplicate; n++)
+			duplicate = names[n] == name;
+		if (duplicate) {
+			printf("Pack: %s is listed twice, skipped\n", path.c_str());
+			FileUnmap(file);
+			continue;
+		}
+
+		CDTPackEntry entry;
+		memset(&entry, 0, sizeof(entry));
+		entry.hash = _hashName(name);
+		entry.rawSize = file.size;
+
+		std::vector<unsigned char> blob;
+		if (option == "lz4") {
+			blob.resize(LZ4Bound(file.size));
+			size_t size = LZ4Compress(file.data, file.size, &blob[0], blob.size());
+			if (size > 0 && size < file.size - file.size / CDT_PACK_MIN_GAIN) {
+				blob.resize(size);
+				entry.flags = CDT_PACK_LZ4;
+			}
+		}
+		if (entry.flags == 0)
+			blob.assign(file.data, file.data + file.size);
+		entry.size = blob.size();
+		FileUnmap(file);
+
+		entries.push_back(entry);
+		names.push_back(name);
+		blobs.push_back(std::vector<unsigned char>());
+		blobs.back().swap(blob);
+	}
+
+	// directory at most half full so the probes stay short
+	uint32_t numEntry = (uint32_t)entries.size();
+	uint32_t tableSize = 1;
+	while (tableSize < numEntry * 2 || tableSize < 2)
+		tableSize <<= 1;
+
+	std::vector<uint32_t> table(tableSize, 0);
+	for (uint32_t n = 0; n < numEntry; n++) {
+		uint32_t slot = (uint32_t)(entries[n].hash & (tableSize - 1));
+		while (table[slot] != 0)
+			slot = (slot + 1) & (tableSize - 1);
+		table[slot] = n + 1;
+	}
+
+	std::string nameBlock;
+	for (uint32_t n = 0; n < numEntry; n++) {
+		entries[n].nameOffset = (uint32_t)nameBlock.size();
+		nameBlock += names[n];
+		nameBlock += '\0';
+	}
+
+	// lay the sections out after the header
+	CDTPackHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = CDT_PACK_MAGIC;
+	header.version = CDT_PACK_VERSION;
+	header.numEntry = numEntry;
+	header.tableSize = tableSize;
+	header.entryOffset = _align(sizeof(CDTPackHeader));
+	header.tableOffset = _align(header.entryOffset + numEntry * sizeof(CDTPackEntry));
+	header.nameOffset = _align(header.tableOffset + tableSize * sizeof(uint32_t));
+
+	uint64_t offset = _align(header.nameOffset + nameBlock.size());
+	for (uint32_t n = 0; n < numEntry; n++) {
+		entries[n].offset = offset;
+		offset = _align(offset + entries[n].size);
+	}
+	header.fileSize = offset;
+
+	std::vector<unsigned char> data((size_t)header.fileSize, 0);
+	memcpy(&data[0], &header, sizeof(header));
+	if (numEntry > 0)
+		memcpy(&data[(size_t)header.entryOffset], &entries[0], numEntry * sizeof(CDTPackEntry));
+	memcpy(&data[(size_t)header.tableOffset], &table[0], tableSize * sizeof(uint32_t));
+	if (!nameBlock.empty())
+		memcpy(&data[(size_t)header.nameOffset], nameBlock.data(), nameBlock.size());
+	for (uint32_t n = 0; n < numEntry; n++) {
+		if (!blobs[n].empty())
+			memcpy(&data[(size_t)entries[n].offset], &blobs[n][0], blobs[n].size());
+	}
+
+	if (!FileWrite(packPath, &data[0], data.size())) {
+		printf("Pack: can't write %s\n", packPath);
+		return false;
+	}
+
+	uint64_t rawSize = 0;
+	for (uint32_t n = 0; n < numEntry; n++)
+		rawSize += entries[n].rawSize;
+	printf("Pack: %s -> %s (%u assets, %llu bytes, %llu bytes unpacked)\n", listPath, packPath,
+		numEntry, (unsigned long long)header.fileSize, (unsigned long long)rawSize);
+	return true;
+}
+
+
+// -------------------------------------------
+// Asset functions
+// -------------------------------------------
+
+bool AssetMount(const char* packPath)
+{
+	AssetUnmount();
+	return PackOpen(cdt_pack, packPath);
+}
+
+void AssetUnmount()
+{
+	PackClose(cdt_pack);
+}
+
+bool AssetOpenFile(CDTAsset &asset, const char* path)
+{
+	asset.data = NULL;
+	asset.size = 0;
+	asset.storage.clear();
+	asset.file.data = NULL;
+	asset.file.size = 0;
+	asset.file.fileHandle = NULL;
+	asset.file.mapHandle = NULL;
+
+	if (!FileMap(asset.file, path))
+		return false;
+	asset.data = asset.file.data;
+	asset.size = asset.file.size;
+	return true;
+}
+
+bool AssetOpen(CDTAsset &asset, const char* name)
+{
+	const CDTPackEntry* entry = PackFind(cdt_pack, name);
+	if (entry == NULL)
+		return AssetOpenFile(asset, name);
+
+	asset.data = NULL;
+	asset.size = 0;
+	asset.storage.clear();
+	asset.file.data = NULL;
+	asset.file.size = 0;
+	asset.file.fileHandle = NULL;
+	asset.file.mapHandle = NULL;
+
+	unsigned char* stored = cdt_pack.file.data + entry->offset;
+	if (!(entry->flags & CDT_PACK_LZ4)) {
+		asset.data = stored;
+		asset.size = (size_t)entry->size;
+		return true;
+	}
+
+	asset.storage.resize((size_t)entry->rawSize);
+	if (!LZ4Decompress(stored, (size_t)entry->size, asset.storage.empty() ? NULL : &asset.storage[0], asset.storage.size())) {
+		printf("Pack: %s is corrupted\n", name);
+		asset.storage.clear();
+		return false;
+	}
+	asset.data = asset.storage.empty() ? NULL : &asset.storage[0];
+	asset.size = asset.storage.size();
+	return true;
+}
+
+void AssetClose(CDTAsset &asset)
+{
+	FileUnmap(asset.file);
+	std::vector<unsigned char>().swap(asset.storage);
+	asset.data = NULL;
+	asset.size = 0;
+}
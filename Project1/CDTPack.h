@@ -0,0 +1,109 @@
+
+#ifndef CDT_PACK
+#define CDT_PACK
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "CDTFile.h"
+
+// -------------------------------------------
+// CDT asset pack
+//	- every asset in 1 file, mapped once, read in place
+//	- layout (little endian):
+//		CDTPackHeader
+//		entries			numEntry CDTPackEntry
+//		directory		tableSize uint32_t, open addressing hash table of
+//						entry index + 1 (0 = empty slot), linear probing
+//		names			the asset names, '\0' terminated
+//		data			each entry CDT_PACK_ALIGN aligned, stored or LZ4
+//	- names are relative paths with '/', compared without case, so
+//	  "rngun\Player\a.png" and "rngun/player/A.png" are the same asset
+//	- AssetOpen looks in the mounted pack first, then on disk: a game
+//	  runs the same with the loose WorkingDir files or with the pack
+// -------------------------------------------
+
+#define CDT_PACK_MAGIC				0x4B415052		// "RPAK"
+#define CDT_PACK_VERSION			1
+#define CDT_PACK_ALIGN				16
+
+#define CDT_PACK_LZ4				(1 << 0)		// entry data is an LZ4 block of rawSize bytes
+
+struct CDTPackHeader
+{
+	uint32_t		magic;
+	uint32_t		version;
+	uint64_t		fileSize;
+	uint32_t		numEntry;
+	uint32_t		tableSize;				// power of 2, at least 2 * numEntry
+	uint64_t		entryOffset;
+	uint64_t		tableOffset;
+	uint64_t		nameOffset;
+};
+
+struct CDTPackEntry
+{
+	uint64_t		hash;					// of the normalized name
+	uint64_t		offset;					// of the data, from the start of the file
+	uint64_t		size;					// stored size
+	uint64_t		rawSize;				// size once decompressed
+	uint32_t		nameOffset;				// from nameOffset of the header
+	uint32_t		flags;					// CDT_PACK_ flags
+};
+
+struct CDTPack
+{
+	CDTMappedFile			file;
+	const CDTPackHeader*	header;
+	const CDTPackEntry*		entries;
+	const uint32_t*			table;
+	const char*				names;
+};
+
+// the bytes of 1 asset
+//	- points in the mapped pack when the entry is stored, owns the
+//	  decompressed bytes otherwise, or maps the loose file
+//	- the data is writable, changes are private (copy on write mapping)
+struct CDTAsset
+{
+	unsigned char*				data;		// NULL if not found
+	size_t						size;
+	std::vector<unsigned char>	storage;
+	CDTMappedFile				file;
+};
+
+// -------------------------------------------
+// Pack functions
+// -------------------------------------------
+
+bool PackOpen(CDTPack &pack, const char* path);
+void PackClose(CDTPack &pack);
+
+// NULL if the pack has no such asset
+const CDTPackEntry* PackFind(const CDTPack &pack, const char* name);
+
+// build a pack from a list file, 1 asset path per line, relative to
+// the working directory, optionally followed by "lz4" to compress it
+//	- an entry is stored raw when compressing doesn't save anything
+bool PackBuild(const char* listPath, const char* packPath);
+
+// -------------------------------------------
+// Asset functions
+// -------------------------------------------
+
+// mount the pack used by AssetOpen, only 1 at a time
+bool AssetMount(const char* packPath);
+void AssetUnmount();
+
+// read an asset from the mounted pack, or from the file if not in it
+bool AssetOpen(CDTAsset &asset, const char* name);
+void AssetClose(CDTAsset &asset);
+
+// read the file even if the mounted pack has an asset of that name,
+// for a file written at run time (the pack entry is older)
+bool AssetOpenFile(CDTAsset &asset, const char* path);
+
+
+#endif
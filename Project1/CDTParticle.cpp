@@ -0,0 +1,402 @@
+
+#include "CDTParticle.h"
+#include "CDTPhysics.h"
+#include "CDTResource.h"
+#include "CDTSimd.h"
+#include <math.h>
+#include <chrono>
+#include <algorithm>
+
+#define CDT_PARTICLE_ARRAYS			7				// float arrays of a pool
+
+typedef int(*CDTParticleFunc)(const CDTParticlePool &pool, int begin, float dt);
+
+// -------------------------------------------
+// Update kernels
+//	- each kernel updates the particles [begin,count) and returns how many
+//	  are dead (age >= life), the SIMD ones stop at their width and let the
+//	  scalar one do the tail
+//	- frame = floor(age / life * numFrame), the last frame at most
+// -------------------------------------------
+
+static int _updateScalar(const CDTParticlePool &p, int begin, float dt)
+{
+	float gdt = p.type.gravity * dt;
+	float numFrame = (float)p.type.numFrame, lastFrame = numFrame - 1.0f;
+	int numDead = 0;
+
+	for (int i = begin; i < p.count; i++) {
+		p.velY[i] += gdt;
+		p.posX[i] += p.velX[i] * dt;
+		p.posY[i] += p.velY[i] * dt;
+		p.age[i] += dt;
+
+		float t = p.age[i] * p.invLife[i];
+		p.frame[i] = std::min((float)(int)(t * numFrame), lastFrame);
+		numDead += t >= 1.0f;
+	}
+	return numDead;
+}
+
+#if defined(CDT_SIMD_X86)
+
+// bits set in 4 bits
+static const int cdt_bitcount[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+static int _updateSSE2(const CDTParticlePool &p, int begin, float dt)
+{
+	__m128 vdt = _mm_set1_ps(dt);
+	__m128 vgdt = _mm_set1_ps(p.type.gravity * dt);
+	__m128 vnum = _mm_set1_ps((float)p.type.numFrame);
+	__m128 vlast = _mm_set1_ps((float)p.type.numFrame - 1.0f);
+	__m128 vone = _mm_set1_ps(1.0f);
+	int numDead = 0;
+
+	int i = begin;
+	for (; i + 4 <= p.count; i += 4) {
+		__m128 vy = _mm_add_ps(_mm_loadu_ps(p.velY + i), vgdt);
+		__m128 px = _mm_add_ps(_mm_loadu_ps(p.posX + i), _mm_mul_ps(_mm_loadu_ps(p.velX + i), vdt));
+		__m128 py = _mm_add_ps(_mm_loadu_ps(p.posY + i), _mm_mul_ps(vy, vdt));
+		__m128 age = _mm_add_ps(_mm_loadu_ps(p.age + i), vdt);
+
+		// t >= 0, the truncation is the floor
+		__m128 t = _mm_mul_ps(age, _mm_loadu_ps(p.invLife + i));
+		__m128 frame = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_mul_ps(t, vnum))), vlast);
+
+		_mm_storeu_ps(p.velY + i, vy);
+		_mm_storeu_ps(p.posX + i, px);
+		_mm_storeu_ps(p.posY + i, py);
+		_mm_storeu_ps(p.age + i, age);
+		_mm_storeu_ps(p.frame + i, frame);
+		numDead += cdt_bitcount[_mm_movemask_ps(_mm_cmpge_ps(t, vone))];
+	}
+
+	return numDead + _updateScalar(p, i, dt);
+}
+
+CDT_TARGET_AVX2 static int _updateAVX2(const CDTParticlePool &p, int begin, float dt)
+{
+	__m256 vdt = _mm256_set1_ps(dt);
+	__m256 vgdt = _mm256_set1_ps(p.type.gravity * dt);
+	__m256 vnum = _mm256_set1_ps((float)p.type.numFrame);
+	__m256 vlast = _mm256_set1_ps((float)p.type.numFrame - 1.0f);
+	__m256 vone = _mm256_set1_ps(1.0f);
+	int numDead = 0;
+
+	int i = begin;
+	for (; i + 8 <= p.count; i += 8) {
+		__m256 vy = _mm256_add_ps(_mm256_loadu_ps(p.velY + i), vgdt);
+		__m256 px = _mm256_add_ps(_mm256_loadu_ps(p.posX + i), _mm256_mul_ps(_mm256_loadu_ps(p.velX + i), vdt));
+		__m256 py = _mm256_add_ps(_mm256_loadu_ps(p.posY + i), _mm256_mul_ps(vy, vdt));
+		__m256 age = _mm256_add_ps(_mm256_loadu_ps(p.age + i), vdt);
+
+		__m256 t = _mm256_mul_ps(age, _mm256_loadu_ps(p.invLife + i));
+		__m256 frame = _mm256_min_ps(_mm256_floor_ps(_mm256_mul_ps(t, vnum)), vlast);
+
+		_mm256_storeu_ps(p.velY + i, vy);
+		_mm256_storeu_ps(p.posX + i, px);
+		_mm256_storeu_ps(p.posY + i, py);
+		_mm256_storeu_ps(p.age + i, age);
+		_mm256_storeu_ps(p.frame + i, frame);
+
+		int dead = _mm256_movemask_ps(_mm256_cmp_ps(t, vone, _CMP_GE_OQ));
+		numDead += cdt_bitcount[dead & 15] + cdt_bitcount[dead >> 4];
+	}
+
+	return numDead + _updateSSE2(p, i, dt);
+}
+
+#endif
+
+static CDTParticleFunc _kernelFunc(int kernel)
+{
+#if defined(CDT_SIMD_X86)
+	if (kernel == CDT_KERNEL_AVX2) return _updateAVX2;
+	if (kernel == CDT_KERNEL_SSE2) return _updateSSE2;
+#endif
+	return _updateScalar;
+}
+
+
+// -------------------------------------------
+// Internal functions
+// -------------------------------------------
+
+static float _random(CDTParticleSystem &system)
+{
+	// xorshift32, [0,1)
+	uint32_t x = system.random;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	system.random = x;
+	return (x >> 8) * (1.0f / 16777216.0f);
+}
+
+//+ The dead particles are replaced by the last ones, the order doesn't matter
+static void _removeDead(CDTParticlePool &p)
+{
+	for (int i = 0; i < p.count;) {
+		if (p.age[i] * p.invLife[i] < 1.0f) {
+			i++;
+			continue;
+		}
+
+		int last = --p.count;
+		p.posX[i] = p.posX[last];
+		p.posY[i] = p.posY[last];
+		p.velX[i] = p.velX[last];
+		p.velY[i] = p.velY[last];
+		p.age[i] = p.age[last];
+		p.invLife[i] = p.invLife[last];
+		p.frame[i] = p.frame[last];
+	}
+}
+
+//+ Quad and instance buffers, the instance attributes read the arrays uploaded by ParticleDraw
+static void _createBuffers(CDTParticlePool &p)
+{
+	static const float quad[12] = { -0.5f, -0.5f, 0.5f, -0.5f, 0.5f, 0.5f, -0.5f, -0.5f, 0.5f, 0.5f, -0.5f, 0.5f };
+	size_t bytes = (size_t)p.type.capacity * sizeof(float);
+
+	glGenVertexArrays(1, &p.vao);
+	glBindVertexArray(p.vao);
+
+	glGenBuffers(1, &p.quadBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, p.quadBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), BUFFER_OFFSET(0));
+
+	glGenBuffers(1, &p.instanceBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, p.instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, 3 * bytes, NULL, GL_STREAM_DRAW);
+	for (int a = 0; a < 3; a++) {
+		glEnableVertexAttribArray(3 + a);
+		glVertexAttribPointer(3 + a, 1, GL_FLOAT, GL_FALSE, sizeof(float), BUFFER_OFFSET(a * bytes));
+		glVertexAttribDivisor(3 + a, 1);
+	}
+
+	glBindVertexArray(0);
+}
+
+
+// -------------------------------------------
+// Particle functions
+// -------------------------------------------
+
+void ParticleInit(CDTParticleSystem &system)
+{
+	system.numPool = 0;
+	system.random = 0x9E3779B9u;
+	system.program = 0;
+	system.numAlive = 0;
+	system.numEmit = 0;
+	system.numDropped = 0;
+	system.numDraw = 0;
+	system.updateTime = 0.0;
+}
+
+void ParticleShutdown(CDTParticleSystem &system)
+{
+	for (int t = 0; t < system.numPool; t++) {
+		CDTParticlePool &p = system.pools[t];
+		if (p.vao != 0) {
+			glDeleteBuffers(1, &p.quadBuffer);
+			glDeleteBuffers(1, &p.instanceBuffer);
+			glDeleteVertexArrays(1, &p.vao);
+		}
+		std::vector<float>().swap(p.storage);
+		p.count = 0;
+	}
+
+	if (system.program != 0)
+		ResourceReleaseShader(system.program);
+	system.program = 0;
+	system.numPool = 0;
+}
+
+int ParticleAddType(CDTParticleSystem &system, const CDTParticleType &type)
+{
+	if (system.numPool == CDT_PARTICLE_MAX_TYPE)
+		return -1;
+
+	CDTParticlePool &p = system.pools[system.numPool];
+	p.type = type;
+	p.storage.assign((size_t)type.capacity * CDT_PARTICLE_ARRAYS, 0.0f);
+
+	float* arrays[CDT_PARTICLE_ARRAYS];
+	for (int a = 0; a < CDT_PARTICLE_ARRAYS; a++)
+		arrays[a] = &p.storage[0] + (size_t)a * type.capacity;
+	p.posX = arrays[0];
+	p.posY = arrays[1];
+	p.velX = arrays[2];
+	p.velY = arrays[3];
+	p.age = arrays[4];
+	p.invLife = arrays[5];
+	p.frame = arrays[6];
+	p.count = 0;
+	p.vao = 0;
+
+	return system.numPool++;
+}
+
+void ParticleEmit(CDTParticleSystem &system, int type, float x, float y, float dirX, float dirY, int count)
+{
+	if (type < 0 || type >= system.numPool)
+		return;
+
+	CDTParticlePool &p = system.pools[type];
+	const CDTParticleType &t = p.type;
+	system.numEmit += count;
+
+	int room = t.capacity - p.count;
+	if (count > room) {
+		system.numDropped += count - room;
+		count = room;
+	}
+
+	float direction = atan2f(dirY, dirX);
+	for (int n = 0; n < count; n++) {
+		float angle = direction + (_random(system) - 0.5f) * t.spread;
+		float speed = t.speedMin + (t.speedMax - t.speedMin) * _random(system);
+		float life = t.lifeMin + (t.lifeMax - t.lifeMin) * _random(system);
+
+		int i = p.count++;
+		p.posX[i] = x;
+		p.posY[i] = y;
+		p.velX[i] = cosf(angle) * speed;
+		p.velY[i] = sinf(angle) * speed;
+		p.age[i] = 0.0f;
+		p.invLife[i] = 1.0f / life;
+		p.frame[i] = 0.0f;
+	}
+}
+
+void ParticleClear(CDTParticleSystem &system)
+{
+	for (int t = 0; t < system.numPool; t++)
+		system.pools[t].count = 0;
+	system.numAlive = 0;
+}
+
+void ParticleUpdate(CDTParticleSystem &system, float dt)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	CDTParticleFunc update = _kernelFunc(PhysicsGetKernel());
+
+	system.numAlive = 0;
+	for (int t = 0; t < system.numPool; t++) {
+		CDTParticlePool &p = system.pools[t];
+		if (p.count == 0)
+			continue;
+
+		if (update(p, 0, dt) > 0)
+			_removeDead(p);
+		system.numAlive += p.count;
+	}
+
+	system.updateTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void ParticleDraw(CDTParticleSystem &system, const CDTAffine2D &view)
+{
+	system.numDraw = 0;
+	if (system.numAlive == 0)
+		return;
+
+	if (system.program == 0) {
+		system.program = ResourceLoadShader("particle.vert", "particle.frag");
+		system.mvp = glGetUniformLocation(system.program, "MVP");
+		system.size = glGetUniformLocation(system.program, "size");
+		system.frameWidth = glGetUniformLocation(system.program, "frameWidth");
+		glUseProgram(system.program);
+		glUniform1i(glGetUniformLocation(system.program, "tex1"), 0);
+	}
+	UseProgram(system.program);
+
+	// same as SetTransform2D
+	const glm::mat4& vp = GetViewProjMatrix();
+	glm::mat4 mvp;
+	mvp[0] = vp[0] * view.a + vp[1] * view.b;
+	mvp[1] = vp[0] * view.c + vp[1] * view.d;
+	mvp[2] = vp[2];
+	mvp[3] = vp[0] * view.tx + vp[1] * view.ty + vp[3];
+	glUniformMatrix4fv(system.mvp, 1, GL_FALSE, &mvp[0][0]);
+	glActiveTexture(GL_TEXTURE0);
+
+	for (int t = 0; t < system.numPool; t++) {
+		CDTParticlePool &p = system.pools[t];
+		if (p.count == 0)
+			continue;
+		if (p.vao == 0)
+			_createBuffers(p);
+
+		// orphaned, the driver doesn't wait for the last frame draw
+		size_t bytes = (size_t)p.type.capacity * sizeof(float), used = (size_t)p.count * sizeof(float);
+		glBindBuffer(GL_ARRAY_BUFFER, p.instanceBuffer);
+		glBufferData(GL_ARRAY_BUFFER, 3 * bytes, NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, used, p.posX);
+		glBufferSubData(GL_ARRAY_BUFFER, bytes, used, p.posY);
+		glBufferSubData(GL_ARRAY_BUFFER, 2 * bytes, used, p.frame);
+
+		glUniform1f(system.size, p.type.size);
+		glUniform1f(system.frameWidth, 1.0f / p.type.numFrame);
+		glBindTexture(GL_TEXTURE_2D, p.type.tex);
+
+		glBindVertexArray(p.vao);
+		glDrawArraysInstanced(GL_TRIANGLES, 0, 6, p.count);
+		system.numDraw++;
+	}
+
+	glBindVertexArray(0);
+}
+
+void ParticleBenchmark(int numParticle, int numIteration)
+{
+	CDTParticleSystem system;
+	ParticleInit(system);
+
+	CDTParticleType type;
+	type.tex = 0;
+	type.numFrame = 9;
+	type.size = 1.0f;
+	type.gravity = -5.0f;
+	type.lifeMin = 0.5f;
+	type.lifeMax = 2.0f;
+	type.speedMin = 1.0f;
+	type.speedMax = 4.0f;
+	type.spread = 2.0f * (float)PI;
+	type.capacity = numParticle;
+	int explosion = ParticleAddType(system, type);
+
+	int prevKernel = PhysicsGetKernel();
+	printf("Particle benchmark: %d particles, %d iterations\n", numParticle, numIteration);
+
+	for (int kernel = 0; kernel < CDT_KERNEL_MAX; kernel++) {
+		if (!PhysicsKernelSupported(kernel)) {
+			printf("  %-8s not supported\n", PhysicsKernelName(kernel));
+			continue;
+		}
+
+		// same start state for every kernel, the dead ones are emitted again
+		ParticleClear(system);
+		system.random = 0x9E3779B9u;
+		ParticleEmit(system, explosion, 0.0f, 0.0f, 0.0f, 1.0f, numParticle);
+
+		PhysicsSetKernel(kernel);
+		double total = 0.0, worst = 0.0;
+		for (int n = 0; n < numIteration; n++) {
+			ParticleUpdate(system, 1.0f / 60.0f);
+			total += system.updateTime;
+			worst = std::max(worst, system.updateTime);
+			ParticleEmit(system, explosion, 0.0f, 0.0f, 0.0f, 1.0f, numParticle - system.numAlive);
+		}
+
+		printf("  %-8s %8.3f ms/update  %8.3f ms worst  (check %f)\n", PhysicsKernelName(kernel),
+			total / numIteration, worst, system.pools[explosion].posY[0]);
+	}
+
+	PhysicsSetKernel(prevKernel);
+	ParticleShutdown(system);
+}
@@ -0,0 +1,103 @@
+
+#ifndef CDT_PARTICLE
+#define CDT_PARTICLE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include "CDT.h"
+
+// -------------------------------------------
+// CDT particles
+//	- effects (explosions, muzzle flashes) are not game objects, they are
+//	  particles of an emitter type, each type has its own pool of
+//	  capacity particles in SoA arrays
+//	- ParticleUpdate moves them, ages them and picks their frame with the
+//	  physics kernel (SSE2, AVX2), the dead ones are swapped with the last
+//	- a type is drawn by 1 instanced draw: the quad is instanced on the
+//	  posX, posY and frame arrays, uploaded as they are
+//	- the sprite sheet of a type has its frames side by side, a particle
+//	  goes through them once during its life
+//	- positions are in the space of the view transform given to
+//	  ParticleDraw (map units for a level)
+// -------------------------------------------
+
+#define CDT_PARTICLE_MAX_TYPE		8
+
+// emitter type, given to ParticleAddType
+struct CDTParticleType
+{
+	CDTTex			tex;					// sprite sheet
+	int				numFrame;
+	float			size;					// quad side
+	float			gravity;				// added to velY per second
+	float			lifeMin;				// seconds
+	float			lifeMax;
+	float			speedMin;
+	float			speedMax;
+	float			spread;					// radians, around the emit direction
+	int				capacity;				// particles alive at most
+};
+
+struct CDTParticlePool
+{
+	CDTParticleType		type;
+	std::vector<float>	storage;			// the arrays below
+	float*				posX;
+	float*				posY;
+	float*				velX;
+	float*				velY;
+	float*				age;				// seconds
+	float*				invLife;			// 1 / life
+	float*				frame;				// of the sprite sheet
+	int					count;
+
+	GLuint				vao;				// 0 until drawn
+	GLuint				quadBuffer;
+	GLuint				instanceBuffer;		// posX | posY | frame, capacity each
+};
+
+struct CDTParticleSystem
+{
+	CDTParticlePool		pools[CDT_PARTICLE_MAX_TYPE];
+	int					numPool;
+	uint32_t			random;
+
+	GLuint				program;			// 0 until drawn
+	GLint				mvp;				// uniform locations
+	GLint				size;
+	GLint				frameWidth;
+
+	// stats
+	int					numAlive;
+	int					numEmit;			// since ParticleInit
+	int					numDropped;			// emitted with a full pool
+	int					numDraw;			// last ParticleDraw
+	double				updateTime;			// ms, last ParticleUpdate
+};
+
+// -------------------------------------------
+// Particle functions
+// -------------------------------------------
+
+void ParticleInit(CDTParticleSystem &system);
+void ParticleShutdown(CDTParticleSystem &system);
+
+// type index, -1 if there are CDT_PARTICLE_MAX_TYPE types
+int  ParticleAddType(CDTParticleSystem &system, const CDTParticleType &type);
+
+// count particles at (x,y) toward (dirX,dirY), spread by the type
+void ParticleEmit(CDTParticleSystem &system, int type, float x, float y, float dirX, float dirY, int count);
+void ParticleClear(CDTParticleSystem &system);
+
+void ParticleUpdate(CDTParticleSystem &system, float dt);
+
+// 1 draw per type with particles, view: from particle space to world space
+void ParticleDraw(CDTParticleSystem &system, const CDTAffine2D &view);
+
+// time the update of numParticle particles and print it, no window needed
+void ParticleBenchmark(int numParticle, int numIteration);
+
+
+#endif
@@ -0,0 +1,196 @@
+
+#include "CDTPhysics.h"
+#include "CDTSimd.h"
+#include <vector>
+#include <chrono>
+
+typedef void(*CDTIntegrateFunc)(const CDTBodySoA &bodies, int begin, float dt, float gravity);
+
+// -------------------------------------------
+// CDT physics global variables
+// -------------------------------------------
+
+static int					cdt_kernel = CDT_KERNEL_SCALAR;
+static bool					cdt_physicsinit = false;
+
+
+// -------------------------------------------
+// Integration kernels
+//	- each kernel integrates the bodies [begin,count), the SIMD ones
+//	  stop at their width and let the scalar one do the tail
+// -------------------------------------------
+
+static void _integrateScalar(const CDTBodySoA &b, int begin, float dt, float gravity)
+{
+	float gdt = gravity * dt;
+
+	for (int i = begin; i < b.count; i++) {
+		float g = (b.gravityMask[i] != 0) ? gdt : 0.0f;
+		b.velY[i] += g;
+		b.posX[i] += b.velX[i] * dt;
+		b.posY[i] += b.velY[i] * dt;
+	}
+}
+
+#if defined(CDT_SIMD_X86)
+
+static void _integrateSSE2(const CDTBodySoA &b, int begin, float dt, float gravity)
+{
+	__m128 vdt = _mm_set1_ps(dt);
+	__m128 vgdt = _mm_set1_ps(gravity * dt);
+
+	int i = begin;
+	for (; i + 4 <= b.count; i += 4) {
+		__m128 mask = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)(b.gravityMask + i)));
+		__m128 vy = _mm_add_ps(_mm_loadu_ps(b.velY + i), _mm_and_ps(mask, vgdt));
+		__m128 px = _mm_add_ps(_mm_loadu_ps(b.posX + i), _mm_mul_ps(_mm_loadu_ps(b.velX + i), vdt));
+		__m128 py = _mm_add_ps(_mm_loadu_ps(b.posY + i), _mm_mul_ps(vy, vdt));
+
+		_mm_storeu_ps(b.velY + i, vy);
+		_mm_storeu_ps(b.posX + i, px);
+		_mm_storeu_ps(b.posY + i, py);
+	}
+
+	_integrateScalar(b, i, dt, gravity);
+}
+
+CDT_TARGET_AVX2 static void _integrateAVX2(const CDTBodySoA &b, int begin, float dt, float gravity)
+{
+	__m256 vdt = _mm256_set1_ps(dt);
+	__m256 vgdt = _mm256_set1_ps(gravity * dt);
+
+	int i = begin;
+	for (; i + 8 <= b.count; i += 8) {
+		__m256 mask = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i*)(b.gravityMask + i)));
+		__m256 vy = _mm256_add_ps(_mm256_loadu_ps(b.velY + i), _mm256_and_ps(mask, vgdt));
+		__m256 px = _mm256_add_ps(_mm256_loadu_ps(b.posX + i), _mm256_mul_ps(_mm256_loadu_ps(b.velX + i), vdt));
+		__m256 py = _mm256_add_ps(_mm256_loadu_ps(b.posY + i), _mm256_mul_ps(vy, vdt));
+
+		_mm256_storeu_ps(b.velY + i, vy);
+		_mm256_storeu_ps(b.posX + i, px);
+		_mm256_storeu_ps(b.posY + i, py);
+	}
+
+	_integrateSSE2(b, i, dt, gravity);
+}
+
+#endif
+
+static CDTIntegrateFunc _kernelFunc(int kernel)
+{
+#if defined(CDT_SIMD_X86)
+	if (kernel == CDT_KERNEL_AVX2) return _integrateAVX2;
+	if (kernel == CDT_KERNEL_SSE2) return _integrateSSE2;
+#endif
+	return _integrateScalar;
+}
+
+
+// -------------------------------------------
+// Physics functions
+// -------------------------------------------
+
+void PhysicsInit()
+{
+	cdt_kernel = CDT_KERNEL_SCALAR;
+	if (PhysicsKernelSupported(CDT_KERNEL_SSE2)) cdt_kernel = CDT_KERNEL_SSE2;
+	if (PhysicsKernelSupported(CDT_KERNEL_AVX2)) cdt_kernel = CDT_KERNEL_AVX2;
+	cdt_physicsinit = true;
+
+	printf("Physics: %s integration kernel\n", PhysicsKernelName(cdt_kernel));
+}
+
+bool PhysicsKernelSupported(int kernel)
+{
+	switch (kernel)
+	{
+	case CDT_KERNEL_SCALAR:
+		return true;
+	case CDT_KERNEL_SSE2:
+		return CpuHasSSE2();
+	case CDT_KERNEL_AVX2:
+		return CpuHasAVX2();
+	default:
+		return false;
+	}
+}
+
+void PhysicsSetKernel(int kernel)
+{
+	if (PhysicsKernelSupported(kernel)) {
+		cdt_kernel = kernel;
+		cdt_physicsinit = true;
+	}
+}
+
+int PhysicsGetKernel()
+{
+	return cdt_kernel;
+}
+
+const char* PhysicsKernelName(int kernel)
+{
+	switch (kernel)
+	{
+	case CDT_KERNEL_SSE2:
+		return "SSE2";
+	case CDT_KERNEL_AVX2:
+		return "AVX2";
+	default:
+		return "scalar";
+	}
+}
+
+void IntegrateBodies(const CDTBodySoA &bodies, float dt, float gravity)
+{
+	if (!cdt_physicsinit)
+		PhysicsInit();
+
+	_kernelFunc(cdt_kernel)(bodies, 0, dt, gravity);
+}
+
+void PhysicsBenchmark(int numBody, int numIteration)
+{
+	std::vector<float> posX(numBody), posY(numBody), velX(numBody), velY(numBody);
+	std::vector<unsigned int> mask(numBody);
+
+	CDTBodySoA bodies;
+	bodies.posX = &posX[0];
+	bodies.posY = &posY[0];
+	bodies.velX = &velX[0];
+	bodies.velY = &velY[0];
+	bodies.gravityMask = &mask[0];
+	bodies.count = numBody;
+
+	int prevKernel = cdt_kernel;
+	printf("Physics benchmark: %d bodies, %d iterations\n", numBody, numIteration);
+
+	for (int kernel = 0; kernel < CDT_KERNEL_MAX; kernel++) {
+		if (!PhysicsKernelSupported(kernel)) {
+			printf("  %-8s not supported\n", PhysicsKernelName(kernel));
+			continue;
+		}
+
+		// same start state for every kernel, half of the bodies are jumping
+		for (int i = 0; i < numBody; i++) {
+			posX[i] = (float)(i % 100);
+			posY[i] = (float)(i / 100);
+			velX[i] = (i & 1) ? 2.0f : -2.0f;
+			velY[i] = 0.0f;
+			mask[i] = (i & 2) ? 0xFFFFFFFFu : 0u;
+		}
+
+		PhysicsSetKernel(kernel);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int n = 0; n < numIteration; n++) {
+			IntegrateBodies(bodies, 1.0f / 60.0f, -37.0f);
+		}
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+		double us = std::chrono::duration<double, std::micro>(end - start).count();
+		double throughput = (double)numBody * numIteration / us;
+		printf("  %-8s %10.1f us  %8.1f entities/us  (check %f)\n", PhysicsKernelName(kernel), us, throughput, posY[numBody - 1]);
+	}
+
+	cdt_kernel = prevKernel;
+}
@@ -0,0 +1,49 @@
+
+#ifndef CDT_PHYSICS
+#define CDT_PHYSICS
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// -------------------------------------------
+// CDT physics integration
+//	- bodies are given as SoA arrays so the kernel can work on
+//	  4 (SSE2) or 8 (AVX2) bodies at a time
+//	- gravity is applied with a mask (0 or 0xFFFFFFFF per body)
+//	  instead of a branch on the jumping flag
+//	- the fastest kernel the CPU supports is picked in PhysicsInit
+// -------------------------------------------
+
+#define CDT_KERNEL_SCALAR			0
+#define CDT_KERNEL_SSE2				1
+#define CDT_KERNEL_AVX2				2
+#define CDT_KERNEL_MAX				3
+
+struct CDTBodySoA
+{
+	float*			posX;
+	float*			posY;
+	float*			velX;
+	float*			velY;
+	unsigned int*	gravityMask;			// 0xFFFFFFFF = apply gravity, 0 = don't
+	int				count;
+};
+
+// -------------------------------------------
+// Physics functions
+// -------------------------------------------
+
+void PhysicsInit();
+bool PhysicsKernelSupported(int kernel);
+void PhysicsSetKernel(int kernel);
+int  PhysicsGetKernel();
+const char* PhysicsKernelName(int kernel);
+
+// velY += gravity*dt (masked), pos += vel*dt
+void IntegrateBodies(const CDTBodySoA &bodies, float dt, float gravity);
+
+// time every supported kernel and print the throughput in entities per microsecond
+void PhysicsBenchmark(int numBody, int numIteration);
+
+
+#endif
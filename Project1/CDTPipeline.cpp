@@ -0,0 +1,181 @@
+
+#include "CDTPipeline.h"
+#include "CDTJobs.h"
+
+struct CDTPassJob
+{
+	CDTPipeline*			pipeline;
+	const CDTPipelinePass*	pass;
+	void*					ctx;
+};
+
+// -------------------------------------------
+// Internal functions
+// -------------------------------------------
+
+//+ Run a fused pass chunk by chunk
+//	- a run of entity stages is applied to an entity before moving to the next one
+//	- a range stage gets the whole chunk
+static void _runFusedRange(int begin, int end, void* data)
+{
+	CDTPassJob* job = (CDTPassJob*)data;
+	CDTPipeline& pipeline = *job->pipeline;
+	const CDTPipelineStage* stages = &pipeline.stages[job->pass->firstStage];
+	int numStage = job->pass->numStage;
+
+	for (int chunk = begin; chunk < end; chunk += CDT_PIPELINE_CHUNK) {
+		int chunkEnd = chunk + CDT_PIPELINE_CHUNK < end ? chunk + CDT_PIPELINE_CHUNK : end;
+
+		int s = 0;
+		while (s < numStage) {
+			if (stages[s].kind == CDT_STAGE_RANGE) {
+				stages[s].rangeFunc(chunk, chunkEnd, job->ctx);
+				s++;
+				continue;
+			}
+
+			int runEnd = s;
+			while (runEnd < numStage && stages[runEnd].kind == CDT_STAGE_ENTITY)
+				runEnd++;
+
+			char* entity = pipeline.entities + chunk * pipeline.stride;
+			for (int i = chunk; i < chunkEnd; i++, entity += pipeline.stride) {
+				for (int r = s; r < runEnd; r++) {
+
+					// a stage can destroy the entity, the next stages must skip it
+					if (!pipeline.isActive(entity))
+						break;
+
+					stages[r].entityFunc(entity, job->ctx);
+				}
+			}
+			s = runEnd;
+		}
+	}
+}
+
+// -------------------------------------------
+// Pipeline functions
+// -------------------------------------------
+
+void PipelineInit(CDTPipeline &pipeline, void* entities, int numEntity, size_t stride, CDTEntityActiveFunc isActive)
+{
+	pipeline.entities = (char*)entities;
+	pipeline.numEntity = numEntity;
+	pipeline.stride = stride;
+	pipeline.isActive = isActive;
+	pipeline.stages.clear();
+	pipeline.passes.clear();
+}
+
+void PipelineAddEntityStage(CDTPipeline &pipeline, const char* name, CDTEntityStageFunc func, bool parallel)
+{
+	CDTPipelineStage stage;
+	stage.name = name;
+	stage.kind = CDT_STAGE_ENTITY;
+	stage.parallel = parallel;
+	stage.entityFunc = func;
+	stage.rangeFunc = NULL;
+	stage.phaseFunc = NULL;
+
+	pipeline.stages.push_back(stage);
+	pipeline.passes.clear();
+}
+
+void PipelineAddRangeStage(CDTPipeline &pipeline, const char* name, CDTRangeStageFunc func, bool parallel)
+{
+	CDTPipelineStage stage;
+	stage.name = name;
+	stage.kind = CDT_STAGE_RANGE;
+	stage.parallel = parallel;
+	stage.entityFunc = NULL;
+	stage.rangeFunc = func;
+	stage.phaseFunc = NULL;
+
+	pipeline.stages.push_back(stage);
+	pipeline.passes.clear();
+}
+
+void PipelineAddPhaseStage(CDTPipeline &pipeline, const char* name, CDTPhaseStageFunc func)
+{
+	CDTPipelineStage stage;
+	stage.name = name;
+	stage.kind = CDT_STAGE_PHASE;
+	stage.parallel = false;
+	stage.entityFunc = NULL;
+	stage.rangeFunc = NULL;
+	stage.phaseFunc = func;
+
+	pipeline.stages.push_back(stage);
+	pipeline.passes.clear();
+}
+
+//+ Group the stages into passes
+//	- a run of entity/range stages with the same parallel setting become 1 fused pass
+//	- each phase stage is a pass by itself
+void PipelineCompile(CDTPipeline &pipeline)
+{
+	pipeline.passes.clear();
+
+	for (int i = 0; i < (int)pipeline.stages.size(); i++) {
+		const CDTPipelineStage& stage = pipeline.stages[i];
+
+		if (stage.kind != CDT_STAGE_PHASE && !pipeline.passes.empty() &&
+			pipeline.passes.back().kind == CDT_STAGE_ENTITY &&
+			pipeline.passes.back().parallel == stage.parallel) {
+			pipeline.passes.back().numStage++;
+			continue;
+		}
+
+		CDTPipelinePass pass;
+		pass.kind = stage.kind == CDT_STAGE_PHASE ? CDT_STAGE_PHASE : CDT_STAGE_ENTITY;
+		pass.parallel = stage.parallel;
+		pass.firstStage = i;
+		pass.numStage = 1;
+		pipeline.passes.push_back(pass);
+	}
+}
+
+void PipelineRun(CDTPipeline &pipeline, void* ctx)
+{
+	if (pipeline.passes.empty())
+		PipelineCompile(pipeline);
+
+	for (size_t p = 0; p < pipeline.passes.size(); p++) {
+		const CDTPipelinePass& pass = pipeline.passes[p];
+
+		if (pass.kind == CDT_STAGE_PHASE) {
+			pipeline.stages[pass.firstStage].phaseFunc(ctx);
+			continue;
+		}
+
+		CDTPassJob job;
+		job.pipeline = &pipeline;
+		job.pass = &pass;
+		job.ctx = ctx;
+
+		if (pass.parallel)
+			ParallelFor(pipeline.numEntity, CDT_PIPELINE_GRAIN, _runFusedRange, &job);
+		else
+			_runFusedRange(0, pipeline.numEntity, &job);
+	}
+}
+
+void PipelinePrint(const CDTPipeline &pipeline)
+{
+	for (size_t p = 0; p < pipeline.passes.size(); p++) {
+		const CDTPipelinePass& pass = pipeline.passes[p];
+
+		printf("Pass %d (%s):", (int)p, pass.kind == CDT_STAGE_PHASE ? "phase" : pass.parallel ? "fused, parallel" : "fused");
+		for (int s = 0; s < pass.numStage; s++) {
+			printf(" %s", pipeline.stages[pass.firstStage + s].name);
+		}
+		printf("\n");
+	}
+}
+
+void PipelineClear(CDTPipeline &pipeline)
+{
+	pipeline.stages.clear();
+	pipeline.passes.clear();
+}
@@ -0,0 +1,76 @@
+
+#ifndef CDT_PIPELINE
+#define CDT_PIPELINE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+// -------------------------------------------
+// CDT update pipeline
+//	- a game state declares its update as a list of stages
+//	- consecutive per-entity stages are fused into one pass, so each
+//	  entity is loaded once and runs all of them while it is in cache
+//	- phase stages (ex. collision between entities) break the fusion
+//	  and run once over the whole array
+//	- range stages are fused too, they get a chunk of entities at once
+//	  (ex. to gather them into SoA arrays for a SIMD kernel)
+//	- a fused pass made only of parallel stages is split in entity
+//	  ranges and run on every worker of the job system
+// -------------------------------------------
+
+#define CDT_STAGE_ENTITY			0				// only read/write the entity itself
+#define CDT_STAGE_PHASE				1				// need to see other entities
+#define CDT_STAGE_RANGE				2				// only read/write the entities [begin,end)
+#define CDT_PIPELINE_CHUNK			64				// #entity that go through a fused pass together
+#define CDT_PIPELINE_GRAIN			64				// #entity per job of a parallel pass
+
+typedef void(*CDTEntityStageFunc)(void* entity, void* ctx);
+typedef void(*CDTRangeStageFunc)(int begin, int end, void* ctx);
+typedef void(*CDTPhaseStageFunc)(void* ctx);
+typedef bool(*CDTEntityActiveFunc)(const void* entity);
+
+struct CDTPipelineStage
+{
+	const char*			name;
+	int					kind;				// CDT_STAGE_ENTITY, CDT_STAGE_RANGE or CDT_STAGE_PHASE
+	bool				parallel;			// safe to run on many entities at the same time
+	CDTEntityStageFunc	entityFunc;
+	CDTRangeStageFunc	rangeFunc;
+	CDTPhaseStageFunc	phaseFunc;
+};
+
+struct CDTPipelinePass
+{
+	int					kind;				// CDT_STAGE_ENTITY (fused) or CDT_STAGE_PHASE
+	bool				parallel;
+	int					firstStage;			// index into stages
+	int					numStage;
+};
+
+struct CDTPipeline
+{
+	char*				entities;			// first entity of the array
+	int					numEntity;
+	size_t				stride;				// sizeof(entity)
+	CDTEntityActiveFunc	isActive;			// inactive entities are skipped by every stage
+
+	std::vector<CDTPipelineStage>	stages;
+	std::vector<CDTPipelinePass>	passes;	// built by PipelineCompile
+};
+
+// -------------------------------------------
+// Pipeline functions
+// -------------------------------------------
+
+void PipelineInit(CDTPipeline &pipeline, void* entities, int numEntity, size_t stride, CDTEntityActiveFunc isActive);
+void PipelineAddEntityStage(CDTPipeline &pipeline, const char* name, CDTEntityStageFunc func, bool parallel = false);
+void PipelineAddRangeStage(CDTPipeline &pipeline, const char* name, CDTRangeStageFunc func, bool parallel = false);
+void PipelineAddPhaseStage(CDTPipeline &pipeline, const char* name, CDTPhaseStageFunc func);
+void PipelineCompile(CDTPipeline &pipeline);
+void PipelineRun(CDTPipeline &pipeline, void* ctx);
+void PipelinePrint(const CDTPipeline &pipeline);
+void PipelineClear(CDTPipeline &pipeline);
+
+
+#endif
@@ -0,0 +1,92 @@
+
+#include "CDTRaycast.h"
+#include <math.h>
+
+// -------------------------------------------
+// Raycast functions
+// -------------------------------------------
+
+//+ Step from tile to tile, always crossing the closest of the next vertical/horizontal edge
+//	- the ray is clipped to the grid first so rays from outside start at the border
+bool RaycastTiles(const CDTBitGrid &grid, float x, float y, float dirX, float dirY, float maxT, CDTRayHit &hit)
+{
+	hit.hit = false;
+	hit.t = maxT;
+	hit.normalX = 0.0f;
+	hit.normalY = 0.0f;
+
+	// clip the ray to the grid box
+	float tMin = 0.0f, tMax = maxT;
+	float origin[2] = { x, y }, dir[2] = { dirX, dirY }, size[2] = { (float)grid.width, (float)grid.height };
+	for (int axis = 0; axis < 2; axis++) {
+		if (dir[axis] == 0.0f) {
+			if (origin[axis] < 0.0f || origin[axis] >= size[axis])
+				return false;
+			continue;
+		}
+		float t0 = (0.0f - origin[axis]) / dir[axis], t1 = (size[axis] - origin[axis]) / dir[axis];
+		if (t0 > t1) { float tmp = t0; t0 = t1; t1 = tmp; }
+		if (t0 > tMin) tMin = t0;
+		if (t1 < tMax) tMax = t1;
+		if (tMin > tMax)
+			return false;
+	}
+
+	float startX = x + dirX * tMin, startY = y + dirY * tMin;
+	int cx = (int)floorf(startX), cy = (int)floorf(startY);
+	int stepX = dirX > 0.0f ? 1 : -1, stepY = dirY > 0.0f ? 1 : -1;
+
+	// on the border of the grid: go in if the ray points inside, else it only touch it
+	if (cx >= grid.width) { if (stepX > 0) return false; cx = grid.width - 1; }
+	if (cy >= grid.height) { if (stepY > 0) return false; cy = grid.height - 1; }
+	if (cx < 0) { if (stepX < 0) return false; cx = 0; }
+	if (cy < 0) { if (stepY < 0) return false; cy = 0; }
+	float tDeltaX = dirX != 0.0f ? fabsf(1.0f / dirX) : 1e30f;
+	float tDeltaY = dirY != 0.0f ? fabsf(1.0f / dirY) : 1e30f;
+	float tMaxX = dirX != 0.0f ? ((cx + (stepX > 0 ? 1 : 0)) - x) / dirX : 1e30f;
+	float tMaxY = dirY != 0.0f ? ((cy + (stepY > 0 ? 1 : 0)) - y) / dirY : 1e30f;
+	float t = tMin;
+
+	// the ray clipped in from a border enters by that border
+	float normalX = 0.0f, normalY = 0.0f;
+	if (tMin > 0.0f) {
+		if (dirX != 0.0f && fabsf(startX - (stepX > 0 ? 0.0f : size[0])) < 1e-4f) normalX = (float)-stepX;
+		else normalY = (float)-stepY;
+	}
+
+	for (;;) {
+		if (BitGridGet(grid, cx, cy)) {
+			hit.hit = true;
+			hit.t = t;
+			hit.tileX = cx;
+			hit.tileY = cy;
+			hit.normalX = normalX;
+			hit.normalY = normalY;
+			return true;
+		}
+
+		if (tMaxX < tMaxY) {
+			t = tMaxX;
+			tMaxX += tDeltaX;
+			cx += stepX;
+			normalX = (float)-stepX;
+			normalY = 0.0f;
+		}
+		else {
+			t = tMaxY;
+			tMaxY += tDeltaY;
+			cy += stepY;
+			normalX = 0.0f;
+			normalY = (float)-stepY;
+		}
+
+		if (t > tMax || cx < 0 || cx >= grid.width || cy < 0 || cy >= grid.height)
+			return false;
+	}
+}
+
+bool LineOfSight(const CDTBitGrid &grid, float x0, float y0, float x1, float y1)
+{
+	CDTRayHit hit;
+	return !RaycastTiles(grid, x0, y0, x1 - x0, y1 - y0, 1.0f, hit);
+}
@@ -0,0 +1,38 @@
+
+#ifndef CDT_RAYCAST
+#define CDT_RAYCAST
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "CDTBitGrid.h"
+
+// -------------------------------------------
+// CDT tile raycast
+//	- Amanatides-Woo traversal of the tiles of a CDTBitGrid (bit set =
+//	  solid), same space as CDTCollision: 1 tile = 1 unit, y up
+//	- the ray is (x,y) + t*(dirX,dirY), t in [0,maxT], so with dir =
+//	  target - origin and maxT = 1 it stops at the target
+//	- only reads the grid, can be called from any thread
+// -------------------------------------------
+
+struct CDTRayHit
+{
+	bool			hit;
+	float			t;						// ray parameter where the ray enters the tile
+	int				tileX;
+	int				tileY;
+	float			normalX;				// face the ray entered by, 0,0 if it starts in the tile
+	float			normalY;
+};
+
+// -------------------------------------------
+// Raycast functions
+// -------------------------------------------
+
+bool RaycastTiles(const CDTBitGrid &grid, float x, float y, float dirX, float dirY, float maxT, CDTRayHit &hit);
+
+// true if no solid tile is between the 2 points
+bool LineOfSight(const CDTBitGrid &grid, float x0, float y0, float x1, float y1);
+
+
+#endif
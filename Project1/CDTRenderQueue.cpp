@@ -0,0 +1,147 @@
+
+#include "CDTRenderQueue.h"
+#include <algorithm>
+
+#define CDT_DEPTH_MIN				-10.0f			// near/far of the ortho projection
+#define CDT_DEPTH_MAX				10.0f
+
+// -------------------------------------------
+// Internal functions
+// -------------------------------------------
+
+//+ Depth on 16 bits, 0 is the closest, for the front to back order
+static uint64_t _depthBits(float depth)
+{
+	float d = (CDT_DEPTH_MAX - depth) / (CDT_DEPTH_MAX - CDT_DEPTH_MIN);
+	if (d < 0.0f) d = 0.0f;
+	if (d > 1.0f) d = 1.0f;
+	return (uint64_t)(d * 65535.0f);
+}
+
+static bool _compareKey(const CDTDrawItem &a, const CDTDrawItem &b)
+{
+	return a.key < b.key;
+}
+
+static void _drawPass(CDTRenderQueue &queue, std::vector<CDTDrawItem> &items)
+{
+	int variant = -1;
+	CDTTex tex = 0;
+	bool bound = false;
+
+	for (size_t n = 0; n < items.size(); n++) {
+		const CDTDrawItem &item = items[n];
+
+		if (item.variant != variant) {
+			SetRenderVariant(item.variant, item.alpha);
+			variant = item.variant;
+			bound = false;
+			queue.numVariantChange++;
+		}
+		else {
+			SetAlpha(item.alpha);
+		}
+
+		// the offsets are uniforms of the program, set with the texture
+		if (!bound || item.tex != tex)
+			queue.numTextureChange++;
+		SetTexture(item.tex, item.offsetX, item.offsetY);
+		tex = item.tex;
+		bound = true;
+
+		SetTransform2D(item.model, item.depth);
+		DrawMesh(*item.mesh);
+		queue.numDraw++;
+	}
+
+	items.clear();
+}
+
+
+// -------------------------------------------
+// Render queue functions
+// -------------------------------------------
+
+void RenderQueueInit(CDTRenderQueue &queue)
+{
+	queue.opaque.clear();
+	queue.translucent.clear();
+	queue.numDraw = 0;
+	queue.numVariantChange = 0;
+	queue.numTextureChange = 0;
+}
+
+void RenderQueueAdd(CDTRenderQueue &queue, CDTMesh* mesh, CDTTex tex, float offsetX, float offsetY,
+	const CDTAffine2D &model, float depth, float alpha, int material)
+{
+	CDTDrawItem item;
+	item.mesh = mesh;
+	item.tex = tex;
+	item.offsetX = offsetX;
+	item.offsetY = offsetY;
+	item.model = model;
+	item.depth = depth;
+	item.alpha = alpha;
+
+	if (material == CDT_MATERIAL_TRANSLUCENT) {
+		// back to front, then in queued order (the sort is stable)
+		item.variant = CDT_SHADER_TEXTURED;
+		item.key = (uint64_t)0xFFFF - _depthBits(depth);
+		queue.translucent.push_back(item);
+	}
+	else {
+		// front to back, then by program and texture
+		item.variant = material == CDT_MATERIAL_ALPHA_TEST ? (CDT_SHADER_TEXTURED | CDT_SHADER_ALPHA_TEST) : CDT_SHADER_TEXTURED;
+		item.key = (_depthBits(depth) << 48) | ((uint64_t)item.variant << 32) | (uint64_t)tex;
+		queue.opaque.push_back(item);
+	}
+}
+
+void RenderQueueFlush(CDTRenderQueue &queue)
+{
+	queue.numDraw = 0;
+	queue.numVariantChange = 0;
+	queue.numTextureChange = 0;
+
+	std::stable_sort(queue.opaque.begin(), queue.opaque.end(), _compareKey);
+	std::stable_sort(queue.translucent.begin(), queue.translucent.end(), _compareKey);
+
+	glViewport(0, 0, GetWindowWidth(), GetWindowHeight());
+
+	// opaque, no blend read-modify-write, the depth test rejects what's behind
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
+	glDisable(GL_BLEND);
+	_drawPass(queue, queue.opaque);
+
+	// translucent, tested against the opaque depth but not written
+	glDepthMask(GL_FALSE);
+	glEnable(GL_BLEND);
+	_drawPass(queue, queue.translucent);
+
+	glDepthMask(GL_TRUE);
+	glDisable(GL_DEPTH_TEST);
+}
+
+int ImageMaterial(const CDTImage &image, float s0, float t0, float s1, float t1)
+{
+	if (image.pixels == NULL || image.channels != 4)
+		return CDT_MATERIAL_OPAQUE;
+
+	int x0 = std::max(0, (int)(s0 * image.width)), x1 = std::min(image.width, (int)(s1 * image.width));
+	int y0 = std::max(0, (int)(t0 * image.height)), y1 = std::min(image.height, (int)(t1 * image.height));
+	int material = CDT_MATERIAL_OPAQUE;
+
+	for (int y = y0; y < y1; y++) {
+		const unsigned char* row = image.pixels + ((size_t)y * image.width) * 4;
+		for (int x = x0; x < x1; x++) {
+			unsigned char a = row[x * 4 + 3];
+			if (a != 0 && a != 255)
+				return CDT_MATERIAL_TRANSLUCENT;
+			if (a == 0)
+				material = CDT_MATERIAL_ALPHA_TEST;
+		}
+	}
+	return material;
+}
@@ -0,0 +1,71 @@
+
+#ifndef CDT_RENDER_QUEUE
+#define CDT_RENDER_QUEUE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include "CDT.h"
+
+// -------------------------------------------
+// CDT render queue
+//	- the draws of a frame are queued with their material, then drawn in
+//	  2 passes by RenderQueueFlush:
+//		opaque & alpha tested	front to back, depth test and write on,
+//								blend off: hidden pixels are rejected by
+//								the depth test before the fragment shader
+//		translucent				back to front over them, depth test on,
+//								depth write off, blend on
+//	- depth is in map units toward the camera, the ortho projection sees
+//	  (-10,10), a bigger depth is drawn over a smaller one
+//	- in a pass the draws of the same depth are grouped by shader variant
+//	  and texture, the translucent ones keep their queued order
+//	- GL states are back to the CDTInit ones (blend on, depth off) after
+// -------------------------------------------
+
+#define CDT_MATERIAL_OPAQUE			0				// every pixel alpha 1
+#define CDT_MATERIAL_ALPHA_TEST		1				// pixels alpha 0 or 1
+#define CDT_MATERIAL_TRANSLUCENT	2				// blended
+
+struct CDTDrawItem
+{
+	uint64_t		key;					// sort key of the pass
+	CDTMesh*		mesh;
+	CDTTex			tex;
+	float			offsetX;
+	float			offsetY;
+	CDTAffine2D		model;
+	float			depth;
+	float			alpha;
+	int				variant;				// CDT_SHADER_ flags
+};
+
+struct CDTRenderQueue
+{
+	std::vector<CDTDrawItem>	opaque;		// opaque and alpha tested
+	std::vector<CDTDrawItem>	translucent;
+
+	// stats of the last flush
+	int				numDraw;
+	int				numVariantChange;
+	int				numTextureChange;
+};
+
+// -------------------------------------------
+// Render queue functions
+// -------------------------------------------
+
+void RenderQueueInit(CDTRenderQueue &queue);
+void RenderQueueAdd(CDTRenderQueue &queue, CDTMesh* mesh, CDTTex tex, float offsetX, float offsetY,
+	const CDTAffine2D &model, float depth, float alpha, int material);
+
+// draw the 2 passes and empty the queue, the depth buffer has to be cleared before
+void RenderQueueFlush(CDTRenderQueue &queue);
+
+// material of the pixels of a texture area, in texture coordinates [0,1]
+// (t = 0 is the first row of the image), CDT_MATERIAL_OPAQUE without alpha
+int ImageMaterial(const CDTImage &image, float s0, float t0, float s1, float t1);
+
+
+#endif
@@ -0,0 +1,405 @@
+
+#include "CDTResource.h"
+#include <string.h>
+
+static CDTResourceCache	cdt_res;
+
+static const char* cdt_restypename[CDT_RES_TYPE_COUNT] = { "texture", "mesh", "shader" };
+
+// -------------------------------------------
+// Internal functions
+// -------------------------------------------
+
+//+ Type, then the path with '/' and without case, like the pack names
+static std::string _key(int type, const char* path)
+{
+	std::string key(1, (char)('0' + type));
+	key += ':';
+	for (const char* c = path; *c; c++) {
+		if (*c == '\\')
+			key += '/';
+		else if (*c >= 'A' && *c <= 'Z')
+			key += (char)(*c - 'A' + 'a');
+		else
+			key += *c;
+	}
+	return key;
+}
+
+static uint64_t _hashKey(int type, uint64_t hash)
+{
+	return hash * 31 + (uint64_t)type;
+}
+
+//+ Add 1 reference, the item leaves the unused (LRU) set
+static void _acquire(int index)
+{
+	CDTResource &res = cdt_res.items[index];
+	if (res.refCount++ == 0 && res.lastRelease != 0) {
+		cdt_res.unusedBytes -= res.bytes;
+		res.lastRelease = 0;
+	}
+}
+
+//+ Same content as the item: same size and hash, then the same bytes if the item kept them
+static bool _sameContent(const CDTResource &res, size_t size, const void* content)
+{
+	if (res.contentSize != size)
+		return false;
+	if (content == NULL || size == 0)
+		return true;
+
+	switch (res.type) {
+	case CDT_RES_MESH:		return res.mesh.vertex.size() * sizeof(CDTVertex) == size && memcmp(&res.mesh.vertex[0], content, size) == 0;
+	case CDT_RES_SHADER:	return res.source.size() == size && memcmp(res.source.data(), content, size) == 0;
+	}
+	return true;
+}
+
+//+ Cached item of the key or of the content, -1 if none
+//	- content is NULL to look by key only, or to match by size and hash only
+//	- found by content, the key becomes a 2nd key of the item
+static int _lookup(int type, const std::string &key, uint64_t hash, size_t size, const void* content, bool byContent)
+{
+	std::unordered_map<std::string, int>::iterator k = cdt_res.byKey.find(key);
+	if (k != cdt_res.byKey.end()) {
+		cdt_res.numHit++;
+		_acquire(k->second);
+		return k->second;
+	}
+
+	if (!byContent)
+		return -1;
+
+	std::unordered_map<uint64_t, int>::iterator h = cdt_res.byHash.find(_hashKey(type, hash));
+	if (h != cdt_res.byHash.end() && _sameContent(cdt_res.items[h->second], size, content)) {
+		cdt_res.numDedup++;
+		cdt_res.byKey[key] = h->second;
+		_acquire(h->second);
+		return h->second;
+	}
+	return -1;
+}
+
+//+ New item with 1 reference, res is moved in
+static int _insert(const std::string &key, CDTResource &res)
+{
+	int index;
+	if (!cdt_res.freeItems.empty()) {
+		index = cdt_res.freeItems.back();
+		cdt_res.freeItems.pop_back();
+		cdt_res.items[index] = std::move(res);
+	}
+	else {
+		index = (int)cdt_res.items.size();
+		cdt_res.items.push_back(std::move(res));
+	}
+
+	CDTResource &item = cdt_res.items[index];
+	item.refCount = 1;
+	item.lastRelease = 0;
+	item.live = true;
+	cdt_res.byKey[key] = index;
+
+	// a colliding hash keeps its first item, the new one is only found by key
+	cdt_res.byHash.insert(std::make_pair(_hashKey(item.type, item.hash), index));
+	cdt_res.bytes[item.type] += item.bytes;
+	cdt_res.count[item.type]++;
+	cdt_res.numMiss++;
+	return index;
+}
+
+static void _initItem(CDTResource &res, int type, uint64_t hash, size_t bytes)
+{
+	res.type = type;
+	res.hash = hash;
+	res.contentSize = bytes;
+	res.refCount = 0;
+	res.bytes = bytes;
+	res.lastRelease = 0;
+	res.live = false;
+	res.tex = 0;
+	res.mesh.vaoHandle = 0;
+	res.mesh.vertexBuffer = 0;
+	res.program = 0;
+}
+
+//+ GL thread, delete the object and forget every key of the item
+static void _evict(int index)
+{
+	CDTResource &res = cdt_res.items[index];
+
+	switch (res.type) {
+	case CDT_RES_TEXTURE:	TextureUnload(res.tex); break;
+	case CDT_RES_MESH:		UnloadMesh(res.mesh); break;
+	case CDT_RES_SHADER:	glDeleteProgram(res.program); break;
+	}
+
+	for (std::unordered_map<std::string, int>::iterator k = cdt_res.byKey.begin(); k != cdt_res.byKey.end();) {
+		if (k->second == index)
+			k = cdt_res.byKey.erase(k);
+		else
+			++k;
+	}
+	std::unordered_map<uint64_t, int>::iterator h = cdt_res.byHash.find(_hashKey(res.type, res.hash));
+	if (h != cdt_res.byHash.end() && h->second == index)
+		cdt_res.byHash.erase(h);
+	res.source.clear();
+
+	if (res.refCount == 0 && res.lastRelease != 0)
+		cdt_res.unusedBytes -= res.bytes;
+	cdt_res.bytes[res.type] -= res.bytes;
+	cdt_res.count[res.type]--;
+	cdt_res.numEvict++;
+
+	res.live = false;
+	res.refCount = 0;
+	res.lastRelease = 0;
+	cdt_res.freeItems.push_back(index);
+}
+
+//+ Evict the least recently released items until the unused bytes fit the budget
+static void _trim()
+{
+	while (cdt_res.unusedBytes > cdt_res.budget) {
+		int oldest = -1;
+		for (int n = 0; n < (int)cdt_res.items.size(); n++) {
+			const CDTResource &res = cdt_res.items[n];
+			if (res.live && res.refCount == 0 && (oldest < 0 || res.lastRelease < cdt_res.items[oldest].lastRelease))
+				oldest = n;
+		}
+		if (oldest < 0)
+			break;
+		_evict(oldest);
+	}
+}
+
+//+ Remove 1 reference of the item of type whose object is id
+//	- a linear search, releases only happen when a state unloads
+static void _release(int type, uint64_t id)
+{
+	std::lock_guard<std::mutex> guard(cdt_res.lock);
+
+	for (int n = 0; n < (int)cdt_res.items.size(); n++) {
+		CDTResource &res = cdt_res.items[n];
+		if (!res.live || res.type != type)
+			continue;
+
+		uint64_t itemId = type == CDT_RES_TEXTURE ? (uint64_t)res.tex :
+			type == CDT_RES_MESH ? (uint64_t)res.mesh.vaoHandle :
+			(uint64_t)res.program;
+		if (itemId != id)
+			continue;
+
+		if (res.refCount <= 0) {
+			printf("Resource: %s released too many times\n", cdt_restypename[type]);
+			return;
+		}
+		if (--res.refCount == 0) {
+			res.lastRelease = ++cdt_res.clock;
+			cdt_res.unusedBytes += res.bytes;
+			_trim();
+		}
+		return;
+	}
+
+	printf("Resource: release of a %s that is not cached\n", cdt_restypename[type]);
+}
+
+
+// -------------------------------------------
+// Init & Shutdown
+// -------------------------------------------
+
+void ResourceInit(size_t budget)
+{
+	cdt_res.items.clear();
+	cdt_res.freeItems.clear();
+	cdt_res.byKey.clear();
+	cdt_res.byHash.clear();
+	cdt_res.budget = budget;
+	cdt_res.unusedBytes = 0;
+	cdt_res.clock = 0;
+	for (int t = 0; t < CDT_RES_TYPE_COUNT; t++) {
+		cdt_res.bytes[t] = 0;
+		cdt_res.count[t] = 0;
+	}
+	cdt_res.numHit = 0;
+	cdt_res.numDedup = 0;
+	cdt_res.numMiss = 0;
+	cdt_res.numEvict = 0;
+}
+
+void ResourceShutdown()
+{
+	std::lock_guard<std::mutex> guard(cdt_res.lock);
+
+	for (int n = 0; n < (int)cdt_res.items.size(); n++) {
+		if (!cdt_res.items[n].live)
+			continue;
+		if (cdt_res.items[n].refCount > 0)
+			printf("Resource: %s still referenced %d times at shutdown\n", cdt_restypename[cdt_res.items[n].type], cdt_res.items[n].refCount);
+		_evict(n);
+	}
+	cdt_res.items.clear();
+	cdt_res.freeItems.clear();
+}
+
+void ResourceSetBudget(size_t budget)
+{
+	std::lock_guard<std::mutex> guard(cdt_res.lock);
+	cdt_res.budget = budget;
+	_trim();
+}
+
+void ResourcePrint()
+{
+	std::lock_guard<std::mutex> guard(cdt_res.lock);
+
+	printf("Resources:");
+	for (int t = 0; t < CDT_RES_TYPE_COUNT; t++)
+		printf(" %d %s (%.2f MB)%s", cdt_res.count[t], cdt_restypename[t], cdt_res.bytes[t] / (1024.0 * 1024.0), t + 1 < CDT_RES_TYPE_COUNT ? "," : "\n");
+	printf("  %d hit, %d shared by content, %d loaded, %d evicted, unused %.2f / %.2f MB\n",
+		cdt_res.numHit, cdt_res.numDedup, cdt_res.numMiss, cdt_res.numEvict,
+		cdt_res.unusedBytes / (1024.0 * 1024.0), cdt_res.budget / (1024.0 * 1024.0));
+}
+
+uint64_t ResourceHash(const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t n = 0; n < size; n++) {
+		hash ^= bytes[n];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+// -------------------------------------------
+// Texture
+// -------------------------------------------
+
+bool ResourceFindTexture(const char* path, CDTTex &tex)
+{
+	std::lock_guard<std::mutex> guard(cdt_res.lock);
+
+	int index = _lookup(CDT_RES_TEXTURE, _key(CDT_RES_TEXTURE, path), 0, 0, NULL, false);
+	if (index < 0)
+		return false;
+
+	tex = cdt_res.items[index].tex;
+	return true;
+}
+
+CDTTex ResourceAddTexture(const char* path, uint64_t hash, CDTTex tex, size_t bytes)
+{
+	std::lock_guard<std::mutex> guard(cdt_res.lock);
+
+	// added by another loader meanwhile, or the same pixels under another path
+	std::string key = _key(CDT_RES_TEXTURE, path);
+	int index = _lookup(CDT_RES_TEXTURE, key, hash, bytes, NULL, true);
+	if (index >= 0) {
+		TextureUnload(tex);
+		return cdt_res.items[index].tex;
+	}
+
+	CDTResource res;
+	_initItem(res, CDT_RES_TEXTURE, hash, bytes);
+	res.tex = tex;
+	return cdt_res.items[_insert(key, res)].tex;
+}
+
+CDTTex ResourceLoadTexture(const char* path)
+{
+	CDTTex tex;
+	if (ResourceFindTexture(path, tex))
+		return tex;
+
+	CDTImage image;
+	TextureDecode(image, path);
+	size_t bytes = (size_t)image.width * image.height * image.channels;
+
+	// a failed decode is only shared by path
+	uint64_t hash = image.pixels ? ResourceHash(image.pixels, bytes) ^ ((uint64_t)image.width << 32 | (uint64_t)image.height) : ResourceHash(path, strlen(path));
+
+	TextureUploadBatch(&image, &tex, 1);
+	return ResourceAddTexture(path, hash, tex, bytes);
+}
+
+void ResourceReleaseTexture(CDTTex tex)
+{
+	_release(CDT_RES_TEXTURE, (uint64_t)tex);
+}
+
+// -------------------------------------------
+// Mesh, shader
+// -------------------------------------------
+
+CDTMesh ResourceLoadMesh(const char* name, const std::vector<CDTVertex> &vertices)
+{
+	std::string key = _key(CDT_RES_MESH, name);
+	size_t size = vertices.size() * sizeof(CDTVertex);
+	uint64_t hash = vertices.empty() ? 0 : ResourceHash(&vertices[0], size);
+
+	{
+		std::lock_guard<std::mutex> guard(cdt_res.lock);
+		int index = _lookup(CDT_RES_MESH, key, hash, size, vertices.empty() ? NULL : &vertices[0], true);
+		if (index >= 0)
+			return cdt_res.items[index].mesh;
+	}
+
+	CDTResource res;
+	_initItem(res, CDT_RES_MESH, hash, size);
+	res.mesh = CreateMesh(vertices);
+
+	std::lock_guard<std::mutex> guard(cdt_res.lock);
+	return cdt_res.items[_insert(key, res)].mesh;
+}
+
+void ResourceReleaseMesh(const CDTMesh &mesh)
+{
+	_release(CDT_RES_MESH, (uint64_t)mesh.vaoHandle);
+}
+
+GLuint ResourceLoadShader(const char* vertexPath, const char* fragmentPath, const char* defines)
+{
+	std::string name = std::string(vertexPath) + "|" + fragmentPath + "|" + (defines ? defines : "");
+	std::string key = _key(CDT_RES_SHADER, name.c_str());
+
+	// the content is the 2 sources and the defines, '\0' separated
+	CDTAsset vertex, fragment;
+	AssetOpen(vertex, vertexPath);
+	AssetOpen(fragment, fragmentPath);
+	std::string source;
+	if (vertex.data)
+		source.append((const char*)vertex.data, vertex.size);
+	source += '\0';
+	if (fragment.data)
+		source.append((const char*)fragment.data, fragment.size);
+	source += '\0';
+	if (defines)
+		source += defines;
+	AssetClose(vertex);
+	AssetClose(fragment);
+	uint64_t hash = ResourceHash(source.data(), source.size());
+
+	{
+		std::lock_guard<std::mutex> guard(cdt_res.lock);
+		int index = _lookup(CDT_RES_SHADER, key, hash, source.size(), source.data(), true);
+		if (index >= 0)
+			return cdt_res.items[index].program;
+	}
+
+	CDTResource res;
+	_initItem(res, CDT_RES_SHADER, hash, source.size());
+	res.source.swap(source);
+	res.program = LoadShaders(vertexPath, fragmentPath, defines);
+
+	std::lock_guard<std::mutex> guard(cdt_res.lock);
+	return cdt_res.items[_insert(key, res)].program;
+}
+
+void ResourceReleaseShader(GLuint program)
+{
+	_release(CDT_RES_SHADER, (uint64_t)program);
+}
@@ -0,0 +1,114 @@
+
+#ifndef CDT_RESOURCE
+#define CDT_RESOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include "CDT.h"
+
+// -------------------------------------------
+// CDT resource cache
+//	- textures, meshes and shader programs shared by every
+//	  game state, keyed by path (mesh: its name, shader: "vert|frag|defines")
+//	- a resource with the same content as a cached one is the cached one,
+//	  under a 2nd key: same size and hash of the pixels, vertices or
+//	  sources, then the same bytes for the meshes and shaders (the cache
+//	  doesn't keep the pixels, textures are only matched by size and hash)
+//	- each Load adds a reference, each Release removes one, a resource
+//	  with no reference stays cached (a state loaded again finds it)
+//	  until the unreferenced bytes go over the budget, the least
+//	  recently released are evicted first
+//	- lookups are thread safe (the load graph decodes on the workers),
+//	  GL objects are only created and deleted on the GL thread: the mesh,
+//	  shader and texture Load, AddTexture (it deletes a duplicate),
+//	  Release and Shutdown are GL thread only
+// -------------------------------------------
+
+#define CDT_RES_TEXTURE				0
+#define CDT_RES_MESH				1
+#define CDT_RES_SHADER				2
+#define CDT_RES_TYPE_COUNT			3
+
+#define CDT_RES_DEFAULT_BUDGET		(64 * 1024 * 1024)	// unreferenced bytes kept
+
+struct CDTResource
+{
+	int					type;				// CDT_RES_
+	uint64_t			hash;				// of the content
+	size_t				contentSize;		// bytes hashed
+	int					refCount;
+	size_t				bytes;				// estimated memory, GPU or CPU
+	uint64_t			lastRelease;		// for the LRU, 0 while referenced
+	bool				live;				// false once evicted, the slot is reused
+
+	CDTTex				tex;
+	CDTMesh				mesh;
+	GLuint				program;
+	std::string			source;				// of the shader, compared on a hash match
+};
+
+struct CDTResourceCache
+{
+	std::deque<CDTResource>					items;
+	std::vector<int>						freeItems;
+	std::unordered_map<std::string, int>	byKey;			// normalized path -> item
+	std::unordered_map<uint64_t, int>		byHash;			// content hash (+ type) -> item
+	std::mutex								lock;
+
+	size_t				budget;
+	size_t				unusedBytes;		// bytes of the items without reference
+	uint64_t			clock;
+
+	// stats
+	size_t				bytes[CDT_RES_TYPE_COUNT];
+	int					count[CDT_RES_TYPE_COUNT];
+	int					numHit;
+	int					numDedup;			// found by content under another key
+	int					numMiss;
+	int					numEvict;
+};
+
+// -------------------------------------------
+// Init & Shutdown
+// -------------------------------------------
+
+void ResourceInit(size_t budget);
+void ResourceShutdown();					// evicts everything, reports what is still referenced
+void ResourceSetBudget(size_t budget);
+void ResourcePrint();						// memory and count per type, hit/miss
+
+// FNV-1a 64 of the bytes, the content hash
+uint64_t ResourceHash(const void* data, size_t size);
+
+// -------------------------------------------
+// Texture
+//	- Find only adds a reference if the path is cached, so a loader can
+//	  skip the decode, Add then takes the texture made by the loader
+//	  (deleted if the same pixels are already cached, the cached one is
+//	  returned), bytes is the size of the hashed pixels
+//	- Add is GL thread only
+// -------------------------------------------
+
+bool   ResourceFindTexture(const char* path, CDTTex &tex);
+CDTTex ResourceAddTexture(const char* path, uint64_t hash, CDTTex tex, size_t bytes);
+CDTTex ResourceLoadTexture(const char* path);		// Find, or decode, upload and Add
+void   ResourceReleaseTexture(CDTTex tex);
+
+// -------------------------------------------
+// Mesh, shader
+// -------------------------------------------
+
+CDTMesh ResourceLoadMesh(const char* name, const std::vector<CDTVertex> &vertices);
+void    ResourceReleaseMesh(const CDTMesh &mesh);
+
+GLuint  ResourceLoadShader(const char* vertexPath, const char* fragmentPath, const char* defines = NULL);
+void    ResourceReleaseShader(GLuint program);
+
+
+#endif
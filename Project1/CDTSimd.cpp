@@ -0,0 +1,45 @@
+
+#include "CDTSimd.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// -------------------------------------------
+// CPU feature detection
+// -------------------------------------------
+
+bool CpuHasSSE2()
+{
+#if !defined(CDT_SIMD_X86)
+	return false;
+#elif defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	return (info[3] & (1 << 26)) != 0;
+#else
+	return __builtin_cpu_supports("sse2");
+#endif
+}
+
+bool CpuHasAVX2()
+{
+#if !defined(CDT_SIMD_X86)
+	return false;
+#elif defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+
+	// the OS must save the ymm registers (OSXSAVE + xgetbv)
+	__cpuid(info, 1);
+	if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6)
+		return false;
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
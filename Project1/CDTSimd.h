@@ -0,0 +1,28 @@
+
+#ifndef CDT_SIMD
+#define CDT_SIMD
+
+// -------------------------------------------
+// CDT SIMD helpers
+//	- CDT_SIMD_X86 is defined when SSE/AVX intrinsics can be used
+//	- AVX2 code must be put in functions marked CDT_TARGET_AVX2 and
+//	  only called when CpuHasAVX2() is true
+// -------------------------------------------
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define CDT_SIMD_X86				1
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#define CDT_TARGET_AVX2
+#else
+#define CDT_TARGET_AVX2				__attribute__((target("avx2")))
+#endif
+
+bool CpuHasSSE2();
+bool CpuHasAVX2();
+
+
+#endif
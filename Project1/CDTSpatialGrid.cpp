@@ -0,0 +1,274 @@
+
+#include "CDTSpatialGrid.h"
+#include <math.h>
+#include <algorithm>
+
+// -------------------------------------------
+// Internal functions
+// -------------------------------------------
+
+static int _cellCoor(float v, float cellSize, int numCell)
+{
+	int c = (int)floorf(v / cellSize);
+	if (c < 0) return 0;
+	if (c >= numCell) return numCell - 1;
+	return c;
+}
+
+static void _unlink(CDTSpatialGrid &grid, int id)
+{
+	int c = grid.cell[id];
+	if (c < 0)
+		return;
+
+	if (grid.prev[id] >= 0)
+		grid.next[grid.prev[id]] = grid.next[id];
+	else
+		grid.cellHead[c] = grid.next[id];
+
+	if (grid.next[id] >= 0)
+		grid.prev[grid.next[id]] = grid.prev[id];
+
+	grid.cell[id] = -1;
+}
+
+static bool _boxOverlap(const CDTSpatialGrid &grid, int id, float x, float y, float halfW, float halfH)
+{
+	return fabsf(grid.posX[id] - x) < grid.halfW[id] + halfW &&
+		fabsf(grid.posY[id] - y) < grid.halfH[id] + halfH;
+}
+
+//+ Slab test of the ray against the box of the entity, return false if missed
+static bool _rayBox(const CDTSpatialGrid &grid, int id, float x, float y, float dirX, float dirY, float maxT, float &t)
+{
+	float tMin = 0.0f, tMax = maxT;
+	float origin[2] = { x, y }, dir[2] = { dirX, dirY };
+	float center[2] = { grid.posX[id], grid.posY[id] }, half[2] = { grid.halfW[id], grid.halfH[id] };
+
+	for (int axis = 0; axis < 2; axis++) {
+		float lo = center[axis] - half[axis], hi = center[axis] + half[axis];
+
+		if (dir[axis] == 0.0f) {
+			if (origin[axis] < lo || origin[axis] > hi)
+				return false;
+			continue;
+		}
+
+		float t0 = (lo - origin[axis]) / dir[axis];
+		float t1 = (hi - origin[axis]) / dir[axis];
+		if (t0 > t1) { float tmp = t0; t0 = t1; t1 = tmp; }
+		if (t0 > tMin) tMin = t0;
+		if (t1 < tMax) tMax = t1;
+		if (tMin > tMax)
+			return false;
+	}
+
+	t = tMin;
+	return true;
+}
+
+static bool _compareHit(const CDTGridHit &a, const CDTGridHit &b)
+{
+	return a.t < b.t;
+}
+
+
+// -------------------------------------------
+// Grid functions
+// -------------------------------------------
+
+void GridInit(CDTSpatialGrid &grid, float worldWidth, float worldHeight, float cellSize, int maxEntity)
+{
+	grid.cellSize = cellSize;
+	grid.width = (int)ceilf(worldWidth / cellSize);
+	grid.height = (int)ceilf(worldHeight / cellSize);
+	if (grid.width < 1) grid.width = 1;
+	if (grid.height < 1) grid.height = 1;
+	grid.maxHalfW = 0.0f;
+	grid.maxHalfH = 0.0f;
+
+	grid.cellHead.assign(grid.width * grid.height, -1);
+	grid.next.assign(maxEntity, -1);
+	grid.prev.assign(maxEntity, -1);
+	grid.cell.assign(maxEntity, -1);
+	grid.posX.assign(maxEntity, 0.0f);
+	grid.posY.assign(maxEntity, 0.0f);
+	grid.halfW.assign(maxEntity, 0.0f);
+	grid.halfH.assign(maxEntity, 0.0f);
+	grid.stamp.assign(maxEntity, 0);
+	grid.queryStamp = 0;
+}
+
+void GridFree(CDTSpatialGrid &grid)
+{
+	grid.cellHead.clear();
+	grid.next.clear();
+	grid.prev.clear();
+	grid.cell.clear();
+	grid.posX.clear();
+	grid.posY.clear();
+	grid.halfW.clear();
+	grid.halfH.clear();
+	grid.stamp.clear();
+}
+
+//+ Insert the entity, or move it if it is already in the grid
+void GridUpdate(CDTSpatialGrid &grid, int id, float x, float y, float halfW, float halfH)
+{
+	grid.posX[id] = x;
+	grid.posY[id] = y;
+	grid.halfW[id] = fabsf(halfW);
+	grid.halfH[id] = fabsf(halfH);
+	if (grid.halfW[id] > grid.maxHalfW) grid.maxHalfW = grid.halfW[id];
+	if (grid.halfH[id] > grid.maxHalfH) grid.maxHalfH = grid.halfH[id];
+
+	int c = _cellCoor(y, grid.cellSize, grid.height) * grid.width + _cellCoor(x, grid.cellSize, grid.width);
+
+	// still in the same cell, nothing to relink
+	if (grid.cell[id] == c)
+		return;
+
+	_unlink(grid, id);
+
+	grid.cell[id] = c;
+	grid.prev[id] = -1;
+	grid.next[id] = grid.cellHead[c];
+	if (grid.cellHead[c] >= 0)
+		grid.prev[grid.cellHead[c]] = id;
+	grid.cellHead[c] = id;
+}
+
+void GridRemove(CDTSpatialGrid &grid, int id)
+{
+	if (id < 0 || id >= (int)grid.cell.size())
+		return;
+
+	_unlink(grid, id);
+}
+
+bool GridContains(const CDTSpatialGrid &grid, int id)
+{
+	return grid.cell[id] >= 0;
+}
+
+void GridQueryCandidates(const CDTSpatialGrid &grid, float x, float y, float halfW, float halfH, std::vector<int> &out)
+{
+	int minX = _cellCoor(x - halfW - grid.maxHalfW, grid.cellSize, grid.width);
+	int maxX = _cellCoor(x + halfW + grid.maxHalfW, grid.cellSize, grid.width);
+	int minY = _cellCoor(y - halfH - grid.maxHalfH, grid.cellSize, grid.height);
+	int maxY = _cellCoor(y + halfH + grid.maxHalfH, grid.cellSize, grid.height);
+
+	for (int cy = minY; cy <= maxY; cy++) {
+		for (int cx = minX; cx <= maxX; cx++) {
+			for (int id = grid.cellHead[cy * grid.width + cx]; id >= 0; id = grid.next[id])
+				out.push_back(id);
+		}
+	}
+}
+
+void GridQueryAABB(const CDTSpatialGrid &grid, float x, float y, float halfW, float halfH, std::vector<int> &out)
+{
+	// an entity is linked by its center, so look as far as the biggest entity can reach
+	int minX = _cellCoor(x - halfW - grid.maxHalfW, grid.cellSize, grid.width);
+	int maxX = _cellCoor(x + halfW + grid.maxHalfW, grid.cellSize, grid.width);
+	int minY = _cellCoor(y - halfH - grid.maxHalfH, grid.cellSize, grid.height);
+	int maxY = _cellCoor(y + halfH + grid.maxHalfH, grid.cellSize, grid.height);
+
+	for (int cy = minY; cy <= maxY; cy++) {
+		for (int cx = minX; cx <= maxX; cx++) {
+			for (int id = grid.cellHead[cy * grid.width + cx]; id >= 0; id = grid.next[id]) {
+				if (_boxOverlap(grid, id, x, y, halfW, halfH))
+					out.push_back(id);
+			}
+		}
+	}
+}
+
+void GridQueryRadius(const CDTSpatialGrid &grid, float x, float y, float radius, std::vector<int> &out)
+{
+	int minX = _cellCoor(x - radius - grid.maxHalfW, grid.cellSize, grid.width);
+	int maxX = _cellCoor(x + radius + grid.maxHalfW, grid.cellSize, grid.width);
+	int minY = _cellCoor(y - radius - grid.maxHalfH, grid.cellSize, grid.height);
+	int maxY = _cellCoor(y + radius + grid.maxHalfH, grid.cellSize, grid.height);
+
+	for (int cy = minY; cy <= maxY; cy++) {
+		for (int cx = minX; cx <= maxX; cx++) {
+			for (int id = grid.cellHead[cy * grid.width + cx]; id >= 0; id = grid.next[id]) {
+
+				// distance from the circle center to the closest point of the box
+				float dx = fabsf(grid.posX[id] - x) - grid.halfW[id];
+				float dy = fabsf(grid.posY[id] - y) - grid.halfH[id];
+				if (dx < 0.0f) dx = 0.0f;
+				if (dy < 0.0f) dy = 0.0f;
+
+				if (dx * dx + dy * dy <= radius * radius)
+					out.push_back(id);
+			}
+		}
+	}
+}
+
+//+ Walk the cells along the ray (DDA) and test the entities around each cell
+//	- hits are sorted from the closest one
+void GridQueryRay(CDTSpatialGrid &grid, float x, float y, float dirX, float dirY, float maxT, std::vector<CDTGridHit> &out)
+{
+	size_t firstHit = out.size();
+	float size = grid.cellSize;
+
+	if (++grid.queryStamp == 0) {
+		std::fill(grid.stamp.begin(), grid.stamp.end(), 0u);
+		grid.queryStamp = 1;
+	}
+
+	int reachX = (int)ceilf(grid.maxHalfW / size);
+	int reachY = (int)ceilf(grid.maxHalfH / size);
+
+	int cx = (int)floorf(x / size), cy = (int)floorf(y / size);
+	int stepX = dirX > 0.0f ? 1 : -1, stepY = dirY > 0.0f ? 1 : -1;
+	float tDeltaX = dirX != 0.0f ? fabsf(size / dirX) : 1e30f;
+	float tDeltaY = dirY != 0.0f ? fabsf(size / dirY) : 1e30f;
+	float tMaxX = dirX != 0.0f ? ((cx + (stepX > 0 ? 1 : 0)) * size - x) / dirX : 1e30f;
+	float tMaxY = dirY != 0.0f ? ((cy + (stepY > 0 ? 1 : 0)) * size - y) / dirY : 1e30f;
+	float t = 0.0f;
+
+	while (t <= maxT) {
+		for (int ny = cy - reachY; ny <= cy + reachY; ny++) {
+			if (ny < 0 || ny >= grid.height) continue;
+
+			for (int nx = cx - reachX; nx <= cx + reachX; nx++) {
+				if (nx < 0 || nx >= grid.width) continue;
+
+				for (int id = grid.cellHead[ny * grid.width + nx]; id >= 0; id = grid.next[id]) {
+					if (grid.stamp[id] == grid.queryStamp)
+						continue;
+					grid.stamp[id] = grid.queryStamp;
+
+					CDTGridHit hit;
+					if (_rayBox(grid, id, x, y, dirX, dirY, maxT, hit.t)) {
+						hit.id = id;
+						out.push_back(hit);
+					}
+				}
+			}
+		}
+
+		// step to the next cell
+		if (tMaxX < tMaxY) {
+			cx += stepX;
+			t = tMaxX;
+			tMaxX += tDeltaX;
+		}
+		else {
+			cy += stepY;
+			t = tMaxY;
+			tMaxY += tDeltaY;
+		}
+
+		// left the grid for good
+		if ((cx < -reachX && stepX < 0) || (cx >= grid.width + reachX && stepX > 0) ||
+			(cy < -reachY && stepY < 0) || (cy >= grid.height + reachY && stepY > 0))
+			break;
+	}
+
+	std::sort(out.begin() + firstHit, out.end(), _compareHit);
+}
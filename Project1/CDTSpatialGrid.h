@@ -0,0 +1,62 @@
+
+#ifndef CDT_SPATIAL_GRID
+#define CDT_SPATIAL_GRID
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+// -------------------------------------------
+// CDT spatial grid (broadphase)
+//	- uniform grid over the map, 1 cell = cellSize map units
+//	- an entity is linked in the cell of its center, GridUpdate only
+//	  relinks it when it moved to another cell
+//	- queries look at the cells around the area, expanded by the
+//	  biggest half size ever inserted, then test the entity boxes
+//	- not thread safe, update and query from 1 thread at a time
+// -------------------------------------------
+
+struct CDTGridHit
+{
+	int				id;
+	float			t;						// ray parameter of the hit, 0 for AABB/radius query
+};
+
+struct CDTSpatialGrid
+{
+	float			cellSize;
+	int				width;					// #cell in x
+	int				height;					// #cell in y
+	float			maxHalfW;				// biggest half size ever inserted
+	float			maxHalfH;
+
+	std::vector<int>		cellHead;		// first entity in the cell, -1 if empty
+	std::vector<int>		next;			// linked list of entities in the same cell
+	std::vector<int>		prev;
+	std::vector<int>		cell;			// cell of the entity, -1 if not in the grid
+	std::vector<float>		posX, posY;		// box of the entity
+	std::vector<float>		halfW, halfH;
+	std::vector<unsigned int> stamp;		// to report an entity once per ray query
+	unsigned int			queryStamp;
+};
+
+// -------------------------------------------
+// Grid functions
+// -------------------------------------------
+
+void GridInit(CDTSpatialGrid &grid, float worldWidth, float worldHeight, float cellSize, int maxEntity);
+void GridFree(CDTSpatialGrid &grid);
+void GridUpdate(CDTSpatialGrid &grid, int id, float x, float y, float halfW, float halfH);
+void GridRemove(CDTSpatialGrid &grid, int id);
+bool GridContains(const CDTSpatialGrid &grid, int id);
+
+// the results are appended to out
+//	- Candidates only gathers the entities of the cells the box can reach,
+//	  the boxes are not tested (to be done in batch by the caller)
+void GridQueryCandidates(const CDTSpatialGrid &grid, float x, float y, float halfW, float halfH, std::vector<int> &out);
+void GridQueryAABB(const CDTSpatialGrid &grid, float x, float y, float halfW, float halfH, std::vector<int> &out);
+void GridQueryRadius(const CDTSpatialGrid &grid, float x, float y, float radius, std::vector<int> &out);
+void GridQueryRay(CDTSpatialGrid &grid, float x, float y, float dirX, float dirY, float maxT, std::vector<CDTGridHit> &out);
+
+
+#endif
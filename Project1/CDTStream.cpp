@@ -0,0 +1,256 @@
+
+#include "CDTStream.h"
+#include <algorithm>
+
+// -------------------------------------------
+// Internal functions
+// -------------------------------------------
+
+static void _streamThread(CDTWorldStream* stream)
+{
+	std::unique_lock<std::mutex> guard(stream->lock);
+
+	for (;;) {
+		stream->wake.wait(guard, [stream] { return stream->quit || !stream->requests.empty(); });
+		if (stream->quit)
+			return;
+
+		int index = stream->requests.front();
+		stream->requests.pop_front();
+		unsigned char* data = stream->chunks[index].data;
+
+		// load without the lock, the main thread doesn't touch a loading chunk
+		guard.unlock();
+		stream->load(index % stream->numChunkX, index / stream->numChunkX, data, stream->user);
+		guard.lock();
+
+		stream->done.push_back(index);
+		stream->numPending--;
+		stream->idle.notify_all();
+	}
+}
+
+static int _chunkDistance(const CDTWorldStream &stream, int index, int fx, int fy)
+{
+	int dx = abs(index % stream.numChunkX - fx);
+	int dy = abs(index / stream.numChunkX - fy);
+	return dx > dy ? dx : dy;
+}
+
+static void _evict(CDTWorldStream &stream, int index, bool notify)
+{
+	CDTChunk &chunk = stream.chunks[index];
+	if (notify && stream.onEvict)
+		stream.onEvict(index % stream.numChunkX, index / stream.numChunkX, chunk.data, stream.user);
+
+	stream.freeData.push_back(chunk.data);
+	chunk.data = NULL;
+	chunk.state = CDT_CHUNK_UNLOADED;
+	stream.live.erase(std::find(stream.live.begin(), stream.live.end(), index));
+}
+
+//+ Make the chunks loaded by the thread resident
+static void _collectDone(CDTWorldStream &stream)
+{
+	std::vector<int> done;
+	{
+		std::lock_guard<std::mutex> guard(stream.lock);
+		done.swap(stream.done);
+	}
+
+	for (size_t n = 0; n < done.size(); n++) {
+		CDTChunk &chunk = stream.chunks[done[n]];
+		chunk.state = CDT_CHUNK_RESIDENT;
+		if (stream.onResident)
+			stream.onResident(done[n] % stream.numChunkX, done[n] / stream.numChunkX, chunk.data, stream.user);
+	}
+}
+
+//+ Free a slot for a new chunk, evict the least recently wanted resident chunk outside of the radius
+static bool _makeRoom(CDTWorldStream &stream, int fx, int fy)
+{
+	if ((int)stream.live.size() < stream.budget)
+		return true;
+
+	int victim = -1;
+	for (size_t n = 0; n < stream.live.size(); n++) {
+		int index = stream.live[n];
+		const CDTChunk &chunk = stream.chunks[index];
+		if (chunk.state != CDT_CHUNK_RESIDENT || _chunkDistance(stream, index, fx, fy) <= stream.radius)
+			continue;
+		if (victim < 0 || chunk.lastWanted < stream.chunks[victim].lastWanted)
+			victim = index;
+	}
+
+	if (victim < 0)
+		return false;
+
+	_evict(stream, victim, true);
+	return true;
+}
+
+
+// -------------------------------------------
+// Stream functions
+// -------------------------------------------
+
+void StreamInit(CDTWorldStream &stream, int worldWidth, int worldHeight, int chunkSize, int radius, int budget, size_t chunkBytes,
+	CDTChunkLoadFunc load, CDTChunkEventFunc onResident, CDTChunkEventFunc onEvict, void* user)
+{
+	stream.chunkSize = chunkSize;
+	stream.numChunkX = (worldWidth + chunkSize - 1) / chunkSize;
+	stream.numChunkY = (worldHeight + chunkSize - 1) / chunkSize;
+	if (stream.numChunkX < 1) stream.numChunkX = 1;
+	if (stream.numChunkY < 1) stream.numChunkY = 1;
+	stream.radius = radius;
+	stream.budget = budget;
+	stream.chunkBytes = chunkBytes;
+	stream.load = load;
+	stream.onResident = onResident;
+	stream.onEvict = onEvict;
+	stream.user = user;
+
+	CDTChunk empty = { CDT_CHUNK_UNLOADED, NULL, 0 };
+	stream.chunks.assign(stream.numChunkX * stream.numChunkY, empty);
+	stream.live.clear();
+	stream.freeData.clear();
+	stream.updateCount = 0;
+
+	stream.requests.clear();
+	stream.done.clear();
+	stream.numPending = 0;
+	stream.quit = false;
+	stream.thread = std::thread(_streamThread, &stream);
+}
+
+void StreamShutdown(CDTWorldStream &stream)
+{
+	{
+		std::lock_guard<std::mutex> guard(stream.lock);
+		stream.quit = true;
+	}
+	stream.wake.notify_all();
+	if (stream.thread.joinable())
+		stream.thread.join();
+
+	for (size_t n = 0; n < stream.chunks.size(); n++)
+		delete[] stream.chunks[n].data;
+	for (size_t n = 0; n < stream.freeData.size(); n++)
+		delete[] stream.freeData[n];
+
+	stream.chunks.clear();
+	stream.live.clear();
+	stream.freeData.clear();
+	stream.requests.clear();
+	stream.done.clear();
+}
+
+void StreamUpdate(CDTWorldStream &stream, float focusX, float focusY)
+{
+	stream.updateCount++;
+	_collectDone(stream);
+
+	int fx = (int)(focusX / stream.chunkSize), fy = (int)(focusY / stream.chunkSize);
+	fx = std::max(0, std::min(fx, stream.numChunkX - 1));
+	fy = std::max(0, std::min(fy, stream.numChunkY - 1));
+
+	// evict what is out of the radius, with 1 chunk of margin so walking
+	// along a chunk border doesn't load/evict the same chunk every frame
+	for (size_t n = stream.live.size(); n-- > 0;) {
+		int index = stream.live[n];
+		if (stream.chunks[index].state == CDT_CHUNK_RESIDENT && _chunkDistance(stream, index, fx, fy) > stream.radius + 1)
+			_evict(stream, index, true);
+	}
+
+	// request the missing chunks ring by ring, nearest first
+	std::vector<int> request;
+	for (int ring = 0; ring <= stream.radius; ring++) {
+		for (int cy = fy - ring; cy <= fy + ring; cy++) {
+			if (cy < 0 || cy >= stream.numChunkY) continue;
+
+			for (int cx = fx - ring; cx <= fx + ring; cx++) {
+				if (cx < 0 || cx >= stream.numChunkX) continue;
+				if (abs(cx - fx) != ring && abs(cy - fy) != ring) continue;
+
+				int index = cy * stream.numChunkX + cx;
+				CDTChunk &chunk = stream.chunks[index];
+				chunk.lastWanted = stream.updateCount;
+				if (chunk.state != CDT_CHUNK_UNLOADED)
+					continue;
+				if (!_makeRoom(stream, fx, fy))
+					continue;
+
+				if (!stream.freeData.empty()) {
+					chunk.data = stream.freeData.back();
+					stream.freeData.pop_back();
+				}
+				else {
+					chunk.data = new unsigned char[stream.chunkBytes];
+				}
+				chunk.state = CDT_CHUNK_LOADING;
+				stream.live.push_back(index);
+				request.push_back(index);
+			}
+		}
+	}
+
+	if (!request.empty()) {
+		{
+			std::lock_guard<std::mutex> guard(stream.lock);
+			stream.requests.insert(stream.requests.end(), request.begin(), request.end());
+			stream.numPending += (int)request.size();
+		}
+		stream.wake.notify_one();
+	}
+}
+
+void StreamWaitIdle(CDTWorldStream &stream)
+{
+	{
+		std::unique_lock<std::mutex> guard(stream.lock);
+		stream.idle.wait(guard, [&stream] { return stream.numPending == 0; });
+	}
+	_collectDone(stream);
+}
+
+void StreamReset(CDTWorldStream &stream)
+{
+	// let the thread finish what it has, the buffers must not be freed under it
+	{
+		std::unique_lock<std::mutex> guard(stream.lock);
+		stream.numPending -= (int)stream.requests.size();
+		stream.requests.clear();
+		stream.idle.wait(guard, [&stream] { return stream.numPending == 0; });
+		stream.done.clear();
+	}
+
+	while (!stream.live.empty())
+		_evict(stream, stream.live.back(), false);
+}
+
+const unsigned char* StreamChunkData(const CDTWorldStream &stream, int chunkX, int chunkY)
+{
+	if (chunkX < 0 || chunkX >= stream.numChunkX || chunkY < 0 || chunkY >= stream.numChunkY)
+		return NULL;
+
+	const CDTChunk &chunk = stream.chunks[chunkY * stream.numChunkX + chunkX];
+	return chunk.state == CDT_CHUNK_RESIDENT ? chunk.data : NULL;
+}
+
+bool StreamTileResident(const CDTWorldStream &stream, int tileX, int tileY)
+{
+	if (tileX < 0 || tileY < 0)
+		return false;
+
+	return StreamChunkData(stream, tileX / stream.chunkSize, tileY / stream.chunkSize) != NULL;
+}
+
+int StreamResidentCount(const CDTWorldStream &stream)
+{
+	int count = 0;
+	for (size_t n = 0; n < stream.live.size(); n++) {
+		if (stream.chunks[stream.live[n]].state == CDT_CHUNK_RESIDENT)
+			count++;
+	}
+	return count;
+}
@@ -0,0 +1,98 @@
+
+#ifndef CDT_STREAM
+#define CDT_STREAM
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// -------------------------------------------
+// CDT world streaming
+//	- the world is cut in square chunks of chunkSize x chunkSize tiles,
+//	  chunk (cx,cy) covers tiles [cx*size, (cx+1)*size) in map space (y up)
+//	- StreamUpdate keeps the chunks within radius (in chunks) of the focus
+//	  resident: missing ones are queued nearest first and loaded by the
+//	  stream thread, the ones past radius+1 are evicted
+//	- at most budget chunks are resident or loading, when full the least
+//	  recently wanted chunk outside of the radius is evicted first
+//	- every resident chunk owns chunkBytes of data filled by the load
+//	  function on the stream thread, the main thread only sees it once
+//	  StreamUpdate made it resident (onResident is called then)
+//	- StreamUpdate/StreamChunkData/... are for the main thread only
+// -------------------------------------------
+
+#define CDT_CHUNK_UNLOADED			0
+#define CDT_CHUNK_LOADING			1		// queued or being loaded by the stream thread
+#define CDT_CHUNK_RESIDENT			2
+
+// stream thread: fill data with the content of the chunk
+typedef void(*CDTChunkLoadFunc)(int chunkX, int chunkY, unsigned char* data, void* user);
+// main thread: a chunk became resident / is about to be evicted
+typedef void(*CDTChunkEventFunc)(int chunkX, int chunkY, const unsigned char* data, void* user);
+
+struct CDTChunk
+{
+	int				state;
+	unsigned char*	data;
+	long			lastWanted;				// last StreamUpdate the chunk was in the radius
+};
+
+struct CDTWorldStream
+{
+	int				chunkSize;
+	int				numChunkX;
+	int				numChunkY;
+	int				radius;
+	int				budget;
+	size_t			chunkBytes;
+
+	CDTChunkLoadFunc	load;
+	CDTChunkEventFunc	onResident;
+	CDTChunkEventFunc	onEvict;
+	void*				user;
+
+	// main thread only
+	std::vector<CDTChunk>			chunks;			// chunks[cy * numChunkX + cx]
+	std::vector<int>				live;			// chunks loading or resident
+	std::vector<unsigned char*>		freeData;		// buffers of evicted chunks, reused
+	long							updateCount;
+
+	// shared with the stream thread, under lock
+	std::thread						thread;
+	std::mutex						lock;
+	std::condition_variable			wake;			// a request or quit for the thread
+	std::condition_variable			idle;			// a request is done
+	std::deque<int>					requests;
+	std::vector<int>				done;
+	int								numPending;		// queued + being loaded
+	bool							quit;
+};
+
+// -------------------------------------------
+// Stream functions
+// -------------------------------------------
+
+void StreamInit(CDTWorldStream &stream, int worldWidth, int worldHeight, int chunkSize, int radius, int budget, size_t chunkBytes,
+	CDTChunkLoadFunc load, CDTChunkEventFunc onResident, CDTChunkEventFunc onEvict, void* user);
+void StreamShutdown(CDTWorldStream &stream);
+
+// focus is in tiles (map space), ex. the camera position
+void StreamUpdate(CDTWorldStream &stream, float focusX, float focusY);
+
+// block until every queued chunk is loaded, then make them resident
+void StreamWaitIdle(CDTWorldStream &stream);
+
+// drop every chunk, onEvict is not called
+void StreamReset(CDTWorldStream &stream);
+
+// NULL if the chunk is not resident
+const unsigned char* StreamChunkData(const CDTWorldStream &stream, int chunkX, int chunkY);
+bool StreamTileResident(const CDTWorldStream &stream, int tileX, int tileY);
+int  StreamResidentCount(const CDTWorldStream &stream);
+
+
+#endif
@@ -0,0 +1,149 @@
+
+#ifndef CDT_TILE_MAP
+#define CDT_TILE_MAP
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+
+// -------------------------------------------
+// CDT tile map
+//	- all the cells in 1 contiguous buffer, the cell type is the
+//	  template parameter (uint8_t or uint16_t tile id)
+//	- CDT_TILE_ROW_MAJOR: cell (x,y) at y * width + x, rows are
+//	  streamed in order, best for full row scans (draw, loading)
+//	- CDT_TILE_MORTON: the map is cut in 8x8 blocks stored row by
+//	  row, cells inside a block are in Morton (Z) order, best for
+//	  2D neighbourhood lookups on very big maps
+//	- TileMapGet/TileMapSet are bounds checked (0 outside of the map),
+//	  TileMapAt is not, use it in loops that are already clipped
+//	- the cells are owned by the map (TileMapInit) or are a view on
+//	  memory owned by someone else, ex. a mapped level file (TileMapView)
+// -------------------------------------------
+
+#define CDT_TILE_ROW_MAJOR			0
+#define CDT_TILE_MORTON				1
+
+#define CDT_TILE_BLOCK_SHIFT		3				// 8x8 cells per block
+#define CDT_TILE_BLOCK_SIZE			(1 << CDT_TILE_BLOCK_SHIFT)
+
+template<typename T>
+struct CDTTileMap
+{
+	int				width;
+	int				height;
+	int				layout;
+	int				blocksPerRow;			// CDT_TILE_MORTON only
+	T*				cells;
+	std::vector<T>	storage;				// cells of an owning map, empty for a view
+};
+
+typedef CDTTileMap<uint8_t>		CDTTileMap8;
+typedef CDTTileMap<uint16_t>	CDTTileMap16;
+
+// -------------------------------------------
+// Tile map functions
+// -------------------------------------------
+
+//+ Spread the 3 low bits of v to the even bits (abc -> a0b0c)
+inline unsigned int _tileSpread3(unsigned int v)
+{
+	return (v & 1) | ((v & 2) << 1) | ((v & 4) << 2);
+}
+
+template<typename T>
+void TileMapInit(CDTTileMap<T> &map, int width, int height, int layout = CDT_TILE_ROW_MAJOR)
+{
+	map.width = width;
+	map.height = height;
+	map.layout = layout;
+	map.blocksPerRow = (width + CDT_TILE_BLOCK_SIZE - 1) >> CDT_TILE_BLOCK_SHIFT;
+
+	size_t count = (size_t)width * height;
+	if (layout == CDT_TILE_MORTON) {
+		int blocksPerColumn = (height + CDT_TILE_BLOCK_SIZE - 1) >> CDT_TILE_BLOCK_SHIFT;
+		count = (size_t)map.blocksPerRow * blocksPerColumn * CDT_TILE_BLOCK_SIZE * CDT_TILE_BLOCK_SIZE;
+	}
+	map.storage.assign(count, 0);
+	map.cells = map.storage.empty() ? NULL : &map.storage[0];
+}
+
+template<typename T>
+void TileMapView(CDTTileMap<T> &map, int width, int height, int layout, T* cells)
+{
+	map.width = width;
+	map.height = height;
+	map.layout = layout;
+	map.blocksPerRow = (width + CDT_TILE_BLOCK_SIZE - 1) >> CDT_TILE_BLOCK_SHIFT;
+	map.storage.clear();
+	map.cells = cells;
+}
+
+template<typename T>
+void TileMapFree(CDTTileMap<T> &map)
+{
+	map.storage.clear();
+	map.cells = NULL;
+	map.width = 0;
+	map.height = 0;
+}
+
+template<typename T>
+inline size_t TileMapIndex(const CDTTileMap<T> &map, int x, int y)
+{
+	if (map.layout == CDT_TILE_ROW_MAJOR)
+		return (size_t)y * map.width + x;
+
+	size_t block = (size_t)(y >> CDT_TILE_BLOCK_SHIFT) * map.blocksPerRow + (x >> CDT_TILE_BLOCK_SHIFT);
+	return (block << (2 * CDT_TILE_BLOCK_SHIFT)) | (_tileSpread3(y) << 1) | _tileSpread3(x);
+}
+
+template<typename T>
+inline bool TileMapInside(const CDTTileMap<T> &map, int x, int y)
+{
+	return x >= 0 && x < map.width && y >= 0 && y < map.height;
+}
+
+// unchecked access
+template<typename T>
+inline T& TileMapAt(CDTTileMap<T> &map, int x, int y)
+{
+	return map.cells[TileMapIndex(map, x, y)];
+}
+
+template<typename T>
+inline T TileMapAt(const CDTTileMap<T> &map, int x, int y)
+{
+	return map.cells[TileMapIndex(map, x, y)];
+}
+
+// checked access
+template<typename T>
+inline T TileMapGet(const CDTTileMap<T> &map, int x, int y)
+{
+	if (!TileMapInside(map, x, y))
+		return 0;
+
+	return map.cells[TileMapIndex(map, x, y)];
+}
+
+template<typename T>
+inline void TileMapSet(CDTTileMap<T> &map, int x, int y, T value)
+{
+	if (TileMapInside(map, x, y))
+		map.cells[TileMapIndex(map, x, y)] = value;
+}
+
+// first cell of row y, CDT_TILE_ROW_MAJOR only (NULL otherwise)
+template<typename T>
+inline const T* TileMapRow(const CDTTileMap<T> &map, int y)
+{
+	if (map.layout != CDT_TILE_ROW_MAJOR || y < 0 || y >= map.height)
+		return NULL;
+
+	return &map.cells[(size_t)y * map.width];
+}
+
+
+#endif
@@ -0,0 +1,87 @@
+
+#include "CDTTransform.h"
+#include "CDTSimd.h"
+
+// -------------------------------------------
+// Affine functions
+// -------------------------------------------
+
+CDTAffine2D AffineIdentity()
+{
+	CDTAffine2D m = { 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f };
+	return m;
+}
+
+CDTAffine2D AffineFromTRS(float posX, float posY, float scaleX, float scaleY, float orientation)
+{
+	CDTAffine2D m;
+
+	// most objects never rotate, skip the sin/cos
+	if (orientation == 0.0f) {
+		m.a = scaleX;	m.c = 0.0f;
+		m.b = 0.0f;		m.d = scaleY;
+	}
+	else {
+		float cs = cosf(orientation), sn = sinf(orientation);
+		m.a = scaleX * cs;	m.c = -scaleX * sn;
+		m.b = scaleY * sn;	m.d = scaleY * cs;
+	}
+	m.tx = posX;
+	m.ty = posY;
+
+	return m;
+}
+
+CDTAffine2D AffineMultiply(const CDTAffine2D &l, const CDTAffine2D &r)
+{
+	CDTAffine2D m;
+	m.a = l.a * r.a + l.c * r.b;
+	m.b = l.b * r.a + l.d * r.b;
+	m.c = l.a * r.c + l.c * r.d;
+	m.d = l.b * r.c + l.d * r.d;
+	m.tx = l.a * r.tx + l.c * r.ty + l.tx;
+	m.ty = l.b * r.tx + l.d * r.ty + l.ty;
+	return m;
+}
+
+void AffineBatchCompute(const CDTTRSBatch &in, CDTAffine2D* out)
+{
+	int i = 0;
+
+#if defined(CDT_SIMD_X86)
+	for (; i + 4 <= in.count; i += 4) {
+		float cs[4], sn[4];
+		for (int k = 0; k < 4; k++) {
+			float o = in.orientation[i + k];
+			cs[k] = (o == 0.0f) ? 1.0f : cosf(o);
+			sn[k] = (o == 0.0f) ? 0.0f : sinf(o);
+		}
+
+		__m128 sx = _mm_loadu_ps(in.scaleX + i);
+		__m128 sy = _mm_loadu_ps(in.scaleY + i);
+		__m128 vcs = _mm_loadu_ps(cs);
+		__m128 vsn = _mm_loadu_ps(sn);
+
+		__m128 a = _mm_mul_ps(sx, vcs);
+		__m128 b = _mm_mul_ps(sy, vsn);
+		__m128 c = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(sx, vsn));
+		__m128 d = _mm_mul_ps(sy, vcs);
+
+		// (a,b,c,d) of 4 transforms -> 4 x (a,b,c,d) of 1 transform
+		_MM_TRANSPOSE4_PS(a, b, c, d);
+		_mm_storeu_ps(&out[i + 0].a, a);
+		_mm_storeu_ps(&out[i + 1].a, b);
+		_mm_storeu_ps(&out[i + 2].a, c);
+		_mm_storeu_ps(&out[i + 3].a, d);
+
+		for (int k = 0; k < 4; k++) {
+			out[i + k].tx = in.posX[i + k];
+			out[i + k].ty = in.posY[i + k];
+		}
+	}
+#endif
+
+	for (; i < in.count; i++) {
+		out[i] = AffineFromTRS(in.posX[i], in.posY[i], in.scaleX[i], in.scaleY[i], in.orientation[i]);
+	}
+}
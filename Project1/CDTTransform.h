@@ -0,0 +1,46 @@
+
+#ifndef CDT_TRANSFORM
+#define CDT_TRANSFORM
+
+#include <math.h>
+
+// -------------------------------------------
+// CDT 2D affine transform
+//	- 2x3 matrix, same layout as the first 2 rows of a glm::mat4
+//	  x' = a*x + c*y + tx
+//	  y' = b*x + d*y + ty
+//	- built as translate * scale * rotate, like the model matrix
+//	  of a game object
+// -------------------------------------------
+
+struct CDTAffine2D
+{
+	float a, b;								// column 0
+	float c, d;								// column 1
+	float tx, ty;							// column 2 (translation)
+};
+
+// input of AffineBatchCompute, 1 array per component
+struct CDTTRSBatch
+{
+	const float*	posX;
+	const float*	posY;
+	const float*	scaleX;
+	const float*	scaleY;
+	const float*	orientation;			// radian
+	int				count;
+};
+
+// -------------------------------------------
+// Affine functions
+// -------------------------------------------
+
+CDTAffine2D AffineIdentity();
+CDTAffine2D AffineFromTRS(float posX, float posY, float scaleX, float scaleY, float orientation);
+CDTAffine2D AffineMultiply(const CDTAffine2D &lhs, const CDTAffine2D &rhs);
+
+// out[i] = AffineFromTRS(in[i]), 4 transforms at a time with SSE
+void AffineBatchCompute(const CDTTRSBatch &in, CDTAffine2D* out);
+
+
+#endif
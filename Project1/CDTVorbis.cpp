@@ -0,0 +1,1179 @@
+
+#include "CDTVorbis.h"
+#include <string.h>
+#include <math.h>
+
+#define VORBIS_PI					3.14159265358979323846
+#define VORBIS_MAX_CHANNEL			256
+#define VORBIS_MAX_FLOOR_VALUE		65
+#define VORBIS_PAGE_HEADER			27				// bytes before the segment table
+#define VORBIS_PAGE_CONTINUED		0x01			// page header type flags
+#define VORBIS_PAGE_LAST			0x04
+
+// floor 1 amplitude of each of the 256 floor values (Vorbis I spec, 10.1)
+static const float cdt_vorbis_inverse_db[256] = {
+	1.0649863e-07f, 1.1341951e-07f, 1.2079015e-07f, 1.2863978e-07f, 1.369995e-07f, 1.459025e-07f,
+	1.5538409e-07f, 1.6548181e-07f, 1.7623574e-07f, 1.8768856e-07f, 1.998856e-07f, 2.128753e-07f,
+	2.2670913e-07f, 2.4144197e-07f, 2.5713223e-07f, 2.7384212e-07f, 2.9163792e-07f, 3.1059022e-07f,
+	3.307741e-07f, 3.5226967e-07f, 3.7516213e-07f, 3.995423e-07f, 4.255068e-07f, 4.5315863e-07f,
+	4.8260745e-07f, 5.1397e-07f, 5.4737063e-07f, 5.829419e-07f, 6.208247e-07f, 6.611694e-07f,
+	7.041359e-07f, 7.4989464e-07f, 7.98627e-07f, 8.505263e-07f, 9.057983e-07f, 9.646621e-07f,
+	1.0273513e-06f, 1.0941144e-06f, 1.1652161e-06f, 1.2409384e-06f, 1.3215816e-06f, 1.4074654e-06f,
+	1.4989305e-06f, 1.5963394e-06f, 1.7000785e-06f, 1.8105592e-06f, 1.9282195e-06f, 2.053526e-06f,
+	2.1869757e-06f, 2.3290977e-06f, 2.4804558e-06f, 2.6416496e-06f, 2.813319e-06f, 2.9961443e-06f,
+	3.1908505e-06f, 3.39821e-06f, 3.619045e-06f, 3.8542307e-06f, 4.1047006e-06f, 4.371447e-06f,
+	4.6555283e-06f, 4.958071e-06f, 5.280274e-06f, 5.623416e-06f, 5.988857e-06f, 6.3780467e-06f,
+	6.7925284e-06f, 7.2339453e-06f, 7.704048e-06f, 8.2047e-06f, 8.737888e-06f, 9.305725e-06f,
+	9.910464e-06f, 1.0554501e-05f, 1.1240392e-05f, 1.1970856e-05f, 1.2748789e-05f, 1.3577278e-05f,
+	1.4459606e-05f, 1.5399271e-05f, 1.6400005e-05f, 1.7465769e-05f, 1.8600793e-05f, 1.9809577e-05f,
+	2.1096914e-05f, 2.2467912e-05f, 2.3928002e-05f, 2.5482977e-05f, 2.7139005e-05f, 2.890265e-05f,
+	3.078091e-05f, 3.2781227e-05f, 3.4911533e-05f, 3.718028e-05f, 3.9596467e-05f, 4.2169668e-05f,
+	4.491009e-05f, 4.7828602e-05f, 5.0936775e-05f, 5.424693e-05f, 5.7772202e-05f, 6.152657e-05f,
+	6.552491e-05f, 6.9783084e-05f, 7.4317984e-05f, 7.914758e-05f, 8.429104e-05f, 8.976875e-05f,
+	9.560242e-05f, 0.00010181521f, 0.00010843174f, 0.00011547824f, 0.00012298267f, 0.00013097477f,
+	0.00013948625f, 0.00014855085f, 0.00015820454f, 0.00016848555f, 0.00017943469f, 0.00019109536f,
+	0.00020351382f, 0.0002167393f, 0.00023082423f, 0.00024582449f, 0.00026179955f, 0.00027881275f,
+	0.00029693157f, 0.00031622787f, 0.00033677815f, 0.00035866388f, 0.00038197188f, 0.00040679457f,
+	0.00043323037f, 0.0004613841f, 0.0004913675f, 0.00052329927f, 0.0005573062f, 0.0005935231f,
+	0.0006320936f, 0.0006731706f, 0.000716917f, 0.0007635063f, 0.00081312325f, 0.00086596457f,
+	0.00092223985f, 0.0009821722f, 0.0010459992f, 0.0011139743f, 0.0011863665f, 0.0012634633f,
+	0.0013455702f, 0.0014330129f, 0.0015261382f, 0.0016253153f, 0.0017309374f, 0.0018434235f,
+	0.0019632196f, 0.0020908006f, 0.0022266726f, 0.0023713743f, 0.0025254795f, 0.0026895993f,
+	0.0028643848f, 0.0030505287f, 0.003248769f, 0.0034598925f, 0.0036847359f, 0.0039241905f,
+	0.0041792067f, 0.004450795f, 0.004740033f, 0.005048067f, 0.0053761187f, 0.005725489f,
+	0.0060975635f, 0.0064938175f, 0.0069158226f, 0.0073652514f, 0.007843887f, 0.008353627f,
+	0.008896492f, 0.009474637f, 0.010090352f, 0.01074608f, 0.011444421f, 0.012188144f,
+	0.012980198f, 0.013823725f, 0.014722068f, 0.015678791f, 0.016697686f, 0.017782796f,
+	0.018938422f, 0.020169148f, 0.021479854f, 0.022875736f, 0.02436233f, 0.025945531f,
+	0.027631618f, 0.029427277f, 0.031339627f, 0.03337625f, 0.035545226f, 0.037855156f,
+	0.0403152f, 0.042935107f, 0.045725275f, 0.048696756f, 0.05186135f, 0.05523159f,
+	0.05882085f, 0.062643364f, 0.06671428f, 0.07104975f, 0.075666964f, 0.08058423f,
+	0.08582105f, 0.09139818f, 0.097337745f, 0.1036633f, 0.11039993f, 0.11757434f,
+	0.12521498f, 0.13335215f, 0.14201812f, 0.15124726f, 0.16107617f, 0.1715438f,
+	0.18269168f, 0.19456401f, 0.20720787f, 0.22067343f, 0.23501402f, 0.25028655f,
+	0.26655158f, 0.28387362f, 0.3023213f, 0.32196787f, 0.34289113f, 0.36517414f,
+	0.3889052f, 0.41417846f, 0.44109413f, 0.4697589f, 0.50028646f, 0.53279793f,
+	0.5674221f, 0.6042964f, 0.64356697f, 0.6853896f, 0.72993004f, 0.777365f,
+	0.8278826f, 0.88168305f, 0.9389798f, 1.0f
+};
+
+struct _BitReader
+{
+	const unsigned char*	data;
+	size_t					size;
+	size_t					pos;				// in bits
+	bool					eop;				// read past the end of the packet
+};
+
+// -------------------------------------------
+// Internal functions
+// -------------------------------------------
+
+static uint32_t _read32(const unsigned char* p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+//+ Bits needed to store v, 0 for 0
+static int _ilog(uint32_t v)
+{
+	int bits = 0;
+	while (v) {
+		bits++;
+		v >>= 1;
+	}
+	return bits;
+}
+
+//+ Vorbis packs the values LSB first, past the end the reads are 0 and eop is set
+static uint32_t _readBits(_BitReader &br, int count)
+{
+	uint32_t v = 0;
+	for (int i = 0; i < count; i++) {
+		size_t byte = br.pos >> 3;
+		if (byte >= br.size) {
+			br.eop = true;
+			return 0;
+		}
+		v |= (uint32_t)((br.data[byte] >> (br.pos & 7)) & 1) << i;
+		br.pos++;
+	}
+	return v;
+}
+
+static float _unpackFloat(uint32_t x)
+{
+	double mantissa = (double)(x & 0x1FFFFF);
+	int exponent = (int)((x & 0x7FE00000) >> 21);
+	if (x & 0x80000000)
+		mantissa = -mantissa;
+	return (float)ldexp(mantissa, exponent - 788);
+}
+
+//+ Greatest r with r^dimensions <= entries
+static int _lookup1Values(int entries, int dimensions)
+{
+	int r = (int)floor(exp(log((double)entries) / dimensions));
+	while (pow((double)(r + 1), dimensions) <= entries)
+		r++;
+	while (r > 0 && pow((double)r, dimensions) > entries)
+		r--;
+	return r;
+}
+
+
+// -------------------------------------------
+// Ogg pages & packets
+// -------------------------------------------
+
+//+ First page of the stream at pos or after it, false at the end of the file
+static bool _readPage(CDTVorbis &vorbis, size_t pos)
+{
+	while (pos + VORBIS_PAGE_HEADER <= vorbis.size) {
+		const unsigned char* page = vorbis.data + pos;
+		if (memcmp(page, "OggS", 4) != 0 || page[4] != 0)
+			return false;
+
+		int numSegment = page[26];
+		size_t header = VORBIS_PAGE_HEADER + numSegment;
+		if (pos + header > vorbis.size)
+			return false;
+		size_t body = 0;
+		for (int s = 0; s < numSegment; s++)
+			body += page[VORBIS_PAGE_HEADER + s];
+		if (pos + header + body > vorbis.size)
+			return false;
+
+		// pages of another stream of the file
+		if (_read32(page + 14) != vorbis.serial) {
+			pos += header + body;
+			continue;
+		}
+
+		vorbis.pagePos = pos;
+		vorbis.nextPage = pos + header + body;
+		vorbis.bodyPos = pos + header;
+		vorbis.numSegment = numSegment;
+		vorbis.segment = 0;
+		vorbis.pageGranule = (int64_t)((uint64_t)_read32(page + 6) | ((uint64_t)_read32(page + 10) << 32));
+		vorbis.lastPage = (page[5] & VORBIS_PAGE_LAST) != 0 || vorbis.nextPage + VORBIS_PAGE_HEADER > vorbis.size;
+		return true;
+	}
+	return false;
+}
+
+//+ Next packet of the stream in vorbis.packet, last is true if it ends the last page
+//	- a packet that lost its start or its end (corrupted file) is dropped
+static bool _nextPacket(CDTVorbis &vorbis, bool &last)
+{
+	bool started = false;
+	vorbis.packet.clear();
+
+	for (;;) {
+		if (vorbis.segment == vorbis.numSegment) {
+			if (!_readPage(vorbis, vorbis.nextPage))
+				return false;
+
+			bool continued = (vorbis.data[vorbis.pagePos + 5] & VORBIS_PAGE_CONTINUED) != 0;
+			if (started && !continued) {
+				vorbis.packet.clear();
+				started = false;
+			}
+			else if (!started && continued) {
+				while (vorbis.segment < vorbis.numSegment) {
+					int lacing = vorbis.data[vorbis.pagePos + VORBIS_PAGE_HEADER + vorbis.segment++];
+					vorbis.bodyPos += lacing;
+					if (lacing < 255)
+						break;
+				}
+			}
+			continue;
+		}
+
+		int lacing = vorbis.data[vorbis.pagePos + VORBIS_PAGE_HEADER + vorbis.segment++];
+		vorbis.packet.insert(vorbis.packet.end(), vorbis.data + vorbis.bodyPos, vorbis.data + vorbis.bodyPos + lacing);
+		vorbis.bodyPos += lacing;
+		started = true;
+		if (lacing < 255) {
+			last = vorbis.lastPage && vorbis.segment == vorbis.numSegment;
+			return true;
+		}
+	}
+}
+
+
+// -------------------------------------------
+// Setup header
+// -------------------------------------------
+
+//+ Huffman tree of the codeword lengths, the codewords are given in entry order,
+//	each one the lowest free codeword of its length (Vorbis I spec, 3.2.1)
+//	- available[l] is the free codeword of length l, MSB aligned, 0 = none
+static bool _buildTree(CDTVorbisCodebook &book, const std::vector<uint8_t> &lengths)
+{
+	int numUsed = 0, first = -1;
+	for (int e = 0; e < book.entries; e++) {
+		if (lengths[e] == 0)
+			continue;
+		if (first < 0)
+			first = e;
+		numUsed++;
+	}
+
+	book.tree.assign(2, 0);
+	if (numUsed == 0)
+		return true;
+
+	// a single codeword takes 1 bit whatever its value
+	if (numUsed == 1) {
+		book.tree[0] = -(first + 1);
+		book.tree[1] = -(first + 1);
+		return true;
+	}
+
+	uint32_t available[33] = { 0 };
+	for (int e = first; e < book.entries; e++) {
+		int length = lengths[e];
+		if (length == 0)
+			continue;
+
+		uint32_t code = 0;
+		if (e == first) {
+			for (int l = 1; l <= length; l++)
+				available[l] = 1u << (32 - l);
+		}
+		else {
+			int l = length;
+			while (l > 0 && available[l] == 0)
+				l--;
+			if (l == 0)
+				return false;					// over-specified tree
+			code = available[l];
+			available[l] = 0;
+			for (int y = length; y > l; y--)
+				available[y] = code + (1u << (32 - y));
+		}
+
+		int node = 0;
+		for (int b = 0; b < length; b++) {
+			int slot = node * 2 + (int)((code >> (31 - b)) & 1);
+			if (b == length - 1) {
+				if (book.tree[slot] != 0)
+					return false;
+				book.tree[slot] = -(e + 1);
+				break;
+			}
+			if (book.tree[slot] < 0)
+				return false;
+			if (book.tree[slot] == 0) {
+				book.tree[slot] = (int)(book.tree.size() / 2);
+				book.tree.push_back(0);
+				book.tree.push_back(0);
+			}
+			node = book.tree[slot];
+		}
+	}
+	return true;
+}
+
+static bool _readCodebook(CDTVorbisCodebook &book, _BitReader &br)
+{
+	if (_readBits(br, 24) != 0x564342)
+		return false;
+
+	book.dimensions = (int)_readBits(br, 16);
+	book.entries = (int)_readBits(br, 24);
+	if (book.dimensions == 0 || book.entries == 0)
+		return false;
+
+	std::vector<uint8_t> lengths(book.entries, 0);
+	if (_readBits(br, 1)) {
+		// ordered: runs of entries of increasing length
+		int entry = 0;
+		int length = (int)_readBits(br, 5) + 1;
+		while (entry < book.entries) {
+			int count = (int)_readBits(br, _ilog(book.entries - entry));
+			if (entry + count > book.entries || length > 32)
+				return false;
+			memset(&lengths[entry], length, count);
+			entry += count;
+			length++;
+		}
+	}
+	else {
+		bool sparse = _readBits(br, 1) != 0;
+		for (int e = 0; e < book.entries; e++) {
+			if (!sparse || _readBits(br, 1))
+				lengths[e] = (uint8_t)(_readBits(br, 5) + 1);
+		}
+	}
+	if (br.eop || !_buildTree(book, lengths))
+		return false;
+
+	// VQ vectors, expanded once so the residue decode only adds them
+	int lookupType = (int)_readBits(br, 4);
+	book.values.clear();
+	if (lookupType == 0)
+		return !br.eop;
+	if (lookupType > 2)
+		return false;
+
+	float minimum = _unpackFloat(_readBits(br, 32));
+	float delta = _unpackFloat(_readBits(br, 32));
+	int valueBits = (int)_readBits(br, 4) + 1;
+	bool sequence = _readBits(br, 1) != 0;
+	int64_t numLookup = lookupType == 1 ? _lookup1Values(book.entries, book.dimensions) : (int64_t)book.entries * book.dimensions;
+	if (numLookup <= 0 || numLookup * valueBits > (int64_t)br.size * 8)
+		return false;
+
+	std::vector<uint32_t> multiplicands((size_t)numLookup);
+	for (int64_t i = 0; i < numLookup; i++)
+		multiplicands[(size_t)i] = _readBits(br, valueBits);
+	if (br.eop)
+		return false;
+
+	book.values.resize((size_t)book.entries * book.dimensions);
+	for (int e = 0; e < book.entries; e++) {
+		float last = 0.0f;
+		int64_t divisor = 1;
+		for (int d = 0; d < book.dimensions; d++) {
+			int64_t offset = lookupType == 1 ? (e / divisor) % numLookup : (int64_t)e * book.dimensions + d;
+			float value = multiplicands[(size_t)offset] * delta + minimum + last;
+			if (sequence)
+				last = value;
+			book.values[(size_t)e * book.dimensions + d] = value;
+			if (lookupType == 1 && divisor <= book.entries)
+				divisor *= numLookup;
+		}
+	}
+	return true;
+}
+
+static bool _readFloor(CDTVorbisFloor &floor, _BitReader &br, int numCodebook)
+{
+	// floor 0 is not supported
+	if (_readBits(br, 16) != 1)
+		return false;
+
+	int maxClass = -1;
+	floor.numPartition = (int)_readBits(br, 5);
+	for (int p = 0; p < floor.numPartition; p++) {
+		floor.partitionClass[p] = (int)_readBits(br, 4);
+		if (floor.partitionClass[p] > maxClass)
+			maxClass = floor.partitionClass[p];
+	}
+
+	for (int c = 0; c <= maxClass; c++) {
+		floor.classDimensions[c] = (int)_readBits(br, 3) + 1;
+		floor.classSubclasses[c] = (int)_readBits(br, 2);
+		floor.classMasterbook[c] = -1;
+		if (floor.classSubclasses[c]) {
+			floor.classMasterbook[c] = (int)_readBits(br, 8);
+			if (floor.classMasterbook[c] >= numCodebook)
+				return false;
+		}
+		for (int s = 0; s < (1 << floor.classSubclasses[c]); s++) {
+			floor.subclassBooks[c][s] = (int)_readBits(br, 8) - 1;
+			if (floor.subclassBooks[c][s] >= numCodebook)
+				return false;
+		}
+	}
+
+	floor.multiplier = (int)_readBits(br, 2) + 1;
+	int rangeBits = (int)_readBits(br, 4);
+	floor.x[0] = 0;
+	floor.x[1] = 1 << rangeBits;
+	floor.numValue = 2;
+	for (int p = 0; p < floor.numPartition; p++) {
+		int c = floor.partitionClass[p];
+		for (int d = 0; d < floor.classDimensions[c]; d++) {
+			if (floor.numValue == VORBIS_MAX_FLOOR_VALUE)
+				return false;
+			floor.x[floor.numValue++] = (int)_readBits(br, rangeBits);
+		}
+	}
+
+	// sorted by x for the curve, the values are predicted from their neighbours
+	for (int i = 0; i < floor.numValue; i++) {
+		int j = i;
+		while (j > 0 && floor.x[floor.sorted[j - 1]] > floor.x[i]) {
+			floor.sorted[j] = floor.sorted[j - 1];
+			j--;
+		}
+		floor.sorted[j] = i;
+	}
+	for (int i = 2; i < floor.numValue; i++) {
+		floor.low[i] = 0;
+		floor.high[i] = 1;
+		for (int j = 0; j < i; j++) {
+			if (floor.x[j] < floor.x[i] && floor.x[j] > floor.x[floor.low[i]])
+				floor.low[i] = j;
+			if (floor.x[j] > floor.x[i] && floor.x[j] < floor.x[floor.high[i]])
+				floor.high[i] = j;
+		}
+	}
+	return !br.eop;
+}
+
+static bool _readResidue(CDTVorbisResidue &residue, _BitReader &br, int numCodebook)
+{
+	residue.type = (int)_readBits(br, 16);
+	if (residue.type > 2)
+		return false;
+
+	residue.begin = (int)_readBits(br, 24);
+	residue.end = (int)_readBits(br, 24);
+	residue.partitionSize = (int)_readBits(br, 24) + 1;
+	residue.numClassification = (int)_readBits(br, 6) + 1;
+	residue.classbook = (int)_readBits(br, 8);
+	if (residue.classbook >= numCodebook)
+		return false;
+
+	int cascade[64];
+	for (int c = 0; c < residue.numClassification; c++) {
+		cascade[c] = (int)_readBits(br, 3);
+		if (_readBits(br, 1))
+			cascade[c] |= (int)_readBits(br, 5) << 3;
+	}
+	for (int c = 0; c < residue.numClassification; c++) {
+		for (int pass = 0; pass < 8; pass++) {
+			residue.books[c][pass] = -1;
+			if (cascade[c] & (1 << pass)) {
+				residue.books[c][pass] = (int)_readBits(br, 8);
+				if (residue.books[c][pass] >= numCodebook)
+					return false;
+			}
+		}
+	}
+	return !br.eop;
+}
+
+static bool _readMapping(CDTVorbisMapping &mapping, _BitReader &br, int channels, int numFloor, int numResidue)
+{
+	if (_readBits(br, 16) != 0)
+		return false;
+
+	mapping.numSubmap = _readBits(br, 1) ? (int)_readBits(br, 4) + 1 : 1;
+	mapping.numCoupling = 0;
+	if (_readBits(br, 1)) {
+		mapping.numCoupling = (int)_readBits(br, 8) + 1;
+		int bits = _ilog(channels - 1);
+		for (int s = 0; s < mapping.numCoupling; s++) {
+			mapping.magnitude[s] = (int)_readBits(br, bits);
+			mapping.angle[s] = (int)_readBits(br, bits);
+			if (mapping.magnitude[s] == mapping.angle[s] || mapping.magnitude[s] >= channels || mapping.angle[s] >= channels)
+				return false;
+		}
+	}
+	if (_readBits(br, 2) != 0)
+		return false;
+
+	for (int c = 0; c < channels; c++) {
+		mapping.mux[c] = mapping.numSubmap > 1 ? (int)_readBits(br, 4) : 0;
+		if (mapping.mux[c] >= mapping.numSubmap)
+			return false;
+	}
+	for (int s = 0; s < mapping.numSubmap; s++) {
+		_readBits(br, 8);							// unused time configuration
+		mapping.submapFloor[s] = (int)_readBits(br, 8);
+		mapping.submapResidue[s] = (int)_readBits(br, 8);
+		if (mapping.submapFloor[s] >= numFloor || mapping.submapResidue[s] >= numResidue)
+			return false;
+	}
+	return !br.eop;
+}
+
+static bool _readSetup(CDTVorbis &vorbis, _BitReader &br)
+{
+	int numCodebook = (int)_readBits(br, 8) + 1;
+	vorbis.codebooks.resize(numCodebook);
+	for (int b = 0; b < numCodebook; b++) {
+		if (!_readCodebook(vorbis.codebooks[b], br))
+			return false;
+	}
+
+	// time domain transforms, placeholders in Vorbis I
+	int numTime = (int)_readBits(br, 6) + 1;
+	for (int t = 0; t < numTime; t++) {
+		if (_readBits(br, 16) != 0)
+			return false;
+	}
+
+	vorbis.floors.resize(_readBits(br, 6) + 1);
+	for (size_t f = 0; f < vorbis.floors.size(); f++) {
+		if (!_readFloor(vorbis.floors[f], br, numCodebook))
+			return false;
+	}
+
+	vorbis.residues.resize(_readBits(br, 6) + 1);
+	for (size_t r = 0; r < vorbis.residues.size(); r++) {
+		if (!_readResidue(vorbis.residues[r], br, numCodebook))
+			return false;
+	}
+
+	vorbis.mappings.resize(_readBits(br, 6) + 1);
+	for (size_t m = 0; m < vorbis.mappings.size(); m++) {
+		if (!_readMapping(vorbis.mappings[m], br, vorbis.channels, (int)vorbis.floors.size(), (int)vorbis.residues.size()))
+			return false;
+	}
+
+	vorbis.modes.resize(_readBits(br, 6) + 1);
+	for (size_t m = 0; m < vorbis.modes.size(); m++) {
+		CDTVorbisMode &mode = vorbis.modes[m];
+		mode.blockFlag = (int)_readBits(br, 1);
+		int windowType = (int)_readBits(br, 16);
+		int transformType = (int)_readBits(br, 16);
+		mode.mapping = (int)_readBits(br, 8);
+		if (windowType != 0 || transformType != 0 || mode.mapping >= (int)vorbis.mappings.size())
+			return false;
+	}
+
+	// framing bit
+	return _readBits(br, 1) == 1 && !br.eop;
+}
+
+//+ Window slope and the IMDCT tables of a block size n
+//	- the IMDCT is a DCT-IV of n/2 done with a complex FFT of n/4
+static void _initTransform(CDTVorbis &vorbis, int b)
+{
+	int n = vorbis.blockSize[b];
+	int half = n / 2, quarter = n / 4;
+
+	vorbis.window[b].resize(half);
+	for (int i = 0; i < half; i++) {
+		double s = sin((i + 0.5) / half * VORBIS_PI / 2.0);
+		vorbis.window[b][i] = (float)sin(VORBIS_PI / 2.0 * s * s);
+	}
+
+	// pre rotation, post rotation, then the FFT twiddles
+	std::vector<float> &twiddle = vorbis.twiddle[b];
+	twiddle.resize((size_t)half * 2 + quarter);
+	for (int k = 0; k < quarter; k++) {
+		double pre = -VORBIS_PI * (4 * k + 1) / (4.0 * half);
+		double post = -VORBIS_PI * k / half;
+		twiddle[k * 2] = (float)cos(pre);
+		twiddle[k * 2 + 1] = (float)sin(pre);
+		twiddle[half + k * 2] = (float)cos(post);
+		twiddle[half + k * 2 + 1] = (float)sin(post);
+	}
+	for (int k = 0; k < quarter / 2; k++) {
+		double a = -2.0 * VORBIS_PI * k / quarter;
+		twiddle[half * 2 + k * 2] = (float)cos(a);
+		twiddle[half * 2 + k * 2 + 1] = (float)sin(a);
+	}
+
+	int bits = _ilog((uint32_t)quarter) - 1;
+	vorbis.bitReverse[b].resize(quarter);
+	for (int i = 0; i < quarter; i++) {
+		int r = 0;
+		for (int j = 0; j < bits; j++)
+			r |= ((i >> j) & 1) << (bits - 1 - j);
+		vorbis.bitReverse[b][i] = r;
+	}
+}
+
+
+// -------------------------------------------
+// Audio packets
+// -------------------------------------------
+
+//+ Entry of the next codeword, -1 at the end of the packet or on an unused codeword
+static int _decodeEntry(const CDTVorbisCodebook &book, _BitReader &br)
+{
+	int node = 0;
+	for (;;) {
+		int bit = (int)_readBits(br, 1);
+		if (br.eop)
+			return -1;
+		int child = book.tree[node * 2 + bit];
+		if (child < 0)
+			return -child - 1;
+		if (child == 0)
+			return -1;
+		node = child;
+	}
+}
+
+//+ Floor 1 values of a channel in y, false if the channel is unused
+static bool _decodeFloor(const CDTVorbis &vorbis, const CDTVorbisFloor &floor, _BitReader &br, int* y)
+{
+	static const int ranges[4] = { 256, 128, 86, 64 };
+
+	if (!_readBits(br, 1))
+		return false;
+
+	int bits = _ilog(ranges[floor.multiplier - 1] - 1);
+	y[0] = (int)_readBits(br, bits);
+	y[1] = (int)_readBits(br, bits);
+
+	int offset = 2;
+	for (int p = 0; p < floor.numPartition; p++) {
+		int c = floor.partitionClass[p];
+		int subclassBits = floor.classSubclasses[c];
+		int subclassMask = (1 << subclassBits) - 1;
+		int value = 0;
+		if (subclassBits) {
+			value = _decodeEntry(vorbis.codebooks[floor.classMasterbook[c]], br);
+			if (value < 0)
+				return false;
+		}
+
+		for (int d = 0; d < floor.classDimensions[c]; d++) {
+			int book = floor.subclassBooks[c][value & subclassMask];
+			value >>= subclassBits;
+			y[offset + d] = 0;
+			if (book >= 0) {
+				y[offset + d] = _decodeEntry(vorbis.codebooks[book], br);
+				if (y[offset + d] < 0)
+					return false;
+			}
+		}
+		offset += floor.classDimensions[c];
+	}
+	return !br.eop;
+}
+
+static int _renderPoint(int x0, int y0, int x1, int y1, int x)
+{
+	int dy = y1 - y0, adx = x1 - x0;
+	if (adx <= 0)
+		return y0;
+	int ady = dy < 0 ? -dy : dy;
+	int offset = ady * (x - x0) / adx;
+	return dy < 0 ? y0 - offset : y0 + offset;
+}
+
+//+ Spectrum [x0,x1) times the floor line from (x0,y0) to (x1,y1), integer Bresenham steps
+static void _renderLine(int x0, int y0, int x1, int y1, float* spectrum, int half)
+{
+	int dy = y1 - y0, adx = x1 - x0;
+	if (adx <= 0)
+		return;
+
+	int ady = dy < 0 ? -dy : dy;
+	int base = dy / adx;
+	int sy = dy < 0 ? base - 1 : base + 1;
+	ady -= (base < 0 ? -base : base) * adx;
+
+	int y = y0, err = 0;
+	int end = x1 < half ? x1 : half;
+	for (int x = x0; x < end; x++) {
+		if (x > x0) {
+			err += ady;
+			if (err >= adx) {
+				err -= adx;
+				y += sy;
+			}
+			else {
+				y += base;
+			}
+		}
+		spectrum[x] *= cdt_vorbis_inverse_db[y < 0 ? 0 : y > 255 ? 255 : y];
+	}
+}
+
+//+ Unwrap the values predicted from their neighbours, then multiply the spectrum by the curve
+static void _renderFloor(const CDTVorbisFloor &floor, const int* y, float* spectrum, int half)
+{
+	static const int ranges[4] = { 256, 128, 86, 64 };
+	int range = ranges[floor.multiplier - 1];
+	int finalY[VORBIS_MAX_FLOOR_VALUE];
+	bool step2[VORBIS_MAX_FLOOR_VALUE];
+
+	finalY[0] = y[0];
+	finalY[1] = y[1];
+	step2[0] = true;
+	step2[1] = true;
+	for (int i = 2; i < floor.numValue; i++) {
+		int low = floor.low[i], high = floor.high[i];
+		int predicted = _renderPoint(floor.x[low], finalY[low], floor.x[high], finalY[high], floor.x[i]);
+		int value = y[i];
+		int highRoom = range - predicted, lowRoom = predicted;
+		int room = (highRoom < lowRoom ? highRoom : lowRoom) * 2;
+
+		step2[i] = value != 0;
+		if (value == 0) {
+			finalY[i] = predicted;
+			continue;
+		}
+
+		step2[low] = true;
+		step2[high] = true;
+		if (value >= room)
+			finalY[i] = highRoom > lowRoom ? value - lowRoom + predicted : predicted - value + highRoom - 1;
+		else
+			finalY[i] = (value & 1) ? predicted - (value + 1) / 2 : predicted + value / 2;
+	}
+
+	int lx = 0, ly = finalY[0] * floor.multiplier, hx = 0, hy = 0;
+	for (int s = 1; s < floor.numValue; s++) {
+		int i = floor.sorted[s];
+		if (!step2[i])
+			continue;
+		hx = floor.x[i];
+		hy = finalY[i] * floor.multiplier;
+		_renderLine(lx, ly, hx, hy, spectrum, half);
+		lx = hx;
+		ly = hy;
+	}
+	if (hx < half)
+		_renderLine(hx, hy, half, hy, spectrum, half);
+}
+
+static bool _decodePartition(const CDTVorbisCodebook &book, int type, _BitReader &br, float* v, int size)
+{
+	if (book.values.empty())
+		return false;
+
+	int dimensions = book.dimensions;
+	if (type == 0) {
+		// the dimensions of a vector are interleaved over the partition
+		int step = size / dimensions;
+		for (int i = 0; i < step; i++) {
+			int entry = _decodeEntry(book, br);
+			if (entry < 0)
+				return false;
+			const float* values = &book.values[(size_t)entry * dimensions];
+			for (int d = 0; d < dimensions; d++)
+				v[i + d * step] += values[d];
+		}
+		return true;
+	}
+
+	for (int i = 0; i < size;) {
+		int entry = _decodeEntry(book, br);
+		if (entry < 0)
+			return false;
+		const float* values = &book.values[(size_t)entry * dimensions];
+		for (int d = 0; d < dimensions && i < size; d++)
+			v[i++] += values[d];
+	}
+	return true;
+}
+
+//+ Residue vectors of size values, the decode stops at the end of the packet
+static void _decodeResidueVectors(CDTVorbis &vorbis, const CDTVorbisResidue &residue, int type, _BitReader &br, float** vectors, const bool* skip, int numVector, int size)
+{
+	int begin = residue.begin < size ? residue.begin : size;
+	int end = residue.end < size ? residue.end : size;
+	int numPartition = (end - begin) / residue.partitionSize;
+	if (numPartition <= 0)
+		return;
+
+	const CDTVorbisCodebook &classbook = vorbis.codebooks[residue.classbook];
+	int perCodeword = classbook.dimensions;
+	if (vorbis.classifications.size() < (size_t)numVector * numPartition)
+		vorbis.classifications.resize((size_t)numVector * numPartition);
+	int* classifications = &vorbis.classifications[0];
+
+	for (int pass = 0; pass < 8; pass++) {
+		for (int p = 0; p < numPartition;) {
+			// 1 classbook codeword gives the classes of the next perCodeword partitions
+			if (pass == 0) {
+				for (int j = 0; j < numVector; j++) {
+					if (skip[j])
+						continue;
+					int value = _decodeEntry(classbook, br);
+					if (value < 0)
+						return;
+					for (int i = perCodeword - 1; i >= 0; i--) {
+						if (p + i < numPartition)
+							classifications[j * numPartition + p + i] = value % residue.numClassification;
+						value /= residue.numClassification;
+					}
+				}
+			}
+
+			for (int i = 0; i < perCodeword && p < numPartition; i++, p++) {
+				for (int j = 0; j < numVector; j++) {
+					if (skip[j])
+						continue;
+					int book = residue.books[classifications[j * numPartition + p]][pass];
+					if (book < 0)
+						continue;
+					float* v = vectors[j] + begin + p * residue.partitionSize;
+					if (!_decodePartition(vorbis.codebooks[book], type, br, v, residue.partitionSize))
+						return;
+				}
+			}
+		}
+	}
+}
+
+static void _decodeResidue(CDTVorbis &vorbis, const CDTVorbisResidue &residue, _BitReader &br, float** vectors, const bool* skip, int numVector, int half)
+{
+	if (residue.type != 2) {
+		_decodeResidueVectors(vorbis, residue, residue.type, br, vectors, skip, numVector, half);
+		return;
+	}
+
+	// type 2: the channels are interleaved in 1 vector, decoded unless every channel is skipped
+	bool any = false;
+	for (int j = 0; j < numVector; j++)
+		any = any || !skip[j];
+	if (!any)
+		return;
+
+	int size = half * numVector;
+	vorbis.interleaved.assign(size, 0.0f);
+	float* interleaved = &vorbis.interleaved[0];
+	bool decode = false;
+	_decodeResidueVectors(vorbis, residue, 1, br, &interleaved, &decode, 1, size);
+
+	for (int j = 0; j < numVector; j++) {
+		for (int i = 0; i < half; i++)
+			vectors[j][i] = interleaved[i * numVector + j];
+	}
+}
+
+//+ In place complex FFT of count values, re/im pairs
+static void _fft(float* z, int count, const int* bitReverse, const float* twiddle)
+{
+	for (int i = 0; i < count; i++) {
+		int j = bitReverse[i];
+		if (j > i) {
+			float re = z[i * 2], im = z[i * 2 + 1];
+			z[i * 2] = z[j * 2];
+			z[i * 2 + 1] = z[j * 2 + 1];
+			z[j * 2] = re;
+			z[j * 2 + 1] = im;
+		}
+	}
+
+	for (int length = 2; length <= count; length <<= 1) {
+		int half = length / 2, stride = count / length;
+		for (int i = 0; i < count; i += length) {
+			for (int k = 0; k < half; k++) {
+				float wr = twiddle[k * stride * 2], wi = twiddle[k * stride * 2 + 1];
+				float* a = z + (i + k) * 2;
+				float* b = z + (i + k + half) * 2;
+				float br = b[0] * wr - b[1] * wi, bi = b[0] * wi + b[1] * wr;
+				b[0] = a[0] - br;
+				b[1] = a[1] - bi;
+				a[0] += br;
+				a[1] += bi;
+			}
+		}
+	}
+}
+
+//+ n output samples of the n/2 spectrum values, the spectrum is overwritten
+//	- DCT-IV u of the spectrum, then the IMDCT is u unfolded:
+//	  [u(n/4..n/2), -u reversed, -u(0..n/4)]
+static void _imdct(const CDTVorbis &vorbis, int b, float* spectrum, float* out)
+{
+	int n = vorbis.blockSize[b];
+	int half = n / 2, quarter = n / 4;
+	const float* twiddle = &vorbis.twiddle[b][0];
+	float* z = out;
+
+	for (int k = 0; k < quarter; k++) {
+		float re = spectrum[k * 2], im = spectrum[half - 1 - k * 2];
+		float wr = twiddle[k * 2], wi = twiddle[k * 2 + 1];
+		z[k * 2] = re * wr - im * wi;
+		z[k * 2 + 1] = re * wi + im * wr;
+	}
+
+	_fft(z, quarter, &vorbis.bitReverse[b][0], twiddle + half * 2);
+
+	float* u = spectrum;
+	for (int k = 0; k < quarter; k++) {
+		float wr = twiddle[half + k * 2], wi = twiddle[half + k * 2 + 1];
+		u[k * 2] = z[k * 2] * wr - z[k * 2 + 1] * wi;
+		u[half - 1 - k * 2] = -(z[k * 2] * wi + z[k * 2 + 1] * wr);
+	}
+
+	for (int i = 0; i < quarter; i++)
+		out[i] = u[i + quarter];
+	for (int i = quarter; i < quarter * 3; i++)
+		out[i] = -u[quarter * 3 - 1 - i];
+	for (int i = quarter * 3; i < n; i++)
+		out[i] = -u[i - quarter * 3];
+}
+
+//+ Decode the packet, the finished frames are put in output
+//	- return the frame count, 0 for the first packet (it only fills
+//	  the overlap), -1 if it isn't an audio packet or doesn't decode
+static int _decodePacket(CDTVorbis &vorbis, bool last)
+{
+	_BitReader br = { vorbis.packet.data(), vorbis.packet.size(), 0, false };
+	if (vorbis.packet.empty() || _readBits(br, 1) != 0)
+		return -1;
+
+	int modeIndex = (int)_readBits(br, _ilog((uint32_t)vorbis.modes.size() - 1));
+	if (modeIndex >= (int)vorbis.modes.size())
+		return -1;
+	const CDTVorbisMode &mode = vorbis.modes[modeIndex];
+	const CDTVorbisMapping &mapping = vorbis.mappings[mode.mapping];
+
+	int b = mode.blockFlag;
+	int n = vorbis.blockSize[b], half = n / 2;
+	bool prevLong = false, nextLong = false;
+	if (b) {
+		prevLong = _readBits(br, 1) != 0;
+		nextLong = _readBits(br, 1) != 0;
+	}
+	if (br.eop)
+		return -1;
+
+	int channels = vorbis.channels;
+	int maxHalf = vorbis.blockSize[1] / 2;
+	bool floorUsed[VORBIS_MAX_CHANNEL];
+	bool skip[VORBIS_MAX_CHANNEL];
+	float* vectors[VORBIS_MAX_CHANNEL];
+
+	for (int c = 0; c < channels; c++) {
+		const CDTVorbisFloor &floor = vorbis.floors[mapping.submapFloor[mapping.mux[c]]];
+		floorUsed[c] = _decodeFloor(vorbis, floor, br, &vorbis.floorY[c * VORBIS_MAX_FLOOR_VALUE]);
+		skip[c] = !floorUsed[c];
+		memset(&vorbis.spectrum[(size_t)c * maxHalf], 0, half * sizeof(float));
+	}
+
+	// coupled channels are decoded if either of them has a floor
+	for (int s = 0; s < mapping.numCoupling; s++) {
+		if (!skip[mapping.magnitude[s]] || !skip[mapping.angle[s]]) {
+			skip[mapping.magnitude[s]] = false;
+			skip[mapping.angle[s]] = false;
+		}
+	}
+
+	for (int s = 0; s < mapping.numSubmap; s++) {
+		bool submapSkip[VORBIS_MAX_CHANNEL];
+		int numVector = 0;
+		for (int c = 0; c < channels; c++) {
+			if (mapping.mux[c] != s)
+				continue;
+			vectors[numVector] = &vorbis.spectrum[(size_t)c * maxHalf];
+			submapSkip[numVector++] = skip[c];
+		}
+		_decodeResidue(vorbis, vorbis.residues[mapping.submapResidue[s]], br, vectors, submapSkip, numVector, half);
+	}
+
+	// square polar to cartesian, the steps are undone last to first
+	for (int s = mapping.numCoupling - 1; s >= 0; s--) {
+		float* magnitude = &vorbis.spectrum[(size_t)mapping.magnitude[s] * maxHalf];
+		float* angle = &vorbis.spectrum[(size_t)mapping.angle[s] * maxHalf];
+		for (int i = 0; i < half; i++) {
+			float m = magnitude[i], a = angle[i];
+			if (m > 0.0f) {
+				if (a > 0.0f) {
+					angle[i] = m - a;
+				}
+				else {
+					angle[i] = m;
+					magnitude[i] = m + a;
+				}
+			}
+			else {
+				if (a > 0.0f) {
+					angle[i] = m + a;
+				}
+				else {
+					angle[i] = m;
+					magnitude[i] = m - a;
+				}
+			}
+		}
+	}
+
+	// window of the block, the slopes are short next to a short block
+	int shortSize = vorbis.blockSize[0];
+	int leftStart = 0, leftSize = half, leftWindow = b;
+	int rightStart = half, rightSize = half, rightWindow = b;
+	if (b && !prevLong) {
+		leftStart = n / 4 - shortSize / 4;
+		leftSize = shortSize / 2;
+		leftWindow = 0;
+	}
+	if (b && !nextLong) {
+		rightStart = n * 3 / 4 - shortSize / 4;
+		rightSize = shortSize / 2;
+		rightWindow = 0;
+	}
+
+	for (int c = 0; c < channels; c++) {
+		float* spectrum = &vorbis.spectrum[(size_t)c * maxHalf];
+		float* block = &vorbis.block[(size_t)c * maxHalf * 2];
+		if (floorUsed[c]) {
+			const CDTVorbisFloor &floor = vorbis.floors[mapping.submapFloor[mapping.mux[c]]];
+			_renderFloor(floor, &vorbis.floorY[c * VORBIS_MAX_FLOOR_VALUE], spectrum, half);
+		}
+		else {
+			memset(spectrum, 0, half * sizeof(float));
+		}
+
+		_imdct(vorbis, b, spectrum, block);
+
+		const float* left = &vorbis.window[leftWindow][0];
+		const float* right = &vorbis.window[rightWindow][0];
+		for (int i = 0; i < leftStart; i++)
+			block[i] = 0.0f;
+		for (int i = 0; i < leftSize; i++)
+			block[leftStart + i] *= left[i];
+		for (int i = 0; i < rightSize; i++)
+			block[rightStart + i] *= right[rightSize - 1 - i];
+		for (int i = rightStart + rightSize; i < n; i++)
+			block[i] = 0.0f;
+	}
+
+	// the frames from the center of the last block to the center of this one are finished
+	int prevSize = vorbis.prevSize;
+	int count = prevSize > 0 ? prevSize / 4 + n / 4 : 0;
+	int offset = prevSize / 4 - n / 4;
+	for (int c = 0; c < channels; c++) {
+		const float* overlap = &vorbis.overlap[(size_t)c * maxHalf];
+		const float* block = &vorbis.block[(size_t)c * maxHalf * 2];
+		float* output = &vorbis.output[(size_t)c * maxHalf];
+		for (int i = 0; i < count; i++) {
+			int j = i - offset;
+			float s = i < prevSize / 2 ? overlap[i] : 0.0f;
+			if (j >= 0 && j < half)
+				s += block[j];
+			output[i] = s;
+		}
+		memcpy(&vorbis.overlap[(size_t)c * maxHalf], block + half, half * sizeof(float));
+	}
+	vorbis.prevSize = n;
+
+	// the last page tells where the stream really ends
+	if (last && vorbis.pageGranule >= 0 && vorbis.numDecoded + count > vorbis.pageGranule)
+		count = vorbis.pageGranule > vorbis.numDecoded ? (int)(vorbis.pageGranule - vorbis.numDecoded) : 0;
+	vorbis.numDecoded += count;
+	return count;
+}
+
+
+// -------------------------------------------
+// Vorbis functions
+// -------------------------------------------
+
+bool VorbisOpen(CDTVorbis &vorbis, const unsigned char* data, size_t size)
+{
+	vorbis.data = data;
+	vorbis.size = size;
+	vorbis.channels = 0;
+	vorbis.rate = 0;
+	vorbis.numSegment = 0;
+	vorbis.segment = 0;
+	if (size < VORBIS_PAGE_HEADER || memcmp(data, "OggS", 4) != 0)
+		return false;
+
+	// the stream of the first page
+	vorbis.serial = _read32(data + 14);
+	vorbis.nextPage = 0;
+
+	bool last;
+	for (int h = 0; h < 3; h++) {
+		if (!_nextPacket(vorbis, last))
+			return false;
+
+		static const int types[3] = { 1, 3, 5 };
+		_BitReader br = { vorbis.packet.data(), vorbis.packet.size(), 0, false };
+		if (vorbis.packet.size() < 7 || (int)_readBits(br, 8) != types[h] || memcmp(&vorbis.packet[1], "vorbis", 6) != 0)
+			return false;
+		br.pos += 6 * 8;
+
+		if (h == 0) {
+			uint32_t version = _readBits(br, 32);
+			vorbis.channels = (int)_readBits(br, 8);
+			vorbis.rate = (int)_readBits(br, 32);
+			_readBits(br, 32);						// bitrates
+			_readBits(br, 32);
+			_readBits(br, 32);
+			vorbis.blockSize[0] = 1 << _readBits(br, 4);
+			vorbis.blockSize[1] = 1 << _readBits(br, 4);
+			bool framing = _readBits(br, 1) != 0;
+			if (version != 0 || vorbis.channels == 0 || vorbis.rate <= 0 || !framing || br.eop ||
+				vorbis.blockSize[0] < 64 || vorbis.blockSize[0] > vorbis.blockSize[1] || vorbis.blockSize[1] > 8192)
+				return false;
+		}
+		else if (h == 2 && !_readSetup(vorbis, br)) {
+			return false;
+		}
+	}
+
+	// the audio starts on a new page
+	vorbis.audioStart = vorbis.nextPage;
+	_initTransform(vorbis, 0);
+	_initTransform(vorbis, 1);
+
+	int maxHalf = vorbis.blockSize[1] / 2;
+	vorbis.spectrum.assign((size_t)maxHalf * vorbis.channels, 0.0f);
+	vorbis.block.assign((size_t)maxHalf * 2 * vorbis.channels, 0.0f);
+	vorbis.overlap.assign((size_t)maxHalf * vorbis.channels, 0.0f);
+	vorbis.output.assign((size_t)maxHalf * vorbis.channels, 0.0f);
+	vorbis.floorY.assign((size_t)VORBIS_MAX_FLOOR_VALUE * vorbis.channels, 0);
+	VorbisRewind(vorbis);
+	return true;
+}
+
+void VorbisClose(CDTVorbis &vorbis)
+{
+	vorbis.data = NULL;
+	vorbis.size = 0;
+	vorbis.packet.clear();
+	vorbis.packet.shrink_to_fit();
+	vorbis.codebooks.clear();
+	vorbis.floors.clear();
+	vorbis.residues.clear();
+	vorbis.mappings.clear();
+	vorbis.modes.clear();
+	for (int b = 0; b < 2; b++) {
+		vorbis.window[b].clear();
+		vorbis.twiddle[b].clear();
+		vorbis.bitReverse[b].clear();
+	}
+	vorbis.spectrum.clear();
+	vorbis.block.clear();
+	vorbis.overlap.clear();
+	vorbis.output.clear();
+	vorbis.floorY.clear();
+	vorbis.classifications.clear();
+	vorbis.interleaved.clear();
+}
+
+int VorbisDecode(CDTVorbis &vorbis, int16_t* out, int numFrame)
+{
+	int maxHalf = vorbis.blockSize[1] / 2;
+	int n = 0;
+
+	while (n < numFrame) {
+		if (vorbis.outPos == vorbis.outEnd) {
+			bool last;
+			if (!_nextPacket(vorbis, last))
+				break;
+
+			// a packet that doesn't decode is dropped
+			int count = _decodePacket(vorbis, last);
+			vorbis.outPos = 0;
+			vorbis.outEnd = count > 0 ? count : 0;
+			continue;
+		}
+
+		int count = vorbis.outEnd - vorbis.outPos;
+		if (count > numFrame - n)
+			count = numFrame - n;
+		for (int c = 0; c < vorbis.channels; c++) {
+			const float* output = &vorbis.output[(size_t)c * maxHalf + vorbis.outPos];
+			int16_t* dst = out + (size_t)n * vorbis.channels + c;
+			for (int i = 0; i < count; i++) {
+				float s = floorf(output[i] * 32768.0f + 0.5f);
+				dst[(size_t)i * vorbis.channels] = (int16_t)(s > 32767.0f ? 32767.0f : s < -32768.0f ? -32768.0f : s);
+			}
+		}
+		vorbis.outPos += count;
+		n += count;
+	}
+	return n;
+}
+
+void VorbisRewind(CDTVorbis &vorbis)
+{
+	vorbis.nextPage = vorbis.audioStart;
+	vorbis.numSegment = 0;
+	vorbis.segment = 0;
+	vorbis.prevSize = 0;
+	vorbis.numDecoded = 0;
+	vorbis.outPos = 0;
+	vorbis.outEnd = 0;
+}
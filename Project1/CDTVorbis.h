@@ -0,0 +1,138 @@
+
+#ifndef CDT_VORBIS
+#define CDT_VORBIS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+
+// -------------------------------------------
+// CDT Ogg Vorbis decoder
+//	- Vorbis I audio from an Ogg file in memory, ex. a mapped asset,
+//	  decoded a packet at a time: the file is never copied, only the
+//	  packet being decoded and 1 block per channel are kept
+//	- the first logical stream of the file is decoded, pages of other
+//	  streams are skipped
+//	- floor 1 only, floor 0 is not written by any Vorbis encoder since
+//	  1.0 (VorbisOpen fails on it)
+//	- the page CRC is not checked, a packet that doesn't decode is
+//	  dropped and the decode goes on with the next one
+//	- the samples are trimmed to the granule position of the last page,
+//	  the same length as libvorbisfile
+// -------------------------------------------
+
+struct CDTVorbisCodebook
+{
+	int						dimensions;
+	int						entries;
+	std::vector<int>		tree;				// 2 children per node, < 0 leaf -(entry + 1), 0 none
+	std::vector<float>		values;				// dimensions per entry, empty without VQ lookup
+};
+
+struct CDTVorbisFloor
+{
+	int						numPartition;
+	int						partitionClass[32];
+	int						classDimensions[16];
+	int						classSubclasses[16];
+	int						classMasterbook[16];
+	int						subclassBooks[16][8];	// -1 = no book
+	int						multiplier;
+	int						numValue;
+	int						x[65];
+	int						sorted[65];			// x index by increasing x
+	int						low[65];			// neighbours of x[i] among x[0..i-1]
+	int						high[65];
+};
+
+struct CDTVorbisResidue
+{
+	int						type;
+	int						begin;
+	int						end;
+	int						partitionSize;
+	int						numClassification;
+	int						classbook;
+	int						books[64][8];		// by classification and pass, -1 = no book
+};
+
+struct CDTVorbisMapping
+{
+	int						numCoupling;
+	int						magnitude[256];
+	int						angle[256];
+	int						mux[256];			// submap of each channel
+	int						submapFloor[16];
+	int						submapResidue[16];
+	int						numSubmap;
+};
+
+struct CDTVorbisMode
+{
+	int						blockFlag;
+	int						mapping;
+};
+
+struct CDTVorbis
+{
+	int						channels;
+	int						rate;
+
+	// the Ogg file
+	const unsigned char*	data;
+	size_t					size;
+	uint32_t				serial;
+	size_t					audioStart;			// first page after the headers
+	size_t					pagePos;			// page of the next packet
+	size_t					nextPage;
+	size_t					bodyPos;			// next segment of the page
+	int						numSegment;
+	int						segment;
+	int64_t					pageGranule;
+	bool					lastPage;
+	std::vector<unsigned char>	packet;
+
+	// setup header
+	int						blockSize[2];
+	std::vector<CDTVorbisCodebook>	codebooks;
+	std::vector<CDTVorbisFloor>		floors;
+	std::vector<CDTVorbisResidue>	residues;
+	std::vector<CDTVorbisMapping>	mappings;
+	std::vector<CDTVorbisMode>		modes;
+
+	// transform tables of the 2 block sizes
+	std::vector<float>		window[2];			// rising half of the window
+	std::vector<float>		twiddle[2];			// cos/sin pairs: DCT-IV pre and post rotation, FFT
+	std::vector<int>		bitReverse[2];
+
+	// decode state
+	std::vector<float>		spectrum;			// blockSize[1] / 2 per channel
+	std::vector<float>		block;				// blockSize[1] per channel, windowed output
+	std::vector<float>		overlap;			// blockSize[1] / 2 per channel, right half of the last block
+	std::vector<float>		output;				// blockSize[1] / 2 per channel, frames of the last packet
+	std::vector<int>		floorY;				// 65 per channel
+	std::vector<int>		classifications;
+	std::vector<float>		interleaved;		// residue 2 vector of all the channels
+	int						prevSize;			// 0 before the first packet
+	int64_t					numDecoded;			// frames handed out since the start
+	int						outPos;				// frames of the last packet not handed out yet
+	int						outEnd;
+};
+
+// -------------------------------------------
+// Vorbis functions
+// -------------------------------------------
+
+// read the 3 headers, data must stay valid until VorbisClose
+bool VorbisOpen(CDTVorbis &vorbis, const unsigned char* data, size_t size);
+void VorbisClose(CDTVorbis &vorbis);
+
+// up to numFrame interleaved frames in out, return the frame count, 0 at the end of the stream
+int  VorbisDecode(CDTVorbis &vorbis, int16_t* out, int numFrame);
+
+// back to the first frame
+void VorbisRewind(CDTVorbis &vorbis);
+
+
+#endif
@@ -1,12 +1,25 @@
 
 #include "GameStateLevel1.h"
 #include "CDT.h"
+#include "CDTPipeline.h"
+#include "CDTJobs.h"
+#include "CDTPhysics.h"
+#include "CDTSpatialGrid.h"
+#include "CDTCollision.h"
+#include "CDTOverlap.h"
+#include "CDTRaycast.h"
+#include "CDTLevel.h"
+#include "CDTStream.h"
+#include "CDTLoadGraph.h"
+#include "CDTResource.h"
+#include "CDTRenderQueue.h"
+#include "CDTAudio.h"
+#include "CDTParticle.h"
 #include <iostream>
-#include <fstream>
 #include <string>
-#include <irrKlang.h>
 #include <cmath>
-using namespace irrklang;
+#include <cstring>
+#include <algorithm>
 
 // -------------------------------------------
 // Defines
@@ -14,6 +27,13 @@ using namespace irrklang;
 
 #define MESH_MAX					32				// The total number of Mesh (Shape)
 #define TEXTURE_MAX					32				// The total number of texture
+#define SOUND_MAX					2				// The total number of sound
+#define SOUND_COIN					0				// index in sSoundFiles
+#define SOUND_JUMP					1
+#define MUSIC_FILE					"mario_level.ogg"	// streamed, not in the sound bank
+#define COIN_SOUND_MAX				4				// coin sounds at once, a row of coins restarts the oldest
+#define COIN_SOUND_PRIORITY			1
+#define JUMP_SOUND_PRIORITY			2
 #define GAME_OBJ_INST_MAX			1024			// The total number of different game object instances
 #define PLAYER_INITIAL_NUM			3				// initial number of player lives
 #define FLAG_INACTIVE				0
@@ -22,16 +42,30 @@ using namespace irrklang;
 #define ANIMATION_SPEED				60				// 1 = fastest (update every frame)
 #define WINDOW_WIDTH				1200
 #define WINDOW_HEIGHT				800
+#define LEVEL_FILE					"map2.lvl"		// binary level, rebuilt from LEVEL_TEXT_FILE when it changes
+#define LEVEL_TEXT_FILE				"map2.txt"
+#define STREAM_RADIUS				2				// chunks kept around the camera, in chunks
+#define STREAM_BUDGET				32				// max chunks in memory, at least (2 * STREAM_RADIUS + 1)^2
+#define TILE_TYPE_MAX				4				// background tiles 1-4 of level.png
+#define MAP_DEPTH					0.0f			// the objects are drawn over the map
+#define OBJECT_DEPTH				1.0f
+#define OBJECT_DEPTH_STEP			0.001f			// a later object is drawn over an earlier one
+#define MAP_LAYER_DEPTH_STEP		0.001f			// an upper map layer is drawn over a lower one
 
 
 // shooting
 #define BULLET_LIFESPAN				5				// 5s
 #define BULLET_SPEED				12			
 #define PLAYER_FIRE_COOLDOWN		0.25f			// 4 bullet per 1 sec		
+#define EXPLOSION_PARTICLE_NUM		24				// particles of an enemy explosion
+#define MUZZLE_PARTICLE_NUM			6				// particles of a muzzle flash
+#define PARTICLE_MAX				16384			// alive particles of an effect at most
+#define PARTICLE_FRAME_NUM			9				// frames of the particle sprite sheet
 #define PATROL_FIRE_COOLDOWN		1.f			
 #define PATROL_BULLET_SPEED			5	
 #define SNIPER_FIRE_COOLDOWN		2.f			
-#define SNIPER_BULLET_SPEED			10	
+#define SNIPER_BULLET_SPEED			10
+#define SIGHT_REFRESH_FRAMES		4				// line of sight to the player is cast every 4 frames per enemy
 
 
 // Movement flags
@@ -46,6 +80,7 @@ using namespace irrklang;
 #define	COLLISION_RIGHT				1<<1      // 0001 -> 0010 = 2
 #define	COLLISION_TOP				1<<2       //0001 -> 0100 = 4
 #define	COLLISION_BOTTOM			1<<3      // 0001 -> 1000 = 8
+#define BODY_HALF_SIZE				0.5f			// half size of the player/enemy box against the map
 
 
 enum GAMEOBJ_TYPE
@@ -97,7 +132,10 @@ struct GameObj
 	glm::vec3		velocity;			// usually we will use only x and y
 	glm::vec3		scale;				// usually we will use only x and y
 	float			orientation;		// 0 radians is 3 o'clock, PI/2 radian is 12 o'clock
-	glm::mat4		modelMatrix;		// transform from model space [-0.5,0.5] to map space [0,MAP_SIZE]
+	CDTAffine2D		modelTransform;		// transform from model space [-0.5,0.5] to map space [0,MAP_SIZE]
+	glm::vec3		xformPosition;		// position, scale, orientation that modelTransform was built from
+	glm::vec3		xformScale;
+	float			xformOrientation;
 	int				mapCollsionFlag;	// for testing collision detection with map
 	bool			jumping;			// Is Player jumping or on the ground
 	bool			playerOwn;			// true if ignore player's collision
@@ -117,6 +155,8 @@ struct GameObj
 	//state machine data
 	enum STATE			state;
 	float			shootCooldown;
+	long			sightFrame;			// frame seesPlayer was cast on, -1 before the first cast
+	bool			seesPlayer;			// cached line of sight to the player
 	/*
 	enum INNER_STATE	innerState;
 	double				counter;		// use in state machine
@@ -124,11 +164,35 @@ struct GameObj
 
 };
 
-struct AABB {
-	float x;
-	float y;
-	float w;
-	float h;
+// per-frame data passed to every stage of the update pipeline
+//	- the player is copied here, so parallel stages never read the player while it moves
+struct Level1UpdateCtx {
+	float			dt;
+	long			frame;
+	bool			playerActive;
+	glm::vec3		playerPosition;
+};
+
+// spawn/destroy requested by parallel stages, applied after the pass
+enum COMMAND_TYPE
+{
+	COMMAND_SPAWN_BULLET,
+	COMMAND_DESTROY
+};
+
+// a texture of the load graph, decoded then uploaded
+struct Level1TextureLoad {
+	CDTTex*			tex;
+	const char*		filename;
+	CDTImage		image;
+	uint64_t		hash;				// of the pixels, for the resource cache
+};
+
+struct Level1Command {
+	int				type;				// enum COMMAND_TYPE
+	int				source;				// index of the object that made the command
+	glm::vec3		position;
+	glm::vec3		velocity;
 };
 
 
@@ -152,6 +216,20 @@ static int			sRespawnCountdown;								// Respawn player waiting time (in #frame
 static int			sMortalCountdown;
 static float		sShootingCooldown = 0;
 
+// Update pipeline, stages are declared in GameStateLevel1Load
+static CDTPipeline	sUpdatePipeline;
+static std::vector<Level1Command>	sCommandBuffer[CDT_JOB_MAX_WORKER];	// 1 buffer per worker, no lock needed
+
+// Broadphase of player/enemy/item, keyed on map cells, bullets query it
+static CDTSpatialGrid	sObjGrid;
+static std::vector<int>	sGridResult;								// broadphase candidates, sorted by map index
+
+// Narrowphase, the candidates gathered as SoA for OverlapBoxBatch
+static float		sCandX[GAME_OBJ_INST_MAX], sCandY[GAME_OBJ_INST_MAX];
+static float		sCandHalfW[GAME_OBJ_INST_MAX], sCandHalfH[GAME_OBJ_INST_MAX];
+static uint32_t		sCandHit[GAME_OBJ_INST_MAX / 32];				// bit n set if sGridResult[n] overlaps
+static uint8_t		sCandSide[GAME_OBJ_INST_MAX];					// collision flags of sGridResult[n]
+
 
 /*
 	mapping of player's animation
@@ -184,17 +262,37 @@ static AnimationSprite patrolAnimations[3];
 static AnimationSprite sniperAnimations[2];
 
 //Sound
-ISoundEngine* SoundEngine;
+static int			sSoundIds[SOUND_MAX];							// in the audio bank, -1 if not loaded
+static int			sMusicStream = -1;
+
+// Particles, effects are not game objects
+static CDTParticleSystem	sParticles;
+static CDTTex*		sParticleTex;
+static int			sExplosionParticle;
+static int			sMuzzleParticle;
 
 // Map data
-static int** sMapData;										// sMapData[Height][Width]
-static int** sMapCollisionData;
+static CDTLoadGraph	sLoadGraph;										// tasks of GameStateLevel1Preload
+static std::vector<Level1TextureLoad>	sTextureLoads;					// textures queued for the load graph
+static const char*	sSoundFiles[SOUND_MAX] = { "coin.wav", "jump.wav" };
+static CDTLevel		sLevel;											// mapped level file, the map data below are views on it
+static CDTBitGrid	sMapCollision;									// 1 bit per tile, row 0 is the bottom of the map
+static CDTColliderTree	sMapColliders;								// sMapCollision merged into rects, used by the moves
+static CDTWorldStream	sWorldStream;								// tiles of the chunks around the camera, drawn from these
+static std::vector<int>	sChunkSpawnFirst;							// spawns of chunk c are sChunkSpawn[first[c], first[c + 1])
+static std::vector<int>	sChunkSpawn;
+static std::vector<bool>	sChunkSpawned;								// the spawns of the chunk were created once
+static std::vector< std::vector<GameObj> >	sChunkSuspended;		// objects of the chunks that are not resident
+static std::vector<CDTMesh>	sChunkMesh;								// tiles of each resident chunk, vaoHandle 0 if none
+static std::vector<int>	sChunkMaterial;								// the least opaque material of the tiles of the chunk
 static int			MAP_WIDTH;
 static int			MAP_HEIGHT;
-static glm::mat4	sMapMatrix;										// Transform from map space [0,MAP_SIZE] to screen space [-width/2,width/2]
+static CDTAffine2D	sMapTransform;									// Transform from map space [0,MAP_SIZE] to screen space [-width/2,width/2]
 static CDTMesh* sMapMesh;										// Mesh & Tex of the level, we only need 1 of these
 static CDTTex* sMapTex;
 static float		sMapOffset;
+static int			sTileMaterial[TILE_TYPE_MAX];					// from the alpha of level.png, alpha tested until known
+static CDTRenderQueue	sRenderQueue;
 
 // Camera
 static glm::vec2	sCamPosition(0.f, 0.f);
@@ -203,86 +301,6 @@ static int			VIEW_HEIGHT = 10;
 
 
 
-// -----------------------------------------------------
-// Map functions
-// -----------------------------------------------------
-
-
-int _detectCollisionAABB(AABB a, AABB b) {
-	int result = 0;
-
-	float dx = a.x - b.x; // Calculate the distance between the centers of the two boxes along the x-axis
-	float dy = a.y - b.y; // Calculate the distance between the centers of the two boxes along the y-axis
-
-	float combinedHalfWidths = a.w / 2 + b.w / 2; // Calculate the sum of the half-widths of the two boxes
-	float combinedHalfHeights = a.h / 2 + b.h / 2; // Calculate the sum of the half-heights of the two boxes
-
-	if (std::abs(dx) < combinedHalfWidths && std::abs(dy) < combinedHalfHeights) { // Check for collision
-		float overlapX = combinedHalfWidths - std::abs(dx); // Calculate the overlap along the x-axis
-		float overlapY = combinedHalfHeights - std::abs(dy); // Calculate the overlap along the y-axis
-
-		// Determine the direction of the collision based on the overlap
-		result |= dx > 0 ? 1 : 2;
-		result |= dy > 0 ? 8 : 4;
-	}
-
-	return result;
-}
-
-//+ This fucntion return collison flags
-//	- 1-left, 2-right, 4-top, 8-bottom 
-//	- each side is checked with 2 hot spots
-int CheckMapCollision(float PosX, float PosY, bool& inTheAir) {
-	int result = 0;
-	int mapCoorX = floor(PosX), mapCoorY = floor(MAP_HEIGHT - PosY);
-
-
-	// Loop checking collision in pattern of
-	//   x
-	// x x x
-	//   x
-	for (size_t y = mapCoorY - 1; y <= mapCoorY + 1; y++)
-	{
-		if (y < 0 || y >= MAP_HEIGHT) continue;
-
-		for (size_t x = mapCoorX - 1; x <= mapCoorX + 1; x++)
-		{
-			if (y != mapCoorY && x != mapCoorX) continue;
-			if (x < 0 || x >= MAP_WIDTH || !sMapCollisionData[y][x]) continue;
-
-			int _result = _detectCollisionAABB({ PosX, PosY , 1.f, 1.f }, { (float)x + .5f, MAP_HEIGHT - (float)y - .5f, 1.f, 1.f });
-
-			// If check bottom/top collision, ignore x axis
-			if (y == mapCoorY + 1 && _result & COLLISION_BOTTOM)
-				result |= 8;
-			else if (y == mapCoorY - 1 && _result & COLLISION_TOP)
-				result |= 4;
-
-			// If check right/left colliosn, ignore y axis
-			else if (y == mapCoorY && _result & COLLISION_RIGHT)
-				result |= 2;
-			else if (y == mapCoorY && _result & COLLISION_LEFT)
-				result |= 1;
-			else
-				result |= _result;
-
-
-			//printf("Coor: %d %d\n", x, y);
-			//printf("Pos: %f %f\nAnd: %f %f\nCollision: %d\n", PosX, PosY, x + .5f, MAP_HEIGHT - (float)y - .5f, result);
-
-		}
-	}
-
-	// check if there is ground under player
-	if (mapCoorY + 1 >= 0 && mapCoorY + 1 < MAP_HEIGHT && mapCoorX >= 0 && mapCoorX < MAP_WIDTH && !sMapCollisionData[mapCoorY + 1][mapCoorX])
-		inTheAir = true;
-
-
-	return result;
-}
-
-
-
 // -------------------------------------------
 // Game object instant functions
 // -------------------------------------------
@@ -290,7 +308,22 @@ int CheckMapCollision(float PosX, float PosY, bool& inTheAir) {
 // functions to create/destroy a game object instance
 static GameObj* gameObjInstCreate(int type, glm::vec3 pos, glm::vec3 vel, glm::vec3 scale, float orient, bool anim, int numFrame, int currFrame, float offset);
 static void			gameObjInstDestroy(GameObj& pInst);
+static GameObj* gameObjInstRestore(const GameObj& saved);
+
+
+void ComputeModelTransform(GameObj* pInst) {
+	// translate * scale * rotate, rotate around z axis
+	pInst->modelTransform = AffineFromTRS(pInst->position.x, pInst->position.y, pInst->scale.x, pInst->scale.y, pInst->orientation);
+	pInst->xformPosition = pInst->position;
+	pInst->xformScale = pInst->scale;
+	pInst->xformOrientation = pInst->orientation;
+}
 
+bool IsModelTransformDirty(const GameObj* pInst) {
+	return pInst->position.x != pInst->xformPosition.x || pInst->position.y != pInst->xformPosition.y ||
+		pInst->scale.x != pInst->xformScale.x || pInst->scale.y != pInst->xformScale.y ||
+		pInst->orientation != pInst->xformOrientation;
+}
 
 GameObj* gameObjInstCreate(int type, glm::vec3 pos, glm::vec3 vel, glm::vec3 scale, float orient, bool anim, int numFrame, int currFrame, float offset)
 {
@@ -307,9 +340,10 @@ GameObj* gameObjInstCreate(int type, glm::vec3 pos, glm::vec3 vel, glm::vec3 sca
 			pInst->velocity = vel;
 			pInst->scale = scale;
 			pInst->orientation = orient;
-			pInst->modelMatrix = glm::mat4(1.0f);
 			pInst->mapCollsionFlag = 0;
 			pInst->jumping = false;
+			pInst->sightFrame = -1;
+			pInst->seesPlayer = false;
 			pInst->anim = anim;
 			pInst->numFrame = numFrame;
 			pInst->currFrame = currFrame;
@@ -318,6 +352,9 @@ GameObj* gameObjInstCreate(int type, glm::vec3 pos, glm::vec3 vel, glm::vec3 sca
 			pInst->offsetX = 0;
 			pInst->offsetY = 0;
 
+			// objects spawned during the update pipeline may not reach the matrix stage this frame
+			ComputeModelTransform(pInst);
+
 			sNumGameObj++;
 			return pInst;
 		}
@@ -335,6 +372,84 @@ void gameObjInstDestroy(GameObj& pInst)
 
 	sNumGameObj--;
 	pInst.flag = FLAG_INACTIVE;
+	GridRemove(sObjGrid, (int)(&pInst - sGameObjInstArray));
+}
+
+GameObj* gameObjInstRestore(const GameObj& saved)
+{
+	// put back an object saved by value (suspended with its chunk) in a free slot
+	for (int i = 0; i < GAME_OBJ_INST_MAX; i++) {
+		GameObj* pInst = sGameObjInstArray + i;
+		if (pInst->flag == FLAG_INACTIVE) {
+			*pInst = saved;
+			pInst->flag = FLAG_ACTIVE;
+			pInst->sightFrame = -1;			// the saved line of sight is stale, cast again on the next update
+			ComputeModelTransform(pInst);
+
+			sNumGameObj++;
+			return pInst;
+		}
+	}
+
+	return NULL;
+}
+
+
+
+// -----------------------------------------------------
+// Deferred commands
+//	- parallel stages cannot touch the object pool directly
+//	- commands are sorted by source object before being applied,
+//	  so the result does not depend on which worker ran what
+// -----------------------------------------------------
+
+void DeferCommand(int type, const GameObj* source, glm::vec3 pos, glm::vec3 vel) {
+	Level1Command cmd;
+	cmd.type = type;
+	cmd.source = (int)(source - sGameObjInstArray);
+	cmd.position = pos;
+	cmd.velocity = vel;
+	sCommandBuffer[JobWorkerIndex()].push_back(cmd);
+}
+
+//+ Particle effects, a muzzle flash goes in the direction of the bullet
+void SpawnExplosion(const glm::vec3& pos) {
+	ParticleEmit(sParticles, sExplosionParticle, pos.x, pos.y, 0.0f, 1.0f, EXPLOSION_PARTICLE_NUM);
+}
+
+void SpawnMuzzleFlash(const glm::vec3& pos, const glm::vec3& bulletVel) {
+	ParticleEmit(sParticles, sMuzzleParticle, pos.x, pos.y, bulletVel.x, bulletVel.y, MUZZLE_PARTICLE_NUM);
+}
+
+bool CompareCommandSource(const Level1Command& a, const Level1Command& b) {
+	return a.source < b.source;
+}
+
+void ApplyDeferredCommands(void* ctx) {
+	std::vector<Level1Command> commands;
+	for (int w = 0; w < JobWorkerCount(); w++) {
+		commands.insert(commands.end(), sCommandBuffer[w].begin(), sCommandBuffer[w].end());
+		sCommandBuffer[w].clear();
+	}
+
+	// stable, commands of the same object keep their order
+	std::stable_sort(commands.begin(), commands.end(), CompareCommandSource);
+
+	for (size_t i = 0; i < commands.size(); i++) {
+		const Level1Command& cmd = commands[i];
+
+		if (cmd.type == COMMAND_DESTROY) {
+			gameObjInstDestroy(sGameObjInstArray[cmd.source]);
+		}
+		else if (cmd.type == COMMAND_SPAWN_BULLET) {
+			GameObj* bulletInst = gameObjInstCreate(TYPE_BULLET, cmd.position, cmd.velocity, glm::vec3(0.5f, 0.5f, 0.5f), 0, false, 0, 0, 0);
+			if (bulletInst == NULL)
+				continue;
+			SpawnMuzzleFlash(cmd.position, cmd.velocity);
+			bulletInst->playerOwn = false;
+			bulletInst->lifespan = 0;
+		}
+	}
 }
 
 
@@ -351,43 +466,16 @@ void ApplyAnimation(GameObj* pInst, const AnimationSprite& anim) {
 }
 
 void EnemyStateMachine(GameObj* pInst) {
-	bool isInAir = false;
-
-	// Update position, velocity, jumping states when the collide with the map
-	pInst->mapCollsionFlag = CheckMapCollision(pInst->position.x, pInst->position.y, isInAir);
-
-	// Collide Left
+	// mapCollsionFlag is set by the swept move of the last IntegrateStage,
+	// turn around when walking into a wall
 	if (pInst->mapCollsionFlag & COLLISION_LEFT) {
-		pInst->position.x = (int)pInst->position.x + 0.5f;
 		pInst->state = STATE_GOING_RIGHT;
 	}
 
-	//+ Collide Right
 	if (pInst->mapCollsionFlag & COLLISION_RIGHT) {
-		pInst->position.x = (int)pInst->position.x + 0.5f;
 		pInst->state = STATE_GOING_LEFT;
 	}
 
-
-	//+ Collide Top
-	if (pInst->mapCollsionFlag & COLLISION_TOP) {
-		pInst->velocity.y = -0.5f;
-		pInst->position.y = (int)pInst->position.y + 0.5f;
-	}
-
-
-	//+ Is on the ground or just landed on the ground
-	if (pInst->mapCollsionFlag & COLLISION_BOTTOM) {
-		pInst->jumping = false;
-		pInst->velocity.y = 0;
-		pInst->position.y = (int)pInst->position.y + 0.5f;
-	}
-
-	//+ Is jumping/falling
-	if (isInAir) {
-		pInst->jumping = true;
-	}
-
 	switch (pInst->state)
 	{
 	case STATE_GOING_LEFT:
@@ -404,15 +492,30 @@ void EnemyStateMachine(GameObj* pInst) {
 	}
 }
 
-void PatrolStateMachine(GameObj* patrolInst, float dt) {
-	if (sPlayer->flag == FLAG_INACTIVE) return;
+//+ Line of sight from the enemy to the player, through the collision map
+//	- the ray is only cast every SIGHT_REFRESH_FRAMES frames, in between the last
+//	  result is reused, the frame of each enemy is picked by its slot so the casts
+//	  stay spread whenever the enemies were created or restored
+//	- the first update after a create or a restore always cast
+bool CanSeePlayer(GameObj* pInst, const Level1UpdateCtx* ctx) {
+	long slot = (long)(pInst - sGameObjInstArray);
+	if (pInst->sightFrame < 0 || (ctx->frame + slot) % SIGHT_REFRESH_FRAMES == 0) {
+		pInst->seesPlayer = LineOfSight(sMapCollision, pInst->position.x, pInst->position.y, ctx->playerPosition.x, ctx->playerPosition.y);
+		pInst->sightFrame = ctx->frame;
+	}
+	return pInst->seesPlayer;
+}
+
+void PatrolStateMachine(GameObj* patrolInst, const Level1UpdateCtx* ctx) {
+	if (!ctx->playerActive) return;
 
-	float distance = sPlayer->position.x - patrolInst->position.x;
+	float dt = ctx->dt;
+	float distance = ctx->playerPosition.x - patrolInst->position.x;
 
 	EnemyStateMachine(patrolInst);
 
-	// in detect range of enemy
-	if (abs(distance) < 5) {
+	// in detect range of enemy, and not behind a wall
+	if (abs(distance) < 5 && CanSeePlayer(patrolInst, ctx)) {
 
 		// in shooting range of enemy
 		if (abs(distance) < 4) {
@@ -425,7 +528,7 @@ void PatrolStateMachine(GameObj* patrolInst, float dt) {
 			}
 			else {
 				// Calculate the direction vector from the object's position to the target point
-				glm::vec3 direction = glm::normalize(sPlayer->position - patrolInst->position);
+				glm::vec3 direction = glm::normalize(ctx->playerPosition - patrolInst->position);
 
 				// Calculate the angle between the direction vector and the positive x-axis
 				float angle = atan2(direction.y, direction.x) - PI / 2.0f;
@@ -433,9 +536,7 @@ void PatrolStateMachine(GameObj* patrolInst, float dt) {
 				glm::vec3 bullet_velocity = glm::vec3(PATROL_BULLET_SPEED * glm::cos(angle + PI / 2.0f),
 					PATROL_BULLET_SPEED * glm::sin(angle + PI / 2.0f), 0);
 
-				GameObj* bulletInst = gameObjInstCreate(TYPE_BULLET, patrolInst->position, bullet_velocity, glm::vec3(0.5f, 0.5f, 0.5f), 0, false, 0, 0, 0);
-				bulletInst->playerOwn = false;
-				bulletInst->lifespan = 0;
+				DeferCommand(COMMAND_SPAWN_BULLET, patrolInst, patrolInst->position, bullet_velocity);
 
 				patrolInst->shootCooldown = PATROL_FIRE_COOLDOWN;
 			}
@@ -466,13 +567,14 @@ void PatrolStateMachine(GameObj* patrolInst, float dt) {
 	}
 }
 
-void SniperStateMachine(GameObj* sniperInst, float dt) {
-	if (sPlayer->flag == FLAG_INACTIVE) return;
+void SniperStateMachine(GameObj* sniperInst, const Level1UpdateCtx* ctx) {
+	if (!ctx->playerActive) return;
 
-	float distance = sPlayer->position.x - sniperInst->position.x;
+	float dt = ctx->dt;
+	float distance = ctx->playerPosition.x - sniperInst->position.x;
 
-	// in shooting range of enemy
-	if (abs(distance) < 7) {
+	// in shooting range of enemy, and not behind a wall
+	if (abs(distance) < 7 && CanSeePlayer(sniperInst, ctx)) {
 		sniperInst->scale.x = distance > 0 ? 1 : -1;
 		ApplyAnimation(sniperInst, sniperAnimations[1]);
 
@@ -481,7 +583,7 @@ void SniperStateMachine(GameObj* sniperInst, float dt) {
 		}
 		else {
 			// Calculate the direction vector from the object's position to the target point
-			glm::vec3 direction = glm::normalize(sPlayer->position - sniperInst->position);
+			glm::vec3 direction = glm::normalize(ctx->playerPosition - sniperInst->position);
 
 			// Calculate the angle between the direction vector and the positive x-axis
 			float angle = atan2(direction.y, direction.x) - PI / 2.0f;
@@ -489,9 +591,7 @@ void SniperStateMachine(GameObj* sniperInst, float dt) {
 			glm::vec3 bullet_velocity = glm::vec3(SNIPER_BULLET_SPEED * glm::cos(angle + PI / 2.0f),
 				SNIPER_BULLET_SPEED * glm::sin(angle + PI / 2.0f), 0);
 
-			GameObj* bulletInst = gameObjInstCreate(TYPE_BULLET, sniperInst->position, bullet_velocity, glm::vec3(0.5f, 0.5f, 0.5f), 0, false, 0, 0, 0);
-			bulletInst->playerOwn = false;
-			bulletInst->lifespan = 0;
+			DeferCommand(COMMAND_SPAWN_BULLET, sniperInst, sniperInst->position, bullet_velocity);
 
 			sniperInst->shootCooldown = SNIPER_FIRE_COOLDOWN;
 		}
@@ -521,14 +621,42 @@ void PlayerTakeDamage(int damage = 1) {
 	}
 }
 
+//+ Broadphase then narrowphase of every candidate at once
+//	- sGridResult get the candidates sorted by map index, test them with CandidateHit(n)
+void QueryOverlaps(float x, float y, float halfW, float halfH) {
+	sGridResult.clear();
+	GridQueryCandidates(sObjGrid, x, y, halfW, halfH, sGridResult);
+	std::sort(sGridResult.begin(), sGridResult.end());
+
+	// boxes as they were put in the broadphase
+	for (size_t n = 0; n < sGridResult.size(); n++) {
+		int id = sGridResult[n];
+		sCandX[n] = sObjGrid.posX[id];
+		sCandY[n] = sObjGrid.posY[id];
+		sCandHalfW[n] = sObjGrid.halfW[id];
+		sCandHalfH[n] = sObjGrid.halfH[id];
+	}
+
+	CDTBoxSoA boxes;
+	boxes.x = sCandX;
+	boxes.y = sCandY;
+	boxes.halfW = sCandHalfW;
+	boxes.halfH = sCandHalfH;
+	boxes.count = (int)sGridResult.size();
+	OverlapBoxBatch(x, y, halfW, halfH, boxes, sCandHit, sCandSide);
+}
+
+bool CandidateHit(size_t n) {
+	return (sCandHit[n >> 5] >> (n & 31)) & 1;
+}
+
 void BulletBehave(GameObj* bulletInst) {
 	if (!bulletInst->playerOwn) {
 
 		if (!sPlayer->mortal || sPlayer->flag == FLAG_INACTIVE) return;
 
-		int result = _detectCollisionAABB(
-			{ sPlayer->position.x, sPlayer->position.y , 1.f, 1.f },
-			{ bulletInst->position.x, bulletInst->position.y, bulletInst->scale.x, bulletInst->scale.y });
+		int result = OverlapBox(sPlayer->position.x, sPlayer->position.y, 0.5f, 0.5f,
+			bulletInst->position.x, bulletInst->position.y, fabsf(bulletInst->scale.x) / 2, fabsf(bulletInst->scale.y) / 2);
 
 		if (result) {
 			gameObjInstDestroy(*bulletInst);
@@ -538,20 +666,16 @@ void BulletBehave(GameObj* bulletInst) {
 		return;
 	}
 
-	for (int i = 0; i < GAME_OBJ_INST_MAX; i++)
-	{
-		GameObj* pInst = sGameObjInstArray + i;
+	// only the objects around the bullet, by map index so the first enemy hit is always the same
+	QueryOverlaps(bulletInst->position.x, bulletInst->position.y, fabsf(bulletInst->scale.x) / 2, fabsf(bulletInst->scale.y) / 2);
 
-		// skip inactive object
-		if (pInst->flag == FLAG_INACTIVE || pInst->type == TYPE_ITEM)
-			continue;
+	for (size_t n = 0; n < sGridResult.size(); n++)
+	{
+		GameObj* pInst = sGameObjInstArray + sGridResult[n];
 
 		if (pInst->type == TYPE_ENEMY || pInst->type == TYPE_PATROL || pInst->type == TYPE_SNIPER) {
-			int result = _detectCollisionAABB(
-				{ bulletInst->position.x, bulletInst->position.y , bulletInst->scale.x, bulletInst->scale.y },
-				{ pInst->position.x, pInst->position.y, 1.f, 1.f });
-
-			if (result) {
+			if (CandidateHit(n)) {
+				SpawnExplosion(pInst->position);
 				gameObjInstDestroy(*pInst);
 				gameObjInstDestroy(*bulletInst);
 
@@ -559,8 +683,263 @@ void BulletBehave(GameObj* bulletInst) {
 			}
 		}
 	}
+}
+
+
+// -------------------------------------------
+// Update pipeline stages
+//	- entity stages only touch the given object and read the player from the ctx,
+//	  they run in parallel and use DeferCommand to spawn/destroy objects
+//	- phase stages loop over sGameObjInstArray themselves
+// -------------------------------------------
+
+bool IsGameObjActive(const void* entity) {
+	return ((const GameObj*)entity)->flag != FLAG_INACTIVE;
+}
+
+//+ Update some game obj behavior
+void BehaviorStage(void* entity, void* ctx) {
+	GameObj* pInst = (GameObj*)entity;
+	Level1UpdateCtx* pCtx = (Level1UpdateCtx*)ctx;
+
+	switch (pInst->type)
+	{
+	case TYPE_ENEMY:
+		EnemyStateMachine(pInst);
+		break;
+	case TYPE_PATROL:
+		PatrolStateMachine(pInst, pCtx);
+		break;
+	case TYPE_SNIPER:
+		SniperStateMachine(pInst, pCtx);
+		break;
+	default:
+		break;
+	}
+}
+
+//+ Update game obj position using velocity 
+//	- the moving objects of the chunk are gathered into SoA arrays for the SIMD kernel
+//	- only jumping player/enemy/patrol get gravity, bullets fly straight
+//	- the kernel gives the target position, then the box is swept from the old
+//	  position to it against the map rects, so nothing tunnels through a tile
+//	- bullets are destroyed when they hit a wall
+void IntegrateStage(int begin, int end, void* ctx) {
+	float dt = ((Level1UpdateCtx*)ctx)->dt;
+
+	float			posX[CDT_PIPELINE_CHUNK], posY[CDT_PIPELINE_CHUNK];
+	float			velX[CDT_PIPELINE_CHUNK], velY[CDT_PIPELINE_CHUNK];
+	unsigned int	gravityMask[CDT_PIPELINE_CHUNK];
+	GameObj*		bodyInst[CDT_PIPELINE_CHUNK];
+	int				numBody = 0;
+
+	for (int i = begin; i < end && numBody < CDT_PIPELINE_CHUNK; i++) {
+		GameObj* pInst = sGameObjInstArray + i;
+
+		// skip inactive object
+		if (pInst->flag == FLAG_INACTIVE)
+			continue;
+
+		bool hasGravity = pInst->type == TYPE_PLAYER || pInst->type == TYPE_ENEMY || pInst->type == TYPE_PATROL;
+		if (!hasGravity && pInst->type != TYPE_BULLET)
+			continue;
+
+		posX[numBody] = pInst->position.x;
+		posY[numBody] = pInst->position.y;
+		velX[numBody] = pInst->velocity.x;
+		velY[numBody] = pInst->velocity.y;
+		gravityMask[numBody] = (hasGravity && pInst->jumping) ? 0xFFFFFFFFu : 0u;
+		bodyInst[numBody] = pInst;
+		numBody++;
+	}
+
+	CDTBodySoA bodies;
+	bodies.posX = posX;
+	bodies.posY = posY;
+	bodies.velX = velX;
+	bodies.velY = velY;
+	bodies.gravityMask = gravityMask;
+	bodies.count = numBody;
+	IntegrateBodies(bodies, dt, GRAVITY);
+
+	for (int n = 0; n < numBody; n++) {
+		GameObj* pInst = bodyInst[n];
+		float x = pInst->position.x, y = pInst->position.y;
+		float halfW = BODY_HALF_SIZE, halfH = BODY_HALF_SIZE;
+		if (pInst->type == TYPE_BULLET) {
+			halfW = fabsf(pInst->scale.x) / 2;
+			halfH = fabsf(pInst->scale.y) / 2;
+		}
+
+		pInst->velocity.y = velY[n];
+		pInst->mapCollsionFlag = MoveBoxRects(sMapColliders, x, y, halfW, halfH, pInst->velocity.x, pInst->velocity.y, posX[n] - x, posY[n] - y);
+		pInst->position.x = x;
+		pInst->position.y = y;
+
+		if (pInst->type == TYPE_BULLET) {
+			if (pInst->mapCollsionFlag)
+				DeferCommand(COMMAND_DESTROY, pInst, pInst->position, pInst->velocity);
+			continue;
+		}
+
+		//+ Is on the ground or just landed on the ground, else is jumping/falling
+		if (pInst->velocity.y <= 0.0f && BoxOnGroundRects(sMapColliders, x, y, halfW, halfH)) {
+			pInst->jumping = false;
+			pInst->velocity.y = 0;
+		}
+		else {
+			pInst->jumping = true;
+		}
+	}
+}
+
+//+ Decrease object lifespan for self destroyed objects (ex. explosion)
+void LifespanStage(void* entity, void* ctx) {
+	GameObj* pInst = (GameObj*)entity;
+
+	if (pInst->type == TYPE_BULLET) {
+		if (pInst->lifespan > BULLET_LIFESPAN) {
+			DeferCommand(COMMAND_DESTROY, pInst, pInst->position, pInst->velocity);
+		}
+		else {
+			pInst->lifespan += ((Level1UpdateCtx*)ctx)->dt;
+		}
+	}
+}
+
+//+ Update animation for animated object 
+void AnimationStage(void* entity, void* ctx) {
+	GameObj* pInst = (GameObj*)entity;
+
+	if (!pInst->anim || ((Level1UpdateCtx*)ctx)->frame % ANIMATION_SPEED != 0)
+		return;
+
+	//+ increment pInst->currFrame
+	pInst->currFrame++;
+
+	//	- if we reach the last frame then set the current frame back to frame 0
+	if (pInst->currFrame > pInst->numFrame)
+		pInst->currFrame = 0;
+
+	//+ use currFrame infomation to set pInst->offsetX
+	pInst->offsetX = pInst->initialOffsetX + (pInst->currFrame * pInst->offset);
+}
+
+//+ Update modelTransform of game obj
+//	- only objects that moved, scaled or rotated since the last update are recomputed
+//	- the dirty ones of the chunk are computed together by AffineBatchCompute
+void ModelTransformStage(int begin, int end, void* ctx) {
+	float		posX[CDT_PIPELINE_CHUNK], posY[CDT_PIPELINE_CHUNK];
+	float		scaleX[CDT_PIPELINE_CHUNK], scaleY[CDT_PIPELINE_CHUNK];
+	float		orientation[CDT_PIPELINE_CHUNK];
+	CDTAffine2D	transform[CDT_PIPELINE_CHUNK];
+	GameObj*	dirtyInst[CDT_PIPELINE_CHUNK];
+	int			numDirty = 0;
+
+	for (int i = begin; i < end && numDirty < CDT_PIPELINE_CHUNK; i++) {
+		GameObj* pInst = sGameObjInstArray + i;
+
+		// skip inactive object
+		if (pInst->flag == FLAG_INACTIVE || !IsModelTransformDirty(pInst))
+			continue;
+
+		posX[numDirty] = pInst->position.x;
+		posY[numDirty] = pInst->position.y;
+		scaleX[numDirty] = pInst->scale.x;
+		scaleY[numDirty] = pInst->scale.y;
+		orientation[numDirty] = pInst->orientation;
+		dirtyInst[numDirty] = pInst;
+		numDirty++;
+	}
+
+	if (numDirty == 0)
+		return;
+
+	CDTTRSBatch batch;
+	batch.posX = posX;
+	batch.posY = posY;
+	batch.scaleX = scaleX;
+	batch.scaleY = scaleY;
+	batch.orientation = orientation;
+	batch.count = numDirty;
+	AffineBatchCompute(batch, transform);
+
+	for (int n = 0; n < numDirty; n++) {
+		GameObj* pInst = dirtyInst[n];
+		pInst->modelTransform = transform[n];
+		pInst->xformPosition = pInst->position;
+		pInst->xformScale = pInst->scale;
+		pInst->xformOrientation = pInst->orientation;
+	}
+}
+
+//+ Move player/enemy/item in the broadphase grid, only the ones that changed cell are relinked
+void BroadphasePhase(void* ctx) {
+	for (int i = 0; i < GAME_OBJ_INST_MAX; i++) {
+		GameObj* pInst = sGameObjInstArray + i;
+
+		// bullets are never hit by other objects, they only query
+		if (pInst->flag == FLAG_INACTIVE || pInst->type == TYPE_BULLET)
+			continue;
+
+		GridUpdate(sObjGrid, i, pInst->position.x, pInst->position.y, 0.5f, 0.5f);
+	}
+}
+
+//+ Check for collsion between game objects
+//	- Bullet vs Player/Enemy
+//	- Player vs Enemy
+//	- Player vs Item
+void ObjectCollisionPhase(void* ctx) {
+	for (int i = 0; i < GAME_OBJ_INST_MAX; i++) {
+		GameObj* pInst = sGameObjInstArray + i;
+
+		if (pInst->flag != FLAG_INACTIVE && pInst->type == TYPE_BULLET)
+			BulletBehave(pInst);
+	}
+
+	if (sPlayer->flag == FLAG_INACTIVE)
+		return;
+
+	// only the objects touching the player, in map index order
+	QueryOverlaps(sPlayer->position.x, sPlayer->position.y, 0.5f, 0.5f);
+
+	for (size_t n = 0; n < sGridResult.size(); n++) {
+		GameObj* pInst = sGameObjInstArray + sGridResult[n];
+
+		// skip object destroyed earlier in this loop
+		if (pInst->flag == FLAG_INACTIVE)
+			continue;
+
+
+		//+ Player vs Enemy
+		//	- if the Player die, set the sRespawnCountdown > 0	
+		if (pInst->type == TYPE_ENEMY && sPlayer->mortal) {
+			if (CandidateHit(n)) {
+				if (sCandSide[n] & COLLISION_BOTTOM) {
+					SpawnExplosion(pInst->position);
+					gameObjInstDestroy(*pInst);
+				}
+				else {
+					PlayerTakeDamage();
+				}
+			}
+		}
 
 
+		//+ Player vs Item
+		if (pInst->type == TYPE_ITEM) {
+			if (CandidateHit(n)) {
+				sScore++;
+				AudioPlayAt(sSoundIds[SOUND_COIN], 1.0f, pInst->position.x, pInst->position.y);
+				gameObjInstDestroy(*pInst);
+			}
+		}
+
+		// the player may have died
+		if (sPlayer->flag == FLAG_INACTIVE)
+			break;
+	}
 }
 
 
@@ -568,7 +947,303 @@ void BulletBehave(GameObj* bulletInst) {
 // Game states function
 // -------------------------------------------
 
-void GameStateLevel1Load(void) {
+
+
+// -----------------------------------------------------
+// World streaming
+//	- the chunks of the level are streamed around the camera, a resident
+//	  chunk holds its prebaked quads (the tiles to draw): numQuad then the quads
+//	- collision stays on the mapped level, it's 1 bit per tile and is only
+//	  touched around the bodies, so the OS pages it in and out as needed
+//	- the objects of a chunk are created the first time it becomes resident,
+//	  when it's evicted they're suspended and come back with the chunk
+// -----------------------------------------------------
+
+int ChunkIndexOf(float x, float y) {
+	int cx = (int)floor(x) / sWorldStream.chunkSize, cy = (int)floor(y) / sWorldStream.chunkSize;
+	cx = std::max(0, std::min(cx, sWorldStream.numChunkX - 1));
+	cy = std::max(0, std::min(cy, sWorldStream.numChunkY - 1));
+	return cy * sWorldStream.numChunkX + cx;
+}
+
+// stream thread, only reads the mapped level
+void LoadChunkQuads(int chunkX, int chunkY, unsigned char* data, void* user) {
+	const CDTLevelChunk& chunk = sLevel.chunks[chunkY * sWorldStream.numChunkX + chunkX];
+
+	memcpy(data, &chunk.numQuad, sizeof(uint32_t));
+	memcpy(data + sizeof(uint32_t), sLevel.quads + chunk.firstQuad, chunk.numQuad * sizeof(CDTLevelQuad));
+}
+
+void SpawnObject(const CDTLevelSpawn& spawn) {
+	glm::vec3 pos(spawn.x + 0.5f, (MAP_HEIGHT - spawn.y) - 0.5f, 0.0f);
+	GameObj* enemy = nullptr;
+
+	switch (spawn.tile) {
+		// Player
+	case 5:
+
+		sPlayer = gameObjInstCreate(TYPE_PLAYER, pos, glm::vec3(0.0f, 0.0f, 0.0f),
+			glm::vec3(1.0f, 1.0f, 1.0f), 0.0f, true, 0, 0, 0.125f);
+		sPlayer->mortal = false;
+		sPlayer_start_position = pos;
+
+		// idle
+		ApplyAnimation(sPlayer, playerAnimations[0]);
+		break;
+
+		//+ Enemy
+	case 6:
+		enemy = gameObjInstCreate(TYPE_ENEMY, pos, glm::vec3(0.0f, 0.0f, 0.0f),
+			glm::vec3(1.0f, 1.0f, 1.0f), 0.0f, true, 1, 0, 0.5f);
+		enemy->state = STATE_GOING_LEFT;
+		break;
+
+		//+ Item
+	case 7:
+		gameObjInstCreate(TYPE_ITEM, pos, glm::vec3(0.0f, 0.0f, 0.0f),
+			glm::vec3(1.0f, 1.0f, 1.0f), 0.0f, true, 3, 0, 0.25f);
+		break;
+
+		// Patrol
+	case 8:
+		enemy = gameObjInstCreate(TYPE_PATROL, pos, glm::vec3(0.0f, 0.0f, 0.0f),
+			glm::vec3(1.0f, 1.0f, 1.0f), 0.0f, true, 0, 0, 0.0416f);
+		enemy->state = STATE_GOING_LEFT;
+		enemy->shootCooldown = 0.f;
+		break;
+
+		// Sniper
+	case 9:
+		enemy = gameObjInstCreate(TYPE_SNIPER, pos, glm::vec3(0.0f, 0.0f, 0.0f),
+			glm::vec3(-1.0f, 1.0f, 1.0f), 0.0f, true, 0, 0, 0.0714f);
+		enemy->shootCooldown = 0.f;
+		break;
+
+	default:
+		break;
+	}
+}
+
+//+ Bake the quads of a chunk in 1 mesh, drawn by 1 draw call
+//	- each quad is the map mesh moved to its cell (chunk space, y up),
+//	  its tile picked by the uv and its layer by the depth
+void BuildChunkMesh(int c, const unsigned char* data) {
+	uint32_t numQuad;
+	memcpy(&numQuad, data, sizeof(uint32_t));
+	const CDTLevelQuad* quads = (const CDTLevelQuad*)(data + sizeof(uint32_t));
+	if (numQuad == 0)
+		return;
+
+	const std::vector<CDTVertex>& corners = sMapMesh->vertex;
+	std::vector<CDTVertex> vertices;
+	vertices.reserve(numQuad * corners.size());
+	int material = CDT_MATERIAL_OPAQUE;
+
+	for (uint32_t n = 0; n < numQuad; n++) {
+		int tile = std::max(1, std::min((int)quads[n].tile, TILE_TYPE_MAX));
+		material = std::max(material, sTileMaterial[tile - 1]);
+
+		for (size_t v = 0; v < corners.size(); v++) {
+			CDTVertex vertex = corners[v];
+			vertex.x += quads[n].x + 0.5f;
+			vertex.y += quads[n].y + 0.5f;
+			vertex.z += quads[n].layer * MAP_LAYER_DEPTH_STEP;
+			vertex.u += sMapOffset * (tile - 1);
+			vertices.push_back(vertex);
+		}
+	}
+
+	sChunkMesh[c] = CreateMesh(vertices);
+	sChunkMaterial[c] = material;
+}
+
+void FreeChunkMesh(int c) {
+	if (sChunkMesh[c].vaoHandle == 0)
+		return;
+
+	UnloadMesh(sChunkMesh[c]);
+	sChunkMesh[c] = CDTMesh();
+}
+
+// main thread, from StreamUpdate
+void OnChunkResident(int chunkX, int chunkY, const unsigned char* data, void* user) {
+	int c = chunkY * sWorldStream.numChunkX + chunkX;
+	BuildChunkMesh(c, data);
+
+	if (!sChunkSpawned[c]) {
+		sChunkSpawned[c] = true;
+		for (int n = sChunkSpawnFirst[c]; n < sChunkSpawnFirst[c + 1]; n++)
+			SpawnObject(sLevel.spawns[sChunkSpawn[n]]);
+	}
+
+	for (size_t n = 0; n < sChunkSuspended[c].size(); n++)
+		gameObjInstRestore(sChunkSuspended[c][n]);
+	sChunkSuspended[c].clear();
+}
+
+// main thread, from StreamUpdate
+void OnChunkEvict(int chunkX, int chunkY, const unsigned char* data, void* user) {
+	FreeChunkMesh(chunkY * sWorldStream.numChunkX + chunkX);
+}
+
+//+ Suspend the objects that are in a chunk that is not resident
+//	- bullets are just destroyed, the player is never suspended
+void SuspendOutsideChunks() {
+	for (int i = 0; i < GAME_OBJ_INST_MAX; i++) {
+		GameObj* pInst = sGameObjInstArray + i;
+		if (pInst->flag == FLAG_INACTIVE || pInst == sPlayer)
+			continue;
+
+		int c = ChunkIndexOf(pInst->position.x, pInst->position.y);
+		if (sWorldStream.chunks[c].state == CDT_CHUNK_RESIDENT)
+			continue;
+
+		if (pInst->type != TYPE_BULLET)
+			sChunkSuspended[c].push_back(*pInst);
+		gameObjInstDestroy(*pInst);
+	}
+}
+
+
+// -----------------------------------------------------
+// Load tasks, run by the load graph of GameStateLevel1Preload
+// -----------------------------------------------------
+
+void DecodeTextureTask(void* data) {
+	Level1TextureLoad* load = (Level1TextureLoad*)data;
+	const CDTImage& image = load->image;
+	TextureDecode(load->image, load->filename);
+
+	// the opaque tiles are drawn without blending, the area is the uv of the map mesh
+	if (load->tex == sMapTex) {
+		for (int t = 0; t < TILE_TYPE_MAX; t++)
+			sTileMaterial[t] = ImageMaterial(image, t * sMapOffset + 0.01f, 0.0f, t * sMapOffset + 0.24f, 0.99f);
+	}
+
+	// a failed decode is only shared by name
+	if (image.pixels)
+		load->hash = ResourceHash(image.pixels, (size_t)image.width * image.height * image.channels) ^ ((uint64_t)image.width << 32 | (uint64_t)image.height);
+	else
+		load->hash = ResourceHash(load->filename, strlen(load->filename));
+}
+
+// decode on a worker, the texture is created by UploadTexturesTask
+//	- nothing to load when another state left it in the resource cache
+void QueueTexture(CDTTex* tex, const char* filename) {
+	if (ResourceFindTexture(filename, *tex))
+		return;
+
+	Level1TextureLoad load;
+	load.tex = tex;
+	load.filename = filename;
+	load.image.pixels = NULL;
+	load.hash = 0;
+	sTextureLoads.push_back(load);
+
+	LoadGraphAdd(sLoadGraph, filename, CDT_LOAD_WORKER, DecodeTextureTask, &sTextureLoads.back());
+}
+
+void UploadTexturesTask(void* data) {
+	std::vector<CDTImage> images(sTextureLoads.size());
+	std::vector<CDTTex> textures(sTextureLoads.size());
+	std::vector<size_t> bytes(sTextureLoads.size());
+	for (size_t n = 0; n < sTextureLoads.size(); n++) {
+		images[n] = sTextureLoads[n].image;
+		bytes[n] = (size_t)images[n].width * images[n].height * images[n].channels;
+	}
+
+	if (!images.empty())
+		TextureUploadBatch(&images[0], &textures[0], (int)images.size());
+
+	for (size_t n = 0; n < sTextureLoads.size(); n++)
+		*sTextureLoads[n].tex = ResourceAddTexture(sTextureLoads[n].filename, sTextureLoads[n].hash, textures[n], bytes[n]);
+	sTextureLoads.clear();
+}
+
+// decoded once into the audio bank, they stay there for the next loads
+void LoadSoundsTask(void* data) {
+	for (int n = 0; n < SOUND_MAX; n++) {
+		sSoundIds[n] = AudioLoadSound(sSoundFiles[n]);
+		if (sSoundIds[n] < 0)
+			printf("Level1: can't load sound %s\n", sSoundFiles[n]);
+	}
+
+	// the coins fade out of the view
+	AudioSetSoundLimit(sSoundIds[SOUND_COIN], COIN_SOUND_PRIORITY, COIN_SOUND_MAX, (float)VIEW_WIDTH);
+	AudioSetSoundLimit(sSoundIds[SOUND_JUMP], JUMP_SOUND_PRIORITY, 1, 0.0f);
+}
+
+//-----------------------------------------
+// Load level from the binary level file to sMapCollision, sMapColliders
+//	- 0	is an empty space
+//	- 1-4 are background tile
+//	- 5-9 are game objects location (the spawn list)
+//	- the file is mapped and used in place, the text map is only
+//	  converted when the binary level is missing, of an older version,
+//	  or was converted from an older text map
+//-----------------------------------------
+void LoadLevelTask(void* data) {
+	if (!LevelOpen(sLevel, LEVEL_FILE) || !LevelIsCurrent(sLevel, LEVEL_TEXT_FILE)) {
+		LevelClose(sLevel);
+
+		// the mounted pack may still have the old level, the new one is read from disk
+		if (!LevelConvertText(LEVEL_TEXT_FILE, LEVEL_FILE) || !LevelOpenFile(sLevel, LEVEL_FILE))
+			printf("Level1: can't load %s\n", LEVEL_FILE);
+	}
+
+	MAP_WIDTH = sLevel.header ? sLevel.header->width : 0;
+	MAP_HEIGHT = sLevel.header ? sLevel.header->height : 0;
+
+	//** Don't forget that sMapCollision index go from- 
+	//**	 bottom to top not from top to bottom as in the text file
+	BitGridView(sMapCollision, MAP_WIDTH, MAP_HEIGHT, sLevel.collision);
+
+	// solid tiles merged into big rects, bodies then slide on them without snagging on tile seams
+	ColliderTreeBuild(sMapColliders, sLevel.rects, sLevel.header ? (int)sLevel.header->numRect : 0);
+	printf("Level1: %d collision rects, %d tree nodes\n", (int)sMapColliders.rects.size(), (int)sMapColliders.nodes.size());
+
+	// Broadphase grid, 1 cell per map tile
+	GridInit(sObjGrid, (float)MAP_WIDTH, (float)MAP_HEIGHT, 1.0f, GAME_OBJ_INST_MAX);
+
+	// Chunk streaming, and the spawn list sorted by chunk (the player is spawned by Init)
+	//	- a chunk buffer fits the biggest chunk of the level
+	int chunkSize = sLevel.header ? sLevel.header->chunkSize : CDT_LEVEL_CHUNK_SIZE;
+	uint32_t maxQuad = 0;
+	for (int c = 0; sLevel.header && c < sLevel.header->numChunkX * sLevel.header->numChunkY; c++)
+		maxQuad = std::max(maxQuad, sLevel.chunks[c].numQuad);
+	StreamInit(sWorldStream, MAP_WIDTH, MAP_HEIGHT, chunkSize, STREAM_RADIUS, STREAM_BUDGET,
+		sizeof(uint32_t) + maxQuad * sizeof(CDTLevelQuad), LoadChunkQuads, OnChunkResident, OnChunkEvict, NULL);
+
+	int numChunk = sWorldStream.numChunkX * sWorldStream.numChunkY;
+	int numSpawn = sLevel.header ? (int)sLevel.header->numSpawn : 0;
+	sChunkSpawnFirst.assign(numChunk + 1, 0);
+	sChunkSpawn.assign(numSpawn, 0);
+	for (int n = 0; n < numSpawn; n++) {
+		if (sLevel.spawns[n].tile != 5)
+			sChunkSpawnFirst[ChunkIndexOf(sLevel.spawns[n].x + 0.5f, (MAP_HEIGHT - sLevel.spawns[n].y) - 0.5f) + 1]++;
+	}
+	for (int c = 0; c < numChunk; c++)
+		sChunkSpawnFirst[c + 1] += sChunkSpawnFirst[c];
+	std::vector<int> fill(sChunkSpawnFirst.begin(), sChunkSpawnFirst.end() - 1);
+	for (int n = 0; n < numSpawn; n++) {
+		if (sLevel.spawns[n].tile != 5)
+			sChunkSpawn[fill[ChunkIndexOf(sLevel.spawns[n].x + 0.5f, (MAP_HEIGHT - sLevel.spawns[n].y) - 0.5f)]++] = n;
+	}
+	sChunkSuspended.assign(numChunk, std::vector<GameObj>());
+	sChunkMesh.assign(numChunk, CDTMesh());
+	sChunkMaterial.assign(numChunk, CDT_MATERIAL_OPAQUE);
+}
+
+
+//-----------------------------------------
+// Declare and start the loading of Level1
+//	- the meshes and the pipeline are made right away, everything else
+//	  is a task of the load graph that is returned
+//	- background: the worker tasks run on the loader thread of the graph
+//	  and the context tasks wait for LoadGraphPoll, so the load can go on
+//	  while another state is running (main.cpp preloads the next state)
+//-----------------------------------------
+CDTLoadGraph* GameStateLevel1Preload(bool background) {
 
 	// clear the Mesh array
 	memset(sMeshArray, 0, sizeof(CDTMesh) * MESH_MAX);
@@ -585,12 +1260,29 @@ void GameStateLevel1Load(void) {
 	// Set the Player object instance to NULL
 	sPlayer = NULL;
 
+	// Declare the update pipeline, consecutive entity stages are fused into 1 pass
+	PipelineInit(sUpdatePipeline, sGameObjInstArray, GAME_OBJ_INST_MAX, sizeof(GameObj), IsGameObjActive);
+	PipelineAddEntityStage(sUpdatePipeline, "behavior", BehaviorStage, true);
+	PipelineAddRangeStage(sUpdatePipeline, "integrate", IntegrateStage, true);
+	PipelineAddEntityStage(sUpdatePipeline, "lifespan", LifespanStage, true);
+	PipelineAddEntityStage(sUpdatePipeline, "animation", AnimationStage, true);
+	PipelineAddRangeStage(sUpdatePipeline, "model transform", ModelTransformStage, true);
+	PipelineAddPhaseStage(sUpdatePipeline, "deferred commands", ApplyDeferredCommands);
+	PipelineAddPhaseStage(sUpdatePipeline, "broadphase", BroadphasePhase);
+	PipelineAddPhaseStage(sUpdatePipeline, "object collision", ObjectCollisionPhase);
+	PipelineCompile(sUpdatePipeline);
+
 
 	// --------------------------------------------------------------------------
 	// Create all of the unique meshes/textures and put them in MeshArray/TexArray
 	//		- The order of mesh MUST follow enum GAMEOBJ_TYPE 
 	/// --------------------------------------------------------------------------
 
+	// the textures are only queued here, they are loaded by the load graph below
+	LoadGraphInit(sLoadGraph);
+	sTextureLoads.clear();
+	sTextureLoads.reserve(TEXTURE_MAX);
+
 	// Temporary variable for creating mesh
 	CDTMesh* pMesh;
 	CDTTex* pTex;
@@ -612,8 +1304,8 @@ void GameStateLevel1Load(void) {
 
 	pMesh = sMeshArray + sNumMesh++;
 	pTex = sTexArray + sNumTex++;
-	*pMesh = CreateMesh(vertices);
-	*pTex = TextureLoad("rngun/Player/player_sprite.png");
+	*pMesh = ResourceLoadMesh("level1/player", vertices);
+	QueueTexture(pTex, "rngun/Player/player_sprite.png");
 
 	//+ Create Enemy mesh/texture
 	vertices.clear();
@@ -630,8 +1322,8 @@ void GameStateLevel1Load(void) {
 
 	pMesh = sMeshArray + sNumMesh++;
 	pTex = sTexArray + sNumTex++;
-	*pMesh = CreateMesh(vertices);
-	*pTex = TextureLoad("kuribo.png");
+	*pMesh = ResourceLoadMesh("level1/enemy", vertices);
+	QueueTexture(pTex, "kuribo.png");
 
 
 	//+ Create Item mesh/texture
@@ -649,8 +1341,8 @@ void GameStateLevel1Load(void) {
 
 	pMesh = sMeshArray + sNumMesh++;
 	pTex = sTexArray + sNumTex++;
-	*pMesh = CreateMesh(vertices);
-	*pTex = TextureLoad("coin.png");
+	*pMesh = ResourceLoadMesh("level1/item", vertices);
+	QueueTexture(pTex, "coin.png");
 
 
 	//+ Create Item mesh/texture
@@ -668,8 +1360,8 @@ void GameStateLevel1Load(void) {
 
 	pMesh = sMeshArray + sNumMesh++;
 	pTex = sTexArray + sNumTex++;
-	*pMesh = CreateMesh(vertices);
-	*pTex = TextureLoad("rngun/bullet.png");
+	*pMesh = ResourceLoadMesh("level1/bullet", vertices);
+	QueueTexture(pTex, "rngun/bullet.png");
 
 
 	//+ Create Item mesh/texture
@@ -687,8 +1379,8 @@ void GameStateLevel1Load(void) {
 
 	pMesh = sMeshArray + sNumMesh++;
 	pTex = sTexArray + sNumTex++;
-	*pMesh = CreateMesh(vertices);
-	*pTex = TextureLoad("rngun/Enemies/ARMob.png");
+	*pMesh = ResourceLoadMesh("level1/patrol", vertices);
+	QueueTexture(pTex, "rngun/Enemies/ARMob.png");
 
 
 	//+ Create Item mesh/texture
@@ -706,8 +1398,13 @@ void GameStateLevel1Load(void) {
 
 	pMesh = sMeshArray + sNumMesh++;
 	pTex = sTexArray + sNumTex++;
-	*pMesh = CreateMesh(vertices);
-	*pTex = TextureLoad("rngun/Enemies/SniperMob.png");
+	*pMesh = ResourceLoadMesh("level1/sniper", vertices);
+	QueueTexture(pTex, "rngun/Enemies/SniperMob.png");
+
+
+	// Particle sprite sheet, the quads are built by the particle system
+	sParticleTex = sTexArray + sNumTex++;
+	QueueTexture(sParticleTex, "rngun/Enemies/Explosion_Particle.png");
 
 
 	// Create Level mesh/texture
@@ -725,46 +1422,12 @@ void GameStateLevel1Load(void) {
 
 	sMapMesh = sMeshArray + sNumMesh++;
 	sMapTex = sTexArray + sNumTex++;
-	*sMapMesh = CreateMesh(vertices);
-	*sMapTex = TextureLoad("level.png");
+	*sMapMesh = ResourceLoadMesh("level1/map", vertices);
 	sMapOffset = 0.25f;
-
-
-	//-----------------------------------------
-	// Load level from txt file to sMapData, sMapCollisonData, sPlayer_start_position
-	//	- 0	is an empty space
-	//	- 1-4 are background tile
-	//	- 5-7 are game objects location
-	//-----------------------------------------
-
-	std::ifstream myfile("map2.txt");
-	if (myfile.is_open())
-	{
-		myfile >> MAP_HEIGHT;
-		myfile >> MAP_WIDTH;
-		sMapData = new int* [MAP_HEIGHT];
-		sMapCollisionData = new int* [MAP_HEIGHT];
-		for (int y = 0; y < MAP_HEIGHT; y++) {
-			sMapData[y] = new int[MAP_WIDTH];
-			sMapCollisionData[y] = new int[MAP_WIDTH];
-			for (int x = 0; x < MAP_WIDTH; x++) {
-				myfile >> sMapData[y][x];
-			}
-		}
-		myfile.close();
-	}
-
-	//+ load collision data to sMapCollisionData
-	//	- 0: non-blocking cell
-	//	- 1: blocking cell
-	//** Don't forget that sMapCollisionData index go from- 
-	//**	 bottom to top not from top to bottom as in the text file
-	for (int y = 0; y < MAP_HEIGHT; y++) {
-		for (int x = 0; x < MAP_WIDTH; x++) {
-			bool isBlocking = sMapData[y][x] > 0 && sMapData[y][x] < 5;
-			sMapCollisionData[y][x] = isBlocking ? 1 : 0;
-		}
-	}
+	for (int t = 0; t < TILE_TYPE_MAX; t++)
+		sTileMaterial[t] = CDT_MATERIAL_ALPHA_TEST;
+	QueueTexture(sMapTex, "level.png");
+	RenderQueueInit(sRenderQueue);
 
 
 	//-----------------------------------------
@@ -774,18 +1437,33 @@ void GameStateLevel1Load(void) {
 
 	float scaleX = WINDOW_WIDTH / VIEW_WIDTH;  // Scale factor for x-axis
 	float scaleY = WINDOW_HEIGHT / VIEW_HEIGHT;  // Scale factor for y-axis
-	glm::mat4 scaleMatrix = glm::mat4(1.0f);  // Identity matrix
-	scaleMatrix[0][0] = scaleX;
-	scaleMatrix[1][1] = scaleY;
-
 	float translateX = -(WINDOW_WIDTH / 2);
 	float translateY = -(WINDOW_HEIGHT / 2);
-	glm::mat4 translateMatrix = glm::mat4(1.0f);  // Identity matrix
-	translateMatrix[3][0] = translateX;
-	translateMatrix[3][1] = translateY;
 
-	sMapMatrix = translateMatrix * scaleMatrix;
+	sMapTransform = AffineFromTRS(translateX, translateY, scaleX, scaleY, 0.0f);
+
+
+	//-----------------------------------------
+	// Start the load graph
+	//	- the images are decoded, the level and the sounds are read on the
+	//	  workers, all in parallel
+	//	- the textures are uploaded together on the GL context thread
+	//	  once every image is decoded
+	//-----------------------------------------
+	int upload = LoadGraphAdd(sLoadGraph, "upload textures", CDT_LOAD_CONTEXT, UploadTexturesTask, NULL);
+	for (int n = 0; n < upload; n++)
+		LoadGraphDepend(sLoadGraph, upload, n);
+	LoadGraphAdd(sLoadGraph, "level", CDT_LOAD_WORKER, LoadLevelTask, NULL);
+	LoadGraphAdd(sLoadGraph, "sounds", CDT_LOAD_WORKER, LoadSoundsTask, NULL);
+
+	LoadGraphStart(sLoadGraph, background);
+	return &sLoadGraph;
+}
 
+void GameStateLevel1Load(void) {
+	CDTLoadGraph* graph = GameStateLevel1Preload(false);
+	LoadGraphFinish(*graph);
+	LoadGraphReport(*graph);
 
 	printf("Level1: Load\n");
 }
@@ -825,71 +1503,50 @@ void GameStateLevel1Init(void) {
 	}
 
 	//-----------------------------------------
-	// Create game object instance from Map
+	// Create the player from the spawn list of the Map, the other objects
+	// are created with their chunk (OnChunkResident)
 	//	0,1,2,3,4:	level tiles
-	//  5: player, 6: enemy, 7: item
+	//  5: player, 6: enemy, 7: item, 8: patrol, 9: sniper
 	//-----------------------------------------
-	GameObj* enemy = nullptr;
-
-	for (int y = 0; y < MAP_HEIGHT; y++) {
-		for (int x = 0; x < MAP_WIDTH; x++) {
-
-			switch (sMapData[y][x]) {
-				// Player
-			case 5:
-
-				sPlayer = gameObjInstCreate(TYPE_PLAYER, glm::vec3(x + 0.5f, (MAP_HEIGHT - y) - 0.5f, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f),
-					glm::vec3(1.0f, 1.0f, 1.0f), 0.0f, true, 0, 0, 0.125f);
-				sPlayer->mortal = false;
-				sPlayer_start_position = glm::vec3(x + 0.5f, (MAP_HEIGHT - y) - 0.5f, 0.0f);
-
-				// idle
-				ApplyAnimation(sPlayer, playerAnimations[0]);
-				break;
-
-				//+ Enemy
-			case 6:
-				enemy = gameObjInstCreate(TYPE_ENEMY, glm::vec3(x + 0.5f, (MAP_HEIGHT - y) - 0.5f, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f),
-					glm::vec3(1.0f, 1.0f, 1.0f), 0.0f, true, 1, 0, 0.5f);
-				enemy->state = STATE_GOING_LEFT;
-				break;
-
-				//+ Item
-			case 7:
-				gameObjInstCreate(TYPE_ITEM, glm::vec3(x + 0.5f, (MAP_HEIGHT - y) - 0.5f, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f),
-					glm::vec3(1.0f, 1.0f, 1.0f), 0.0f, true, 3, 0, 0.25f);
-				break;
-
-				// Patrol
-			case 8:
-				enemy = gameObjInstCreate(TYPE_PATROL, glm::vec3(x + 0.5f, (MAP_HEIGHT - y) - 0.5f, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f),
-					glm::vec3(1.0f, 1.0f, 1.0f), 0.0f, true, 0, 0, 0.0416f);
-				enemy->state = STATE_GOING_LEFT;
-				enemy->shootCooldown = 0.f;
-				break;
-
-				// Sniper
-			case 9:
-				enemy = gameObjInstCreate(TYPE_SNIPER, glm::vec3(x + 0.5f, (MAP_HEIGHT - y) - 0.5f, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f),
-					glm::vec3(-1.0f, 1.0f, 1.0f), 0.0f, true, 0, 0, 0.0714f);
-				enemy->shootCooldown = 0.f;
-				break;
+	StreamReset(sWorldStream);
+	sChunkSpawned.assign(sChunkSuspended.size(), false);
+	for (size_t c = 0; c < sChunkSuspended.size(); c++)
+		sChunkSuspended[c].clear();
+
+	int numSpawn = sLevel.header ? (int)sLevel.header->numSpawn : 0;
+	for (int n = 0; n < numSpawn; n++) {
+		if (sLevel.spawns[n].tile == 5)
+			SpawnObject(sLevel.spawns[n]);
+	}
 
-			default:
-				break;
-			}
-		}
+	// no level or no player spawn point, the player starts at the map origin
+	if (sPlayer == NULL) {
+		printf("Level1: no player spawn point, the player starts at the origin\n");
+		CDTLevelSpawn origin = { 0, MAP_HEIGHT - 1, 5, 0 };
+		SpawnObject(origin);
 	}
 
+	// wait for the chunks around the player before the first frame
+	sCamPosition = glm::vec2(sPlayer->position.x, sPlayer->position.y);
+	StreamUpdate(sWorldStream, sCamPosition.x, sCamPosition.y);
+	StreamWaitIdle(sWorldStream);
+
 
 	// Initalize some data. ex. score and player life
 	sScore = 0;
 	sPlayerLives = PLAYER_INITIAL_NUM;
 	sRespawnCountdown = 0;
 
-	// Sound
-	SoundEngine = createIrrKlangDevice();
-	SoundEngine->play2D("mario_level.ogg", true);		//loop or not
+	// Sound, decoded by the load graph, the music by the audio stream thread
+	sMusicStream = AudioStreamPlay(MUSIC_FILE, 1.0f, true);
+
+	// Particles, in map units, the sprite sheet is loaded with the other textures
+	//	{ tex, frames, size, gravity, life min/max, speed min/max, spread, capacity }
+	CDTParticleType explosion = { *sParticleTex, PARTICLE_FRAME_NUM, 0.8f, -4.0f, 0.35f, 0.6f, 1.0f, 4.0f, 2.0f * (float)PI, PARTICLE_MAX };
+	CDTParticleType muzzle = { *sParticleTex, PARTICLE_FRAME_NUM, 0.4f, 0.0f, 0.08f, 0.15f, 4.0f, 8.0f, 0.6f, PARTICLE_MAX };
+	ParticleInit(sParticles);
+	sExplosionParticle = ParticleAddType(sParticles, explosion);
+	sMuzzleParticle = ParticleAddType(sParticles, muzzle);
 
 	printf("Level1: Init\n");
 }
@@ -920,7 +1577,7 @@ void GameStateLevel1Update(double dt, long frame, int& state) {
 		if ((glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) && (sPlayer->jumping == false)) {
 			sPlayer->jumping = true;
 			sPlayer->velocity.y = JUMP_VELOCITY;
-			SoundEngine->play2D("jump.wav");
+			AudioPlay(sSoundIds[SOUND_JUMP], 1.0f, false);
 
 		}
 		if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
@@ -983,6 +1640,7 @@ void GameStateLevel1Update(double dt, long frame, int& state) {
 				GameObj* bulletInst = gameObjInstCreate(TYPE_BULLET, sPlayer->position, bulletVel, glm::vec3(0.5f, 0.5f, 0.5f), sPlayer->orientation, false, 0, 0, 0);
 				bulletInst->lifespan = 0;
 				bulletInst->playerOwn = true;
+				SpawnMuzzleFlash(sPlayer->position, bulletVel);
 
 				sShootingCooldown = PLAYER_FIRE_COOLDOWN;
 			}
@@ -1010,235 +1668,44 @@ void GameStateLevel1Update(double dt, long frame, int& state) {
 
 
 	//-----------------------------------------
-	// Update some game obj behavior
+	// Stream the chunks around the camera, suspend the objects of the evicted ones
 	//-----------------------------------------
-	for (int i = 0; i < GAME_OBJ_INST_MAX; i++)
-	{
-		GameObj* pInst = sGameObjInstArray + i;
-
-		// skip inactive object
-		if (pInst->flag == FLAG_INACTIVE)
-			continue;
-
-		switch (pInst->type)
-		{
-		case TYPE_ENEMY:
-			EnemyStateMachine(pInst);
-			break;
-		case TYPE_PATROL:
-			PatrolStateMachine(pInst, dt);
-			break;
-		case TYPE_SNIPER:
-			SniperStateMachine(pInst, dt);
-			break;
-		case TYPE_BULLET:
-			BulletBehave(pInst);
-			break;
-		default:
-			break;
-		}
-
-	}
-
-
-	//---------------------------------------------------------
-	// Update all game obj position using velocity 
-	//---------------------------------------------------------
-	for (int i = 0; i < GAME_OBJ_INST_MAX; i++) {
-		GameObj* pInst = sGameObjInstArray + i;
-
-		// skip inactive object
-		if (pInst->flag == FLAG_INACTIVE)
-			continue;
-
-		if (pInst->type == TYPE_PLAYER ||
-			pInst->type == TYPE_ENEMY ||
-			pInst->type == TYPE_PATROL) {
+	StreamUpdate(sWorldStream, sCamPosition.x, sCamPosition.y);
+	SuspendOutsideChunks();
 
-			// Apply gravity: Velocity Y = Gravity * Frame Time + Velocity Y
-			if (pInst->jumping) {
-				pInst->velocity.y += GRAVITY * dt;
-			}
-
-			// Update position using Velocity
-			pInst->position += pInst->velocity * glm::vec3(dt, dt, 0.0f);
-		}
-		else if (pInst->type == TYPE_BULLET) {
-			// Update position using Velocity
-			pInst->position += pInst->velocity * glm::vec3(dt, dt, 0.0f);
-		}
 
-	}
+	//-----------------------------------------
+	// Run the update pipeline
+	//	- behavior, integration (with the swept map collision), lifespan,
+	//	  animation and model matrix are fused into 1 pass, split across the job workers
+	//	- bullets spawned by enemies are applied after that pass
+	//	- collision between game objects runs as its own phase
+	//-----------------------------------------
+	Level1UpdateCtx ctx;
+	ctx.dt = (float)dt;
+	ctx.frame = frame;
+	ctx.playerActive = sPlayer->flag != FLAG_INACTIVE;
+	ctx.playerPosition = sPlayer->position;
+	PipelineRun(sUpdatePipeline, &ctx);
+	ParticleUpdate(sParticles, (float)dt);
 
 
 	//--------------------------------------------------------------------
 	// Update camera's position
 	//--------------------------------------------------------------------
 	{
-		glm::mat4 matTransform = sMapMatrix * sPlayer->modelMatrix;
-		float camX = matTransform[3][0] < 0.f ? 0.f : matTransform[3][0],
-			camY = matTransform[3][1] < 0.f ? 0.f : matTransform[3][1];
+		CDTAffine2D matTransform = AffineMultiply(sMapTransform, sPlayer->modelTransform);
+		float camX = matTransform.tx < 0.f ? 0.f : matTransform.tx,
+			camY = matTransform.ty < 0.f ? 0.f : matTransform.ty;
 		SetCamPosition(camX, camY);
 
 		// update camera's position in map coordinate
 		sCamPosition.x = floor(sPlayer->position.x) < floor(VIEW_WIDTH / 2.f) ? floor(VIEW_WIDTH / 2.f) : floor(sPlayer->position.x);
 		sCamPosition.y = floor(sPlayer->position.y) < floor(VIEW_HEIGHT / 2.f) ? floor(VIEW_HEIGHT / 2.f) : floor(sPlayer->position.y);
 	}
+	AudioSetListener(sCamPosition.x, sCamPosition.y);
 
 
-	//--------------------------------------------------------------------
-	// Decrease object lifespan for self destroyed objects (ex. explosion)
-	//--------------------------------------------------------------------
-	for (int i = 0; i < GAME_OBJ_INST_MAX; i++)
-	{
-		GameObj* pInst = sGameObjInstArray + i;
-
-		// skip inactive object
-		if (pInst->flag == FLAG_INACTIVE)
-			continue;
-
-		switch (pInst->type)
-		{
-		case TYPE_BULLET:
-			if (pInst->lifespan > BULLET_LIFESPAN) {
-				gameObjInstDestroy(*pInst);
-			}
-			else {
-				pInst->lifespan += dt;
-			}
-			break;
-		default:
-			break;
-		}
-
-	}
-
-	//-----------------------------------------
-	// Update animation for animated object 
-	//-----------------------------------------
-	if (frame % ANIMATION_SPEED == 0) {
-		for (int i = 0; i < GAME_OBJ_INST_MAX; i++) {
-			GameObj* pInst = sGameObjInstArray + i;
-
-			// skip inactive object
-			if (pInst->flag == FLAG_INACTIVE)
-				continue;
-
-			//+ if this is an animated object
-			if (pInst->anim) {
-
-				//+ increment pInst->currFrame
-				pInst->currFrame++;
-
-				//	- if we reach the last frame then set the current frame back to frame 0
-				if (pInst->currFrame > pInst->numFrame)
-					pInst->currFrame = 0;
-
-				//+ use currFrame infomation to set pInst->offsetX
-				pInst->offsetX = pInst->initialOffsetX + (pInst->currFrame * pInst->offset);
-
-			}
-		}
-	}
-
-
-	//-----------------------------------------
-	// Check for collsion with the Map
-	//-----------------------------------------
-	for (int i = 0; i < GAME_OBJ_INST_MAX; i++) {
-		GameObj* pInst = sGameObjInstArray + i;
-
-		// skip inactive object
-		if (pInst->flag == FLAG_INACTIVE)
-			continue;
-
-		if (pInst->type == TYPE_PLAYER) {
-			bool isInAir = false;
-
-			// Update Player position, velocity, jumping states when the player collide with the map
-			sPlayer->mapCollsionFlag = CheckMapCollision(sPlayer->position.x, sPlayer->position.y, isInAir);
-
-			// Collide Left
-			if (sPlayer->mapCollsionFlag & COLLISION_LEFT) {
-				sPlayer->position.x = (int)sPlayer->position.x + 0.5f;      // 4.32 -> 4,   4.89 -> 4  sMapCollisionData[int][int]
-			}
-
-			//+ Collide Right
-			if (sPlayer->mapCollsionFlag & COLLISION_RIGHT) {
-				sPlayer->position.x = (int)sPlayer->position.x + 0.5f;      // 4.32 -> 4,   4.89 -> 4  sMapCollisionData[int][int]
-			}
-
-
-			//+ Collide Top
-			if (sPlayer->mapCollsionFlag & COLLISION_TOP) {
-				sPlayer->velocity.y = -0.5f;
-				sPlayer->position.y = (int)sPlayer->position.y + 0.5f;      // 4.32 -> 4,   4.89 -> 4  sMapCollisionData[int][int]
-			}
-
-
-			//+ Player is on the ground or just landed on the ground
-			if (sPlayer->mapCollsionFlag & COLLISION_BOTTOM) {
-				sPlayer->jumping = false;
-				sPlayer->velocity.y = 0;
-				sPlayer->position.y = (int)sPlayer->position.y + 0.5f;
-			}
-
-			//+ Player is jumping/falling
-			if (isInAir) {
-				sPlayer->jumping = true;
-			}
-
-
-		}
-	}
-
-
-
-	//-----------------------------------------
-	// Check for collsion between game objects
-	//	- Player vs Enemy
-	//	- Player vs Item
-	//-----------------------------------------
-
-	for (int i = 0; i < GAME_OBJ_INST_MAX; i++) {
-
-		if (sPlayer->flag == FLAG_INACTIVE)
-			break;
-
-
-		GameObj* pInst = sGameObjInstArray + i;
-
-		// skip inactive object
-		if (pInst->flag == FLAG_INACTIVE)
-			continue;
-
-
-		//+ Player vs Enemy
-		//	- if the Player die, set the sRespawnCountdown > 0	
-		if (pInst->type == TYPE_ENEMY && sPlayer->mortal) {
-			int result = _detectCollisionAABB({ sPlayer->position.x, sPlayer->position.y , 1.f, 1.f }, { pInst->position.x, pInst->position.y, 1.f, 1.f });
-			if (result) {
-				if (result & COLLISION_BOTTOM) {
-					gameObjInstDestroy(*pInst);
-				}
-				else {
-					PlayerTakeDamage();
-				}
-			}
-		}
-
-
-		//+ Player vs Item
-		if (pInst->type == TYPE_ITEM) {
-			int result = _detectCollisionAABB({ sPlayer->position.x, sPlayer->position.y , 1.f, 1.f }, { pInst->position.x, pInst->position.y, 1.f, 1.f });
-			if (result) {
-				sScore++;
-				SoundEngine->play2D("coin.wav");
-				gameObjInstDestroy(*pInst);
-			}
-		}
-	}
-
 	//-----------------------------------------
 	// Update player mortal cooldown
 	//-----------------------------------------
@@ -1250,26 +1717,6 @@ void GameStateLevel1Update(double dt, long frame, int& state) {
 		sPlayer->mortal = true;
 	}
 
-	//-----------------------------------------
-	// Update modelMatrix of all game obj
-	//-----------------------------------------
-	for (int i = 0; i < GAME_OBJ_INST_MAX; i++) {
-		GameObj* pInst = sGameObjInstArray + i;
-
-		// skip inactive object
-		if (pInst->flag == FLAG_INACTIVE)
-			continue;
-
-		// Compute the scaling matrix
-		// Compute the rotation matrix, we should rotate around z axis 
-		// Compute the translation matrix
-		// Concatenate the 3 matrix to from Model Matrix
-		glm::mat4 rMat = glm::rotate(glm::mat4(1.0f), pInst->orientation, glm::vec3(0.0f, 0.0f, 1.0f));
-		glm::mat4 sMat = glm::scale(glm::mat4(1.0f), pInst->scale);
-		glm::mat4 tMat = glm::translate(glm::mat4(1.0f), pInst->position);
-		pInst->modelMatrix = tMat * sMat * rMat;
-	}
-
 	double fps = 1.0 / dt;
 	printf("Level1: Update @> %f fps, frame>%ld\n", fps, frame);
 	printf("Life> %i\n", sPlayerLives);
@@ -1287,8 +1734,7 @@ void GameStateLevel1Draw(void) {
 	//--------------------------------------------------------
 	// Draw Level
 	//--------------------------------------------------------
-	glm::mat4 matTransform;
-	glm::mat4 cellMatrix;
+	CDTAffine2D matTransform;
 
 	// calculate for view culling rendering
 	int minRenderCoorX = floor(sCamPosition.x - ceil(VIEW_WIDTH / 2)),
@@ -1296,40 +1742,30 @@ void GameStateLevel1Draw(void) {
 	int minRenderCoorY = floor((MAP_HEIGHT - sCamPosition.y) - ceil(VIEW_HEIGHT / 2)) - 1,
 		maxRenderCoorY = ceil((MAP_HEIGHT - sCamPosition.y) + ceil(VIEW_HEIGHT / 2));
 
-	for (int y = minRenderCoorY; y <= maxRenderCoorY; y++) {
-
-		// prevent out of bound
-		if (y < 0 || y >= MAP_HEIGHT) continue;
-
-		for (int x = minRenderCoorX; x <= maxRenderCoorX; x++) {
-
-			// prevent out of bound
-			if (x < 0 || x >= MAP_WIDTH) continue;
+	// draw the resident chunks in view, 1 mesh each, chunk rows go up from the bottom of the map
+	int chunkSize = sWorldStream.chunkSize;
+	int minChunkX = std::max(minRenderCoorX, 0) / chunkSize, maxChunkX = std::min(maxRenderCoorX, MAP_WIDTH - 1) / chunkSize;
+	int minChunkY = std::max((MAP_HEIGHT - 1) - maxRenderCoorY, 0) / chunkSize, maxChunkY = std::min((MAP_HEIGHT - 1) - minRenderCoorY, MAP_HEIGHT - 1) / chunkSize;
 
-			//+ Only draw non-background cell
-			if (sMapData[y][x] > 0 && sMapData[y][x] < 5) {
+	for (int cy = minChunkY; cy <= maxChunkY; cy++) {
+		for (int cx = minChunkX; cx <= maxChunkX; cx++) {
+			int c = cy * sWorldStream.numChunkX + cx;
+			if (!StreamChunkData(sWorldStream, cx, cy) || sChunkMesh[c].vaoHandle == 0) continue;
 
-				glm::mat4 tMat = glm::translate(glm::mat4(1.0f), glm::vec3(x + 0.5f, (MAP_HEIGHT - y) - 0.5f, 0.0f));
-				glm::mat4 sMat = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 1.0f, 1.0f));
+			// the chunk mesh is in tiles from the chunk corner, transform it to screen space [-width/2,width/2]
+			matTransform = sMapTransform;
+			matTransform.tx += sMapTransform.a * (cx * chunkSize);
+			matTransform.ty += sMapTransform.d * (cy * chunkSize);
 
-				//+ Find transformation matrix of each cell
-				cellMatrix = tMat * sMat;
-
-				// Transform cell from map space [0,MAP_SIZE] to screen space [-width/2,width/2]
-				matTransform = sMapMatrix * cellMatrix;
-
-				// Render each cell
-				SetRenderMode(CDT_TEXTURE, 1.0f);
-				SetTexture(*sMapTex, sMapOffset * (sMapData[y][x] - 1), 0.0f);
-				SetTransform(matTransform);
-				DrawMesh(*sMapMesh);
-			}
+			RenderQueueAdd(sRenderQueue, &sChunkMesh[c], *sMapTex, 0.0f, 0.0f, matTransform,
+				MAP_DEPTH, 1.0f, sChunkMaterial[c]);
 		}
 	}
 
 
 	//--------------------------------------------------------
 	// Draw all game object instance in the sGameObjInstArray
+	//	- the sprites are alpha 0 or 1, alpha tested unless faded
 	//--------------------------------------------------------
 
 	for (int i = 0; i < GAME_OBJ_INST_MAX; i++) {
@@ -1355,7 +1791,7 @@ void GameStateLevel1Draw(void) {
 
 
 		// Transform cell from map space [0,MAP_SIZE] to screen space [-width/2,width/2]
-		matTransform = sMapMatrix * pInst->modelMatrix;
+		matTransform = AffineMultiply(sMapTransform, pInst->modelTransform);
 
 		int alpha = 1.0f;
 
@@ -1363,12 +1799,16 @@ void GameStateLevel1Draw(void) {
 			alpha = sMortalCountdown % 2;
 
 
-		SetRenderMode(CDT_TEXTURE, alpha);
-		SetTexture(*pInst->tex, pInst->offsetX, pInst->offsetY);
-		SetTransform(matTransform);
-		DrawMesh(*pInst->mesh);
+		RenderQueueAdd(sRenderQueue, pInst->mesh, *pInst->tex, pInst->offsetX, pInst->offsetY, matTransform,
+			OBJECT_DEPTH + i * OBJECT_DEPTH_STEP, (float)alpha, alpha < 1 ? CDT_MATERIAL_TRANSLUCENT : CDT_MATERIAL_ALPHA_TEST);
 	}
 
+	// opaque and alpha tested front to back, then the translucent ones
+	RenderQueueFlush(sRenderQueue);
+
+	// effects over the objects, 1 instanced draw per particle type
+	ParticleDraw(sParticles, sMapTransform);
+
 
 	// Swap the buffer, to present the drawing
 	glfwSwapBuffers(window);
@@ -1380,35 +1820,52 @@ void GameStateLevel1Free(void) {
 	for (int i = 0; i < GAME_OBJ_INST_MAX; i++) {
 		gameObjInstDestroy(sGameObjInstArray[i]);
 	}
+	for (size_t c = 0; c < sChunkSuspended.size(); c++)
+		sChunkSuspended[c].clear();
+
+	// the chunks are dropped without evict by the StreamReset of Init
+	for (int c = 0; c < (int)sChunkMesh.size(); c++)
+		FreeChunkMesh(c);
 
 	// reset camera
 	ResetCam();
 
 	// Free sound
-	SoundEngine->drop();
+	AudioStreamStop(sMusicStream);
+	sMusicStream = -1;
+
+	// Free particles
+	ParticleShutdown(sParticles);
 
 	printf("Level1: Free\n");
 }
 
 void GameStateLevel1Unload(void) {
 
-	// Unload all meshes in MeshArray
+	// Release all meshes in MeshArray, the cache keeps them while it has room
 	for (int i = 0; i < sNumMesh; i++) {
-		UnloadMesh(sMeshArray[i]);
+		ResourceReleaseMesh(sMeshArray[i]);
 	}
 
-	// Unload all textures in TexArray
+	// Release all textures in TexArray
 	for (int i = 0; i < sNumTex; i++) {
-		TextureUnload(sTexArray[i]);
+		ResourceReleaseTexture(sTexArray[i]);
 	}
 
-	// Unload Level
-	for (int i = 0; i < MAP_HEIGHT; ++i) {
-		delete[] sMapData[i];
-		delete[] sMapCollisionData[i];
-	}
-	delete[] sMapData;
-	delete[] sMapCollisionData;
+	// Unload Level, stop the stream thread first, it reads the mapped tiles
+	StreamShutdown(sWorldStream);
+	sChunkSpawnFirst.clear();
+	sChunkSpawn.clear();
+	sChunkSpawned.clear();
+	sChunkSuspended.clear();
+	sChunkMesh.clear();
+	sChunkMaterial.clear();
+	BitGridFree(sMapCollision);
+	ColliderTreeFree(sMapColliders);
+	LevelClose(sLevel);
+
+	PipelineClear(sUpdatePipeline);
+	GridFree(sObjGrid);
 
 
 	printf("Level1: Unload\n");
@@ -18,8 +18,11 @@ extern GLFWwindow* window;
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/random.hpp>
 
+struct CDTLoadGraph;
+
 // ---------------------------------------------------------------------------
 
+CDTLoadGraph* GameStateLevel1Preload(bool background);
 void GameStateLevel1Load(void);
 void GameStateLevel1Init(void);
 void GameStateLevel1Update(double dt, long frame, int &state);
@@ -1,11 +1,21 @@
 
 
 #include "GameStateLevel2.h"
+#include "CDTLoadGraph.h"
 
+static CDTLoadGraph	sLoadGraph;		// nothing to load yet
 
 
+CDTLoadGraph* GameStateLevel2Preload(bool background){
+
+	LoadGraphInit(sLoadGraph);
+	LoadGraphStart(sLoadGraph, background);
+	return &sLoadGraph;
+}
+
 void GameStateLevel2Load(void){
 
+	LoadGraphFinish(*GameStateLevel2Preload(false));
 	printf("Level2: Load\n");
 }
 
@@ -16,8 +16,11 @@ extern GLFWwindow* window;
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/random.hpp>
 
+struct CDTLoadGraph;
+
 // ---------------------------------------------------------------------------
 
+CDTLoadGraph* GameStateLevel2Preload(bool background);
 void GameStateLevel2Load(void);
 void GameStateLevel2Init(void);
 void GameStateLevel2Update(double dt, long frame, int &state);
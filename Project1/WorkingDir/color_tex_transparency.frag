@@ -1,25 +1,46 @@
 #version 330 core
 
+// variants, #defined by the engine before compiling (CDT_SHADER_ flags)
+//	TEXTURED		color from tex1, times the vertex color if COLORED too
+//	COLORED			vertex color
+//	ALPHA_TEST		pixels under half alpha are discarded
+//	PREMULTIPLIED	tex1 is premultiplied, alpha scales the 4 channels
+//	PALETTE			red of tex1 is an index in the 256x1 palette texture
+
 in vec3 Color;
 in vec2 TexCoord;
 
 uniform sampler2D tex1;
 uniform float alpha;
-uniform int mode;			//0 - color, 1 - texture
+#ifdef PALETTE
+uniform sampler2D palette;
+#endif
 
 out vec4 Color0;
 
 void main( void )
 {
+#ifdef TEXTURED
+#ifdef PALETTE
+	float index = texture( tex1, TexCoord).r;
+	vec4 texColor = texture( palette, vec2(index * (255.0 / 256.0) + (0.5 / 256.0), 0.5));
+#else
 	vec4 texColor = texture( tex1, TexCoord);
-	vec4 finalColor = vec4(0.0f,0.0f,0.0f,1.0f);
-
-	if (mode == 0){
-		finalColor = vec4(Color,alpha);
-	}else{
-		texColor.rgb *= alpha;
-		finalColor = texColor;
-	}
-
-	Color0 = finalColor;
-}
\ No newline at end of file
+#endif
+#ifdef COLORED
+	texColor.rgb *= Color;
+#endif
+#ifdef ALPHA_TEST
+	if (texColor.a < 0.5)
+		discard;
+#endif
+#ifdef PREMULTIPLIED
+	Color0 = texColor * alpha;
+#else
+	texColor.rgb *= alpha;
+	Color0 = texColor;
+#endif
+#else
+	Color0 = vec4(Color,alpha);
+#endif
+}
@@ -0,0 +1,12 @@
+#version 330 core
+
+in vec2 TexCoord;
+
+uniform sampler2D tex1;
+
+out vec4 Color0;
+
+void main( void )
+{
+	Color0 = texture( tex1, TexCoord);
+}
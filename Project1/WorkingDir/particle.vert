@@ -0,0 +1,22 @@
+#version 330 core
+
+// 1 quad per particle, the particle attributes advance once per instance
+
+layout(location = 0) in vec2 Corner;				// quad corner, [-0.5,0.5]
+layout(location = 3) in float ParticleX;
+layout(location = 4) in float ParticleY;
+layout(location = 5) in float ParticleFrame;
+
+uniform mat4 MVP;
+uniform float size;									// quad side
+uniform float frameWidth;							// 1 / frames of the sprite sheet
+
+out vec2 TexCoord;
+
+void main( void )
+{
+	TexCoord.x = (Corner.x + 0.5 + ParticleFrame) * frameWidth;
+	TexCoord.y = 0.5 - Corner.y;
+
+	gl_Position = MVP * vec4(vec2(ParticleX, ParticleY) + Corner * size, 0.0, 1.0);
+}
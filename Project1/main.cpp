@@ -4,6 +4,13 @@
 //				press R to restart the level
 //				press N to change the level
 //				press esc to quit
+//				run with --bench-physics to time the integration kernels
+//				run with --bench-particles to time the particle update
+//				run with --convert-map in.txt out.lvl to build a binary level
+//				run with --convert-tiled in.json out.lvl to build it from a Tiled map
+//				run with --build-pack assets.txt assets.pak to pack the assets
+//				run with --audio-null to play without a sound device
+//				run with --audio-sink out.wav to write the mixed sound to a file
 // ---------------------------------------------------------------------------
 
 
@@ -11,6 +18,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <vector>
+#include <string.h>
 
 // Include GLEW
 #include <GL/glew.h>
@@ -25,6 +33,12 @@ GLFWwindow* window;
 
 #include "system.h"
 #include "CDT.h"
+#include "CDTJobs.h"
+#include "CDTPhysics.h"
+#include "CDTLevel.h"
+#include "CDTLoadGraph.h"
+#include "CDTAudio.h"
+#include "CDTParticle.h"
 #include "GameStateLevel1.h"
 #include "GameStateLevel2.h"
 
@@ -45,6 +59,17 @@ void(*GameStateDraw)() = 0;
 void(*GameStateFree)() = 0;
 void(*GameStateUnload)() = 0;
 
+// per level functions, to preload/unload a level that is not the current one
+CDTLoadGraph*(*gStatePreload[RESTART])(bool) = { GameStateLevel1Preload, GameStateLevel2Preload };
+void(*gStateUnload[RESTART])() = { GameStateLevel1Unload, GameStateLevel2Unload };
+
+// the level N switches to is preloaded while the current one runs
+//	- a level stays loaded while it's the one N switches back to
+#define PRELOAD_BUDGET		2.0				// ms per frame for the GL tasks of the preload
+bool			gStateLoaded[RESTART] = { false, false };
+CDTLoadGraph*	gPreloadGraph = NULL;
+unsigned int	gPreloadState = QUIT;
+
 // key manager, for one time pressing
 bool Rdown = false;
 bool Sdown = false;
@@ -54,16 +79,98 @@ bool Ndown = false;
 double	frametime = 0;
 long	framenumber = 0;
 
+// assets, mounted when the file exists
+#define ASSET_PACK_FILE		"assets.pak"
+
 // windows
 int		win_width = 1200;// 1024;
 int		win_height = 800;//  768;
 
 
-int main(void) {
+// level that N switches to from this one
+unsigned int NextLevel(unsigned int state) {
+	return state == LEVEL1 ? LEVEL2 : LEVEL1;
+}
+
+// load the current level, only finish its preload if it was preloaded
+void LoadCurrentState() {
+	if (gPreloadState == gGameStateCurr) {
+		LoadGraphFinish(*gPreloadGraph);
+		LoadGraphReport(*gPreloadGraph);
+		gPreloadGraph = NULL;
+		gPreloadState = QUIT;
+	}
+	else if (!gStateLoaded[gGameStateCurr]) {
+		GameStateLoad();
+	}
+	gStateLoaded[gGameStateCurr] = true;
+}
+
+
+int main(int argc, char** argv) {
+
+	// Headless micro benchmark, no window needed
+	if (argc > 1 && strcmp(argv[1], "--bench-physics") == 0) {
+		PhysicsBenchmark(100000, 1000);
+		return 0;
+	}
+	if (argc > 1 && strcmp(argv[1], "--bench-particles") == 0) {
+		ParticleBenchmark(50000, 1000);
+		return 0;
+	}
+
+	// Text map to binary level converter, no window needed
+	if (argc > 1 && strcmp(argv[1], "--convert-map") == 0) {
+		if (argc < 4) {
+			printf("usage: %s --convert-map in.txt out.lvl\n", argv[0]);
+			return 1;
+		}
+		return LevelConvertText(argv[2], argv[3]) ? 0 : 1;
+	}
+
+	// Tiled map (json export) to binary level converter
+	if (argc > 1 && strcmp(argv[1], "--convert-tiled") == 0) {
+		if (argc < 4) {
+			printf("usage: %s --convert-tiled in.json out.lvl\n", argv[0]);
+			return 1;
+		}
+		return LevelConvertTiled(argv[2], argv[3]) ? 0 : 1;
+	}
+
+	// Asset pack builder, from a list of asset paths
+	if (argc > 1 && strcmp(argv[1], "--build-pack") == 0) {
+		if (argc < 4) {
+			printf("usage: %s --build-pack assets.txt assets.pak\n", argv[0]);
+			return 1;
+		}
+		return PackBuild(argv[2], argv[3]) ? 0 : 1;
+	}
+
+	// Assets are read from the pack when there is one, from WorkingDir otherwise
+	if (AssetMount(ASSET_PACK_FILE))
+		printf("Assets: %s mounted\n", ASSET_PACK_FILE);
+
+	// Sound device, the null one writes the mix to a file when given
+	int audioBackend = CDT_AUDIO_DEFAULT;
+	const char* audioSink = NULL;
+	if (argc > 1 && strcmp(argv[1], "--audio-null") == 0) {
+		audioBackend = CDT_AUDIO_NULL;
+	}
+	else if (argc > 1 && strcmp(argv[1], "--audio-sink") == 0) {
+		if (argc < 3) {
+			printf("usage: %s --audio-sink out.wav\n", argv[0]);
+			return 1;
+		}
+		audioBackend = CDT_AUDIO_NULL;
+		audioSink = argv[2];
+	}
 
 	// Initialize the System (GFW, GLEW, Input, Create window)
 	SystemInit(win_width, win_height, "Mario Demo");
 	CDTInit(win_width, win_height);
+	AudioInit(audioBackend, audioSink);
+	JobSystemInit(0);
+	PhysicsInit();
 
 	// Initialize Game State (to level 1)
 	gGameStateInit = LEVEL1;
@@ -85,7 +192,7 @@ int main(void) {
 			GameStateDraw = GameStateLevel2Draw;
 			GameStateFree = GameStateLevel2Free;
 			GameStateUnload = GameStateLevel2Unload;
-			GameStateLoad();
+			LoadCurrentState();
 		}
 		else {	//LEVEL1
 			GameStateLoad = GameStateLevel1Load;
@@ -94,13 +201,20 @@ int main(void) {
 			GameStateDraw = GameStateLevel1Draw;
 			GameStateFree = GameStateLevel1Free;
 			GameStateUnload = GameStateLevel1Unload;
-			GameStateLoad();
+			LoadCurrentState();
 		}
 
 		FrameInit();
 		GameStateInit();
 		framenumber = 0;
 
+		// start loading the level N switches to, in the background
+		unsigned int preload = NextLevel(gGameStateCurr);
+		if (!gStateLoaded[preload] && gPreloadState != preload) {
+			gPreloadGraph = gStatePreload[preload](true);
+			gPreloadState = preload;
+		}
+
 
 		while (gGameStateCurr == gGameStateNext) {
 
@@ -114,6 +228,14 @@ int main(void) {
 			GameStateUpdate(frametime, framenumber, state);
 			GameStateDraw();
 
+			// GL side of the preload, a few ms per frame
+			if (gPreloadGraph != NULL && LoadGraphPoll(*gPreloadGraph, PRELOAD_BUDGET)) {
+				LoadGraphReport(*gPreloadGraph);
+				gStateLoaded[gPreloadState] = true;
+				gPreloadGraph = NULL;
+				gPreloadState = QUIT;
+			}
+
 			// Check return state from Update()
 			if (state == 2) {
 				gGameStateNext = RESTART;
@@ -134,12 +256,7 @@ int main(void) {
 
 			// Check if User want to change level
 			if (glfwGetKey(window, GLFW_KEY_N) == GLFW_PRESS && !Ndown) {
-				if (gGameStateCurr == LEVEL1) {
-					gGameStateNext = LEVEL2;
-				}
-				else {
-					gGameStateNext = LEVEL1;
-				}
+				gGameStateNext = NextLevel(gGameStateCurr);
 				Ndown = true;
 			}
 			if (glfwGetKey(window, GLFW_KEY_N) == GLFW_RELEASE && Ndown) { Ndown = false; }
@@ -149,8 +266,10 @@ int main(void) {
 
 		GameStateFree();
 
-		if (gGameStateNext != RESTART) {
+		// kept loaded when the next level can switch back to it with N
+		if (gGameStateNext == QUIT || (gGameStateNext != RESTART && NextLevel(gGameStateNext) != gGameStateCurr)) {
 			GameStateUnload();
+			gStateLoaded[gGameStateCurr] = false;
 		}
 
 		gGameStatePrev = gGameStateCurr;
@@ -158,8 +277,21 @@ int main(void) {
 	}
 
 
+	// Unload the levels still loaded for a switch back
+	if (gPreloadGraph != NULL) {
+		LoadGraphFinish(*gPreloadGraph);
+		gStateLoaded[gPreloadState] = true;
+	}
+	for (unsigned int s = LEVEL1; s < RESTART; s++) {
+		if (gStateLoaded[s])
+			gStateUnload[s]();
+	}
+
 	// Do system clean up before quit
+	JobSystemShutdown();
+	AudioShutdown();
 	CDTShutdown();
+	AssetUnmount();
 	SystemShutdown();
 
 	return 0;
@@ -8,42 +8,123 @@ using namespace std;
 
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 
 #include <GL/glew.h>
 
 #include "shader.hpp"
+#include "CDTPack.h"
+#include "CDTFile.h"
+
+// Program binary cache
+//	- a linked program is saved with glGetProgramBinary in SHADER_CACHE_DIR,
+//	  the file is named after the hash of the 2 sources and of the driver
+//	  (vendor, renderer, version), so a changed source or driver misses
+//	- the next launch loads it with glProgramBinary, a program the driver
+//	  refuses, or a bad file, is compiled again and the file replaced
+#define SHADER_CACHE_DIR		"shadercache"
+#define SHADER_CACHE_MAGIC		0x4E494253		// "SBIN"
+
+struct ShaderCacheHeader {
+	uint32_t	magic;
+	uint32_t	format;			// binary format of the driver
+	uint64_t	key;
+	uint32_t	length;			// of the binary that follows
+	uint32_t	pad;
+};
+
+static uint64_t HashBytes(uint64_t hash, const void* data, size_t size){
+	const unsigned char* bytes = (const unsigned char*)data;
+	for(size_t i = 0; i < size; i++){
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
 
-GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path){
+static uint64_t ShaderCacheKey(const std::string& VertexShaderCode, const std::string& FragmentShaderCode){
+	uint64_t key = 14695981039346656037ull;
+	GLenum driver[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	for(int i = 0; i < 3; i++){
+		const char* name = (const char*)glGetString(driver[i]);
+		if(name)
+			key = HashBytes(key, name, strlen(name) + 1);
+	}
+	key = HashBytes(key, VertexShaderCode.c_str(), VertexShaderCode.size() + 1);
+	key = HashBytes(key, FragmentShaderCode.c_str(), FragmentShaderCode.size() + 1);
+	return key;
+}
 
-	// Create the shaders
-	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+static std::string ShaderCachePath(uint64_t key){
+	static const char* hex = "0123456789abcdef";
+	std::string path = SHADER_CACHE_DIR "/";
+	for(int shift = 60; shift >= 0; shift -= 4)
+		path += hex[(key >> shift) & 15];
+	return path + ".bin";
+}
 
-	// Read the Vertex Shader code from the file
-	std::string VertexShaderCode;
-	std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
-	if(VertexShaderStream.is_open()){
-		std::string Line = "";
-		while(getline(VertexShaderStream, Line))
-			VertexShaderCode += "\n" + Line;
-		VertexShaderStream.close();
-	}else{
-		printf("Impossible to open %s. Are you in the right directory ? Don't forget to read the FAQ !\n", vertex_file_path);
-		getchar();
+static bool ShaderCacheSupported(){
+	if(!GLEW_ARB_get_program_binary)
+		return false;
+	GLint numFormat = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormat);
+	return numFormat > 0;
+}
+
+// 0 if not cached or refused by the driver
+static GLuint ShaderCacheLoad(uint64_t key){
+	CDTMappedFile file;
+	if(!FileMap(file, ShaderCachePath(key).c_str()))
 		return 0;
-	}
 
-	// Read the Fragment Shader code from the file
-	std::string FragmentShaderCode;
-	std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
-	if(FragmentShaderStream.is_open()){
-		std::string Line = "";
-		while(getline(FragmentShaderStream, Line))
-			FragmentShaderCode += "\n" + Line;
-		FragmentShaderStream.close();
+	GLuint ProgramID = 0;
+	const ShaderCacheHeader* header = (const ShaderCacheHeader*)file.data;
+	if(file.size >= sizeof(ShaderCacheHeader) && header->magic == SHADER_CACHE_MAGIC && header->key == key &&
+		header->length == file.size - sizeof(ShaderCacheHeader)){
+
+		ProgramID = glCreateProgram();
+		glProgramBinary(ProgramID, header->format, file.data + sizeof(ShaderCacheHeader), header->length);
+
+		GLint Result = GL_FALSE;
+		glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
+		if(Result != GL_TRUE){
+			glDeleteProgram(ProgramID);
+			ProgramID = 0;
+		}
 	}
 
+	FileUnmap(file);
+	return ProgramID;
+}
+
+static void ShaderCacheSave(GLuint ProgramID, uint64_t key){
+	GLint length = 0;
+	glGetProgramiv(ProgramID, GL_PROGRAM_BINARY_LENGTH, &length);
+	if(length <= 0)
+		return;
+
+	std::vector<unsigned char> data(sizeof(ShaderCacheHeader) + length);
+	ShaderCacheHeader* header = (ShaderCacheHeader*)&data[0];
+	GLenum format = 0;
+	glGetProgramBinary(ProgramID, length, &length, &format, &data[sizeof(ShaderCacheHeader)]);
+
+	header->magic = SHADER_CACHE_MAGIC;
+	header->format = format;
+	header->key = key;
+	header->length = (uint32_t)length;
+	header->pad = 0;
+	data.resize(sizeof(ShaderCacheHeader) + length);
+
+	if(!FileMakeDir(SHADER_CACHE_DIR) || !FileWrite(ShaderCachePath(key).c_str(), &data[0], data.size()))
+		printf("Can't write the program binary cache %s\n", ShaderCachePath(key).c_str());
+}
 
+static GLuint CompileProgram(const std::string& VertexShaderCode, const std::string& FragmentShaderCode,
+	const char * vertex_file_path, const char * fragment_file_path, bool retrievable){
+
+	// Create the shaders
+	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
+	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
 
 	GLint Result = GL_FALSE;
 	int InfoLogLength;
@@ -89,6 +170,8 @@ GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path
 	GLuint ProgramID = glCreateProgram();
 	glAttachShader(ProgramID, VertexShaderID);
 	glAttachShader(ProgramID, FragmentShaderID);
+	if(retrievable)
+		glProgramParameteri(ProgramID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(ProgramID);
 
 	// Check the program
@@ -106,4 +189,61 @@ GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path
 	return ProgramID;
 }
 
+// the #version line has to stay the first line
+static void InsertDefines(std::string& ShaderCode, const char * defines){
+	size_t line = 0;
+	if(ShaderCode.compare(0, 8, "#version") == 0){
+		line = ShaderCode.find('\n');
+		line = line == std::string::npos ? ShaderCode.size() : line + 1;
+	}
+	ShaderCode.insert(line, defines);
+}
+
+GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path, const char * defines){
+
+	// Read the Vertex Shader code from the asset pack, or the file
+	std::string VertexShaderCode;
+	CDTAsset VertexShaderAsset;
+	if(AssetOpen(VertexShaderAsset, vertex_file_path)){
+		VertexShaderCode.assign((const char*)VertexShaderAsset.data, VertexShaderAsset.size);
+		AssetClose(VertexShaderAsset);
+	}else{
+		printf("Impossible to open %s. Are you in the right directory ? Don't forget to read the FAQ !\n", vertex_file_path);
+		getchar();
+		return 0;
+	}
+
+	// Read the Fragment Shader code from the asset pack, or the file
+	std::string FragmentShaderCode;
+	CDTAsset FragmentShaderAsset;
+	if(AssetOpen(FragmentShaderAsset, fragment_file_path)){
+		FragmentShaderCode.assign((const char*)FragmentShaderAsset.data, FragmentShaderAsset.size);
+		AssetClose(FragmentShaderAsset);
+	}
+
+	// Variant of the shaders, the cache key sees the defines in the code
+	if(defines && defines[0]){
+		InsertDefines(VertexShaderCode, defines);
+		InsertDefines(FragmentShaderCode, defines);
+	}
+
+	// Linked by a previous launch with the same sources and driver
+	bool cache = ShaderCacheSupported();
+	uint64_t key = cache ? ShaderCacheKey(VertexShaderCode, FragmentShaderCode) : 0;
+	if(cache){
+		GLuint ProgramID = ShaderCacheLoad(key);
+		if(ProgramID != 0){
+			printf("Program binary cache : %s %s\n", vertex_file_path, fragment_file_path);
+			return ProgramID;
+		}
+	}
 
+	GLuint ProgramID = CompileProgram(VertexShaderCode, FragmentShaderCode, vertex_file_path, fragment_file_path, cache);
+
+	GLint Result = GL_FALSE;
+	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
+	if(cache && Result == GL_TRUE)
+		ShaderCacheSave(ProgramID, key);
+
+	return ProgramID;
+}
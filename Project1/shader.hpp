@@ -1,6 +1,7 @@
 #ifndef SHADER_HPP
 #define SHADER_HPP
 
-GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path);
+// defines (like "#define TEXTURED\n") are inserted after the #version line of both shaders
+GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path, const char * defines = NULL);
 
 #endif
@@ -22,6 +22,7 @@ int SystemInit(int width, int height, const char* title){
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_DEPTH_BITS, 24);			// opaque pass of the render queue
 
 	// Open a window and create its OpenGL context
 	window = glfwCreateWindow(width, height, title, NULL, NULL);